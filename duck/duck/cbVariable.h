@@ -1,10 +1,13 @@
 #pragma once
 #include <cassert>
+#include <cstdint>
 #include <memory>
 #include <array>
 #include <DirectXMath.h>
 #include "imgui.h"
 #include <string>
+#include "cbufferPlan.h"
+#include "semanticTable.h"
 
 namespace mini
 {
@@ -15,6 +18,16 @@ namespace mini
 		public:
 			virtual ~ICBVariable() = default;
 			virtual void copyTo(void* buffer, size_t bufferSize) const = 0;
+			//adds copies placing the value at offset of a buffer, laid out like copyTo does
+			virtual void addToPlan(CBufferPlan& plan, size_t offset, size_t size) const = 0;
+
+			//incremented on every change of the value, buffers holding the variable are uploaded only when it changes
+			virtual const uint64_t& version() const { return m_version; }
+			//has to be called after writing to the value directly
+			void markChanged() { ++m_version; }
+
+		private:
+			uint64_t m_version = 1;
 		};
 
 		namespace detail
@@ -57,15 +70,29 @@ namespace mini
 					return sizeof(T);
 				}
 
+				void addToPlan(CBufferPlan& plan, size_t offset, size_t size) const override
+				{
+					addToPlan(plan, value, offset, size);
+				}
+
+				static size_t addToPlan(CBufferPlan& plan, const T& value, size_t offset, size_t size)
+				{
+					assert(size >= sizeof(T));
+					plan.Add(&value, offset, sizeof(T));
+					return sizeof(T);
+				}
+
 				MyT& operator=(const T& v)
 				{
 					memcpy(&value, &v, sizeof(T));
+					markChanged();
 					return *this;
 				}
 
 				MyT& operator=(T&& v)
 				{
 					value = std::move(v);
+					markChanged();
 					return *this;
 				}
 			};
@@ -101,9 +128,28 @@ namespace mini
 					return offset;
 				}
 
+				void addToPlan(CBufferPlan& plan, size_t offset, size_t size) const override
+				{
+					addToPlan(plan, value, offset, size);
+				}
+
+				static size_t addToPlan(CBufferPlan& plan, const ValueT& value, size_t offset, size_t size)
+				{
+					size_t elemOffset = 0;
+					for (const ElemT& val : value)
+					{
+						assert(elemOffset < size);
+						elemOffset += CBVariableBase<ExtentT>::addToPlan(plan, val, offset + elemOffset, size - elemOffset);
+						if (elemOffset & (ByteAlignment - 1))
+							elemOffset = (elemOffset & ~(ByteAlignment - 1)) + ByteAlignment;
+					}
+					return elemOffset;
+				}
+
 				MyT& operator=(const ExtentT (&v)[N::value])
 				{
 					std::copy_n(v, N::value, value);
+					markChanged();
 					return *this;
 				}
 
@@ -111,30 +157,33 @@ namespace mini
 				{
 					std::copy_n(std::make_move_iterator(std::begin(v)), N::value, value.begin());
 					//value = std::move(v);
+					markChanged();
 					return *this;
 				}
 			};
 
-			inline void guiUpdate(const std::string& label, DirectX::XMFLOAT3& value, float min, float max, float step)
+			inline bool guiUpdate(const std::string& label, DirectX::XMFLOAT3& value, float min, float max, float step)
 			{
-				ImGui::DragFloat3(label.c_str(), &value.x, step, min, max);
+				return ImGui::DragFloat3(label.c_str(), &value.x, step, min, max);
 			}
 
-			inline void guiUpdate(const std::string& label, DirectX::XMFLOAT4& value, float min, float max, float step)
+			inline bool guiUpdate(const std::string& label, DirectX::XMFLOAT4& value, float min, float max, float step)
 			{
-				ImGui::DragFloat4(label.c_str(), &value.x, step, min, max);
+				return ImGui::DragFloat4(label.c_str(), &value.x, step, min, max);
 			}
 
-			inline void guiUpdate(const std::string& label, float& value, float min, float max, float step)
+			inline bool guiUpdate(const std::string& label, float& value, float min, float max, float step)
 			{
-				ImGui::DragFloat(label.c_str(), &value, step, min, max);
+				return ImGui::DragFloat(label.c_str(), &value, step, min, max);
 			}
 
 			template<typename T, size_t N>
-			inline void guiUpdate(const std::string& label, T (&value)[N], float min, float max, float step)
+			inline bool guiUpdate(const std::string& label, T (&value)[N], float min, float max, float step)
 			{
+				bool changed = false;
 				for (size_t i = 0; i < N; ++i)
-					guiUpdate(label + "[" + std::to_string(i) + "]", value[i], min, max, step);
+					changed |= guiUpdate(label + "[" + std::to_string(i) + "]", value[i], min, max, step);
+				return changed;
 			}
 		}
 
@@ -146,6 +195,32 @@ namespace mini
 			using MyBase::operator=;
 		};
 
+		//Variable whose value and version live in a slot of a SemanticTable
+		class SemanticVariable : public ICBVariable
+		{
+		public:
+			SemanticVariable(const SemanticTable& table, VariableSemantic semantic)
+				: m_table(table), m_semantic(semantic) { }
+
+			void copyTo(void* buffer, size_t bufferSize) const override
+			{
+				assert(bufferSize >= SemanticTable::Size(m_semantic));
+				memcpy(buffer, m_table.Data(m_semantic), SemanticTable::Size(m_semantic));
+			}
+
+			void addToPlan(CBufferPlan& plan, size_t offset, size_t size) const override
+			{
+				assert(size >= SemanticTable::Size(m_semantic));
+				plan.Add(m_table.Data(m_semantic), offset, SemanticTable::Size(m_semantic));
+			}
+
+			const uint64_t& version() const override { return m_table.Version(m_semantic); }
+
+		private:
+			const SemanticTable& m_table;
+			VariableSemantic m_semantic;
+		};
+
 		class IGUIVariable
 		{
 		public:
@@ -164,7 +239,8 @@ namespace mini
 
 			void Update() override
 			{
-				detail::guiUpdate(m_name, CBVariable<T>::value, m_min, m_max, m_step);
+				if (detail::guiUpdate(m_name, CBVariable<T>::value, m_min, m_max, m_step))
+					CBVariable<T>::markChanged();
 			}
 
 		protected:
@@ -183,7 +259,8 @@ namespace mini
 
 			void Update() override
 			{
-				ImGui::ColorEdit3(m_name.c_str(), &value.x);
+				if (ImGui::ColorEdit3(m_name.c_str(), &value.x))
+					markChanged();
 			}
 		};
 
@@ -201,8 +278,11 @@ namespace mini
 			
 			void Update() override
 			{
+				bool changed = false;
 				for (size_t i = 0; i < NElems; ++i)
-					ImGui::ColorEdit3((MyBase::m_name + "[" + std::to_string(i) + "]").c_str(), &MyBase::value[i].x);
+					changed |= ImGui::ColorEdit3((MyBase::m_name + "[" + std::to_string(i) + "]").c_str(), &MyBase::value[i].x);
+				if (changed)
+					MyBase::markChanged();
 			}
 		};
 	}
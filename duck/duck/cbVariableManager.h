@@ -1,5 +1,6 @@
 #pragma once
 #include <map>
+#include <algorithm>
 #include "cbVariableSemantics.h"
 #include "cbVariable.h"
 #include "clock.h"
@@ -8,6 +9,7 @@
 #include "cBufferDesc.h"
 #include "dxstructures.h"
 #include "effect.h"
+#include "textureUpload.h"
 
 namespace mini
 {
@@ -29,22 +31,26 @@ namespace mini
 			void UpdateView(const directx::camera& camera, const ViewFrustrum& frustrum);
 			void UpdateFrustrum(const ViewFrustrum& frustrum, const directx::camera & camera);
 			void UpdateViewAndFrustrum(const directx::camera & camera, const ViewFrustrum& frusturm);
-			void UpdateFrame(const dx_ptr<ID3D11DeviceContext>& context, utils::clock const &clock);
-			void UpdateModel(const Model::NodeIterator& modelPart);
+			void UpdateFrame(utils::clock const &clock);
+			//Updates model related semantics. Only the ones read by some constant buffer (looked up through
+			//GetVariable) are computed, inverses of affine matrices avoid a general 4x4 inverse (see SemanticTable).
+			void UpdateModel(const Model::NodeIterator& modelPart) { UpdateModel(modelPart, m_semantics); }
+			//Updates model related semantics of a table of a render pass, see CompileCBuffer. The manager is only read,
+			//so passes with their own tables can be updated from several threads at once.
+			void UpdateModel(const Model::NodeIterator& modelPart, SemanticTable& model) const;
 
 			void AddSampler(const DxDevice& device, const std::string& name, const directx::sampler_info& desc = {});
 
 			void AddTexture(const DxDevice& device, const std::string& name, const std::wstring& file);
 			void AddTexture(const DxDevice& device, const std::string& name, const directx::tex2d_info& desc);
 			void AddTexture(const DxDevice& device, const std::string& name, const dx_ptr<ID3D11Texture2D>& texture);
-			void AddRenderableTexture(const DxDevice& device, const std::string& name, const directx::tex2d_info& desc);
-			void AddRenderableTexture(const DxDevice& device, const std::string& name, const SIZE textureSize)
-			{
-				directx::tex2d_info desc(textureSize.cx, textureSize.cy);
-				desc.BindFlags |= D3D11_BIND_RENDER_TARGET;
-				desc.MipLevels = 1;
-				AddRenderableTexture(device, name, desc);
-			}
+			//Adds a name of a texture without a view. Passes reading it get their views from its owner, e.g. render
+			//targets of the frame graph of DuckBase, which change with the memory they are assigned.
+			void AddTextureName(const std::string& name) { m_textures.emplace(name, nullptr); }
+			//Adds a texture whose contents are streamed from the CPU every frame through the returned stream.
+			//texelSize - size of a single texel of desc.Format in bytes
+			TextureStream* AddDynamicTexture(const DxDevice& device, const std::string& name, const directx::tex2d_info& desc,
+				size_t texelSize, UploadMode mode = UploadMode::StagingRing, size_t ringSize = TextureStream::DefaultRingSize);
 
 			void AddSemanticVariable(const std::string& name, VariableSemantic semantic);
 
@@ -95,13 +101,17 @@ namespace mini
 
 			const dx_ptr<ID3D11ShaderResourceView>& GetTexture(const std::string& name) const;
 
-			const RenderTargetsEffect& GetRenderTarget(const std::string& name) const;
+			TextureStream* GetDynamicTexture(const std::string& name) const;
 
+			//Semantic variables returned by this function are marked as read, the ones never looked up aren't computed
 			const ICBVariable* GetVariable(const std::string& name) const
 			{
 				auto it = m_variableNames.find(name);
 				if (it == m_variableNames.end())
 					return nullptr;
+				auto semantic = m_semanticNames.find(name);
+				if (semantic != m_semanticNames.end())
+					m_semantics.MarkRead(semantic->second);
 				return it->second;
 			}
 
@@ -115,228 +125,64 @@ namespace mini
 				}
 			}
 
-		private:
-			using semantic_map_t = std::map<VariableSemantic, std::unique_ptr<ICBVariable>>;
-			using semantic_map_iterator = semantic_map_t::iterator;
-
-			template<typename T, VariableSemantic semantic>
-			CBVariable<T>& _getSemanticVariable()
-			{
-				auto it = m_semanticVariables.find(semantic);
-				assert(it!= m_semanticVariables.end());
-				ICBVariable& var = *it->second;
-				assert(typeid(var) == typeid(CBVariable<T>));
-				return static_cast<CBVariable<T>&>(var);
-			}
-
-			static constexpr bool _isMatrixSemantic(VariableSemantic semantic)
-			{
-				return (semantic >= VariableSemantic::MatV && semantic <= VariableSemantic::MatVInvT) ||
-					(semantic >= VariableSemantic::MatVP && semantic <= VariableSemantic::MatPInvT) ||
-					(semantic >= VariableSemantic::MatM && semantic <= VariableSemantic::MatMVPInvT);
-			}
-
-			static constexpr bool _isVec4Semantic(VariableSemantic semantic)
-			{
-				return semantic >= VariableSemantic::Vec4CamPos && semantic <= VariableSemantic::Vec4CamUp;
-			}
-
-			static constexpr bool _isFloatSemantic(VariableSemantic semantic)
-			{
-				return (semantic >= VariableSemantic::FloatFOV && semantic <= VariableSemantic::FloatFarPlane) ||
-					(semantic >= VariableSemantic::FloatDT && semantic <= VariableSemantic::FloatTotalFrames);
-			}
-
-			static constexpr bool _isVec2Semantic(VariableSemantic semantic)
-			{
-				return semantic == VariableSemantic::Vec2ViewportDims;
-			}
-
-			template<typename T>
-			CBVariable<T>* _addSemanticVariable(VariableSemantic semantic)
-			{
-				auto uPtr = std::make_unique<CBVariable<T>>();
-				auto result = uPtr.get();
-				m_semanticVariables.emplace(semantic, std::move(uPtr));
-				return result;
-			}
-
-			CBVariable<DirectX::XMFLOAT4X4>* _addSemanticMatrixVariable(VariableSemantic semantic);
-
-			ICBVariable* _addSemanticVariable(VariableSemantic semantic);
-
-			ICBVariable* _addOrGetSemanticVariable(VariableSemantic semantic);
-
-			static constexpr VariableSemantic _semanticOffset(VariableSemantic semantic, int offset)
-			{
-				return static_cast<VariableSemantic>(static_cast<int>(semantic) + offset);
-			}
-			static constexpr VariableSemantic _semanticMT(VariableSemantic m) { return _semanticOffset(m, 1); }
-			static constexpr VariableSemantic _semanticMI(VariableSemantic m) { return _semanticOffset(m, 2); }
-			static constexpr VariableSemantic _semanticMIT(VariableSemantic m) { return _semanticOffset(m, 3); }
-
-			static void _updateMatrix(CBVariable<DirectX::XMFLOAT4X4>& var, const DirectX::XMMATRIX& m)
-			{
-				XMStoreFloat4x4(&var.value, m);
-			}
-			static void _updateMatrix(ICBVariable& var, const DirectX::XMMATRIX& m)
-			{
-				assert(typeid(var) == typeid(CBVariable<DirectX::XMFLOAT4X4>));
-				_updateMatrix(static_cast<CBVariable<DirectX::XMFLOAT4X4>&>(var), m);
-			}
-			static void _updateVec4(CBVariable<DirectX::XMFLOAT4>& var, const DirectX::XMVECTOR& v)
-			{
-				XMStoreFloat4(&var.value, v);
-			}
-			static void _updateVec4(ICBVariable& var, const DirectX::XMVECTOR& v)
-			{
-				assert(typeid(var) == typeid(CBVariable<DirectX::XMFLOAT4>));
-				_updateVec4(static_cast<CBVariable<DirectX::XMFLOAT4>&>(var), v);
-			}
-			static void _updateFloat(CBVariable<float>& var, float f)
-			{
-				var.value = f;
-			}
-			static void _updateFloat(ICBVariable& var, float f)
-			{
-				assert(typeid(var) == typeid(CBVariable<float>));
-				_updateFloat(static_cast<CBVariable<float>&>(var), f);
-			}
-
-			static void _incrementFloat(CBVariable<float>& var, float df = 1)
-			{
-				var.value += df;
-			}
-
-			static void _incrementFloat(ICBVariable& var, float df = 1)
-			{
-				assert(typeid(var) == typeid(CBVariable<float>));
-				_incrementFloat(static_cast<CBVariable<float>&>(var), df);
-			}
-
-			static void _updateVec2(CBVariable<DirectX::XMFLOAT2>& var, const DirectX::XMFLOAT2& v)
-			{
-				var.value = v;
-			}
-
-			static void _updateVec2(ICBVariable& var, const DirectX::XMFLOAT2& v)
-			{
-				assert(typeid(var) == typeid(CBVariable<DirectX::XMFLOAT2>));
-				_updateVec2(static_cast<CBVariable<DirectX::XMFLOAT2>&>(var), v);
-			}
-
-			template<VariableSemantic semantic>
-			bool _updateVec2(semantic_map_iterator& it, const DirectX::XMFLOAT2& v)
-			{
-				static_assert(semantic == VariableSemantic::Vec2ViewportDims, "Invalid vec2 semantic");
-				if (it->first == semantic)
-				{
-					_updateVec2(*(it++)->second, v);
-					return it != m_semanticVariables.end();
-				}
-				return true;
-			}
-
-			template<VariableSemantic semantic>
-			bool _updateFloat(semantic_map_iterator& it, float f)
+			//Resolves the variables of a buffer once. The plan reads them (and their versions) at their current
+			//addresses, so it only sees variables added before it was compiled.
+			//model - if not null, model related semantics are read from this table instead of the shared one
+			CBufferPlan CompileCBuffer(const CBufferDesc& bufferDesc, const SemanticTable* model = nullptr) const
 			{
-				static_assert(semantic == VariableSemantic::FloatDT || semantic == VariableSemantic::FloatFOV ||
-					semantic == VariableSemantic::FloatFPS || semantic == VariableSemantic::FloatFarPlane ||
-					semantic == VariableSemantic::FloatNearPlane, "Invalid float semantic");
-				if (it->first == semantic)
+				CBufferPlan plan(bufferDesc.size);
+				for (auto& desc : bufferDesc.variables)
 				{
-					_updateFloat(*(it++)->second, f);
-					return it != m_semanticVariables.end();
-				}
-				return true;
-			}
-
-			template<VariableSemantic semantic>
-			bool _incrementFloat(semantic_map_iterator& it, float df = 1)
-			{
-				static_assert(semantic == VariableSemantic::FloatT ||
-					semantic == VariableSemantic::FloatTotalFrames, "Invalid float semantic");
-				if (it->first == semantic)
-				{
-					_incrementFloat(*(it++)->second, df);
-					return it != m_semanticVariables.end();
-				}
-				return true;
-			}
-
-			template<VariableSemantic semantic>
-			bool _updateVec4(semantic_map_iterator& it, const DirectX::XMVECTOR& v)
-			{
-				static_assert(semantic == VariableSemantic::Vec4CamPos || semantic == VariableSemantic::Vec4CamDir ||
-					semantic == VariableSemantic::Vec4CamRight || semantic == VariableSemantic::Vec4CamUp, "Invalid vec4 semantic");
-				if (it->first == semantic)
-				{
-					_updateVec4(*(it++)->second, v);
-					return it != m_semanticVariables.end();
-				}
-				return true;
-			}
-
-			template<VariableSemantic semantic>
-			bool _updateMatrix(semantic_map_iterator& it, const DirectX::XMMATRIX& m)
-			{
-				if (it->first == semantic)
-				{
-					_updateMatrix(*(it++)->second, m);
-					return it != m_semanticVariables.end();
-				}
-				return true;
-			}
-
-			template<VariableSemantic semantic>
-			bool _update_M_MT(semantic_map_iterator& it, const DirectX::XMMATRIX& m)
-			{
-				static_assert(semantic == VariableSemantic::MatV || semantic == VariableSemantic::MatVInv ||
-					semantic == VariableSemantic::MatVP || semantic == VariableSemantic::MatVPInv ||
-					semantic == VariableSemantic::MatP || semantic == VariableSemantic::MatPInv ||
-					semantic == VariableSemantic::MatM || semantic == VariableSemantic::MatMInv ||
-					semantic == VariableSemantic::MatMV || semantic == VariableSemantic::MatMVInv ||
-					semantic == VariableSemantic::MatMVP || semantic == VariableSemantic::MatMVPInv, "Invalid matrix semantic");
-				if (!_updateMatrix<semantic>(it, m))
-					return false;
-				if (it->first == _semanticMT(semantic))
-				{
-					_updateMatrix(*(it++)->second, XMMatrixTranspose(m));
-					return it != m_semanticVariables.end();
+					auto varPtr = GetVariable(desc.name);
+					if (!varPtr) continue;
+					auto semantic = m_semanticNames.find(desc.name);
+					if (model && semantic != m_semanticNames.end() &&
+						gk2::GetUpdateFrequency(semantic->second) == UpdateFrequency::PerObject)
+					{
+						const VariableSemantic s = semantic->second;
+						assert(desc.size >= SemanticTable::Size(s));
+						model->MarkRead(s);
+						plan.Add(model->Data(s), desc.offset, SemanticTable::Size(s));
+						plan.AddVersion(&model->Version(s));
+						continue;
+					}
+					varPtr->addToPlan(plan, desc.offset, desc.size);
+					plan.AddVersion(&varPtr->version());
 				}
-				return true;
+				return plan;
 			}
 
-			template<VariableSemantic semantic>
-			bool _update_MI_MIT(semantic_map_iterator& it, const DirectX::XMMATRIX& m)
+			//Frequency of the most often changing variable of a buffer. Variables without a semantic
+			//are set by the application between frames, they are treated as constant throughout a pass.
+			UpdateFrequency GetUpdateFrequency(const CBufferDesc& bufferDesc) const
 			{
-				static_assert(semantic == VariableSemantic::MatV || semantic == VariableSemantic::MatVP ||
-					semantic == VariableSemantic::MatP || semantic == VariableSemantic::MatM ||
-					semantic == VariableSemantic::MatMV || semantic == VariableSemantic::MatMVP, "Invalid matrix semantic");
-				if (it->first <= _semanticMIT(semantic))
+				UpdateFrequency result = UpdateFrequency::PerPass;
+				for (auto& desc : bufferDesc.variables)
 				{
-					DirectX::XMVECTOR det;
-					return _update_M_MT<_semanticMI(semantic)>(it, XMMatrixInverse(&det, m));
+					auto it = m_semanticNames.find(desc.name);
+					if (it != m_semanticNames.end())
+						result = std::max(result, gk2::GetUpdateFrequency(it->second));
 				}
-				return true;
+				return result;
 			}
 
-			template<VariableSemantic semantic>
-			bool _update_M_MT_MI_MIT(semantic_map_iterator& it, const DirectX::XMMATRIX& m)
+		private:
+			static void _store(const DirectX::XMMATRIX& m, Float4x4& out)
 			{
-				return _update_M_MT<semantic>(it, m) && /*will not execute if first returns false*/ _update_MI_MIT<semantic>(it, m);
+				XMStoreFloat4x4(reinterpret_cast<DirectX::XMFLOAT4X4*>(&out), m);
 			}
+			void _setViewport(const ViewFrustrum& frustrum);
 
-			bool _updateView(semantic_map_iterator& it, const DirectX::XMMATRIX& viewMtx);
-			bool _updateFrustrum(semantic_map_iterator& it, const ViewFrustrum& frustrum);
-
-			semantic_map_t m_semanticVariables;
+			SemanticTable m_semantics;
+			//wrappers of the table slots, created for the semantics added by name
+			std::unique_ptr<SemanticVariable> m_semanticVariables[SemanticTable::Count];
 			std::vector<std::unique_ptr<ICBVariable>> m_constantVariables;
 			std::vector<std::unique_ptr<IGUIVariable>> m_guiVariables;
 			std::map<std::string, dx_ptr<ID3D11SamplerState>> m_samplers;
 			std::map<std::string, dx_ptr<ID3D11ShaderResourceView>> m_textures;
+			std::map<std::string, std::unique_ptr<TextureStream>> m_dynamicTextures;
 			std::map<std::string, ICBVariable*> m_variableNames;
-			std::map<std::string, RenderTargetsEffect> m_renderTargets;
+			std::map<std::string, VariableSemantic> m_semanticNames;
 		};
 	}
 }
@@ -1,4 +1,5 @@
 #include "duck.h"
+#include <sstream>
 
 using namespace mini;
 using namespace gk2;
@@ -7,7 +8,29 @@ using namespace std;
 using namespace directx;
 using namespace utils;
 
-Duck::Duck(HINSTANCE hInst): DuckBase(hInst)
+namespace
+{
+	//NFF description of size x size quads spanning [-1, 1] in local x and z, facing up
+	string gridString(int size)
+	{
+		ostringstream s;
+		for (int i = 0; i < size; ++i)
+			for (int j = 0; j < size; ++j)
+			{
+				const float x0 = 2.0f * i / size - 1.0f, x1 = 2.0f * (i + 1) / size - 1.0f;
+				const float z0 = 2.0f * j / size - 1.0f, z1 = 2.0f * (j + 1) / size - 1.0f;
+				s << "pp 4\n" << x1 << " 0 " << z1 << " 0 1 0\n" << x1 << " 0 " << z0 << " 0 1 0\n"
+					<< x0 << " 0 " << z0 << " 0 1 0\n" << x0 << " 0 " << z1 << " 0 1 0\n";
+			}
+		return s.str();
+	}
+}
+
+Duck::Duck(HINSTANCE hInst, const filesystem::path& waterLog): DuckBase(hInst), m_water(WaterResolution), m_rain(WaterResolution),
+	m_duckPath({ -DuckRange, -DuckRange }, { DuckRange, DuckRange }), m_duckStepSpeed(DefaultDuckSpeed),
+	m_flock(FlockSize, { -DuckRange, -DuckRange }, { DuckRange, DuckRange }), m_flockInstances(FlockSize),
+	m_flockTransforms(FlockSize + 1),
+	m_scheduler(m_water.TimeStep(), MaxWaterStepsPerFrame, true)
 {
 	//Shader Variables
 	m_variables.AddSemanticVariable("modelMtx", VariableSemantic::MatM);
@@ -26,30 +49,117 @@ Duck::Duck(HINSTANCE hInst): DuckBase(hInst)
 	m_variables.AddGuiVariable("ka", 0.2f);
 	m_variables.AddGuiVariable("m", 1.f, 0.1f, 200.f);
 
-	m_variables.AddGuiVariable("waterLevel", -0.05f, -1, 1, 0.001f);
+	m_waterLevel = m_variables.AddGuiVariable("waterLevel", -0.05f, -1, 1, 0.001f);
+	m_rainRate = m_variables.AddGuiVariable("rainRate", RainSource::DefaultRate, 0, 5000, 10);
+	m_dropRadius = m_variables.AddGuiVariable("dropRadius", RainSource::DefaultRadius, 0.5f, 16, 0.1f);
+	m_dropAmplitude = m_variables.AddGuiVariable("dropAmplitude", RainSource::DefaultAmplitude, 0, 0.05f, 0.0005f);
+	m_duckSpeed = m_variables.AddGuiVariable("duckSpeed", m_duckStepSpeed, 0, 2, 0.01f);
 
 	//Models
 	XMFLOAT4X4 modelMtx;
-	auto quad = addModelFromString("pp 4\n1 0 1 0 1 0\n1 0 -1 0 1 0\n""-1 0 -1 0 1 0\n-1 0 1 0 1 0\n");
+	//vertices of the water grid are displaced by the height map
+	auto waterGrid = addModelFromString(gridString(WaterGridSize));
 	auto envModel = addModelFromString("hex 0 0 0 1.73205");
-	XMStoreFloat4x4(&modelMtx, XMMatrixScaling(20, 20, 20));
-	model(quad).applyTransform(modelMtx);
+	XMStoreFloat4x4(&modelMtx, XMMatrixScaling(SceneScale, SceneScale, SceneScale));
+	model(waterGrid).applyTransform(modelMtx);
 	model(envModel).applyTransform(modelMtx);
+	//body, head and beak, facing local x
+	auto duckModel = addModelFromString("s 0 0 0 1\ns 0.8 0.9 0 0.55\nc\n1.25 0.85 0 0.2\n1.7 0.8 0 0.02\n");
+	XMStoreFloat4x4(&modelMtx, XMMatrixScaling(DuckScale, DuckScale, DuckScale));
+	model(duckModel).applyTransform(modelMtx);
 
 
 	//Textures
 	m_variables.AddSampler(m_device, "samp");
 	m_variables.AddTexture(m_device, "envMap", L"textures/cubeMap.dds");
+	tex2d_info heightMapDesc(static_cast<UINT>(WaterResolution), static_cast<UINT>(WaterResolution), DXGI_FORMAT_R32_FLOAT, 1);
+	m_heightMap = m_variables.AddDynamicTexture(m_device, "heightMap", heightMapDesc, sizeof(float));
+	tex2d_info normalMapDesc(static_cast<UINT>(WaterResolution), static_cast<UINT>(WaterResolution), DXGI_FORMAT_R8G8B8A8_SNORM, 1);
+	m_normalMap = m_variables.AddDynamicTexture(m_device, "normalMap", normalMapDesc, sizeof(uint32_t));
+	m_water.EnableNormals(true);
+
+	//Simulation
+	m_water.SetImpulseQueue(&m_impulses);
+	if (!waterLog.empty())
+		m_recorder = make_unique<SimulationRecorder>(waterLog, m_water);
+	//GUI changes of the speed reach the duck between batches of steps, which may run on the scheduler thread
+	m_leadDuck = _duckPose();
+	m_scheduler.add_system([this](float dt) { _moveDuck(dt); }, [this] {
+		m_duckStepSpeed = m_duckSpeed->value;
+		m_leadDuck = _duckPose();
+	});
+	m_scheduler.add_system([this](float) {
+		m_water.Step(m_workers);
+		if (m_recorder)
+			m_recorder->RecordStep(m_water.TimeStep(), m_water.StepImpulses());
+	}, [this] { _uploadWater(); });
 
 	//Render Passes
 	auto passEnv = addPass(L"envVS.cso", L"envPS.cso");
 	addModelToPass(passEnv, envModel);
 	addRasterizerState(passEnv, rasterizer_info(true));
 
+	m_flockPass = addPass(L"duckVS.cso", L"duckPS.cso");
+	m_flockGroup = addInstancedModelToPass(m_flockPass, duckModel, FlockSize + 1);
+
 	auto passWater = addPass(L"waterVS.cso", L"waterPS.cso");
-	addModelToPass(passWater, quad);
+	addModelToPass(passWater, waterGrid);
 	rasterizer_info rs;
 	rs.CullMode = D3D11_CULL_NONE;
 	addRasterizerState(passWater, rs);
 
 }
+
+void Duck::update(utils::clock const& clock)
+{
+	DuckBase::update(clock);
+	//drops are queued here and applied by the water system at the start of its next step
+	m_rain.Generate(m_impulses, clock.frame_time(), m_rainRate->value, m_dropRadius->value, m_dropAmplitude->value);
+	m_scheduler.advance(clock.frame_time());
+	_moveFlock(clock.frame_time());
+}
+
+void Duck::_moveFlock(float dt)
+{
+	m_flock.Advance(FlockSpeed * dt, m_flockInstances.data());
+	//ducks turn around the vertical axis to face their direction and float at the water level
+	const float level = SceneScale * m_waterLevel->value;
+	//the duck leaving the wake is drawn after the flock
+	for (size_t i = 0; i <= FlockSize; ++i)
+	{
+		const PathInstance& d = i < FlockSize ? m_flockInstances[i] : m_leadDuck;
+		m_flockTransforms[i] = {
+			d.dx, 0.0f, d.dy, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			-d.dy, 0.0f, d.dx, 0.0f,
+			SceneScale * d.x, level, SceneScale * d.y, 1.0f };
+	}
+	pass(m_flockPass).SetInstances(m_flockGroup, m_flockTransforms.data(), FlockSize + 1);
+}
+
+PathInstance Duck::_duckPose() const
+{
+	const PathPoint p = m_duckPath.Position();
+	const PathPoint d = m_duckPath.Direction();
+	return { p.x, p.y, d.x, d.y };
+}
+
+void Duck::_moveDuck(float dt)
+{
+	m_duckPath.Advance(m_duckStepSpeed * dt);
+	//local coordinates of the water grid map to the whole simulation
+	const PathPoint p = m_duckPath.Position();
+	const float x = (p.x * 0.5f + 0.5f) * WaterResolution;
+	const float y = (p.y * 0.5f + 0.5f) * WaterResolution;
+	m_impulses.Push({ x, y, DuckWakeRadius, DuckWakeAmplitude });
+	if (m_recorder)
+		m_recorder->RecordDuck(x, y);
+}
+
+void Duck::_uploadWater()
+{
+	m_dirtyRects.clear();
+	m_water.TakeDirtyRects(m_dirtyRects);
+	m_heightMap->Upload(m_water.Heights(), m_water.RowPitch() * sizeof(float), m_dirtyRects);
+	m_normalMap->Upload(m_water.Normals(), WaterResolution * sizeof(uint32_t), m_dirtyRects);
+}
@@ -1,5 +1,12 @@
 #pragma once
 #include "duckBase.h"
+#include "waterSurface.h"
+#include "fixed_step_scheduler.h"
+#include "simulationLog.h"
+#include "bsplinePath.h"
+#include "pathFlock.h"
+#include <filesystem>
+#include <memory>
 
 namespace mini
 {
@@ -8,7 +15,62 @@ namespace mini
 		class Duck : public DuckBase
 		{
 		public:
-			explicit Duck(HINSTANCE hInst);
+			//waterLog - if not empty, input of the water simulation is recorded into this file
+			explicit Duck(HINSTANCE hInst, const std::filesystem::path& waterLog = {});
+
+		protected:
+			void update(utils::clock const& clock) override;
+
+		private:
+			static constexpr size_t WaterResolution = 256;
+			//quads along each side of the water grid, fewer than cells of the simulation
+			static constexpr int WaterGridSize = 128;
+			//upper limit of simulation steps per frame, so a long frame doesn't stall the application
+			static constexpr unsigned MaxWaterStepsPerFrame = 8;
+			//the duck swims inside this part of the pool, in local coordinates of the water grid
+			static constexpr float DuckRange = 0.75f;
+			static constexpr float DefaultDuckSpeed = 0.3f;
+			//wake left by the duck at every simulation step, radius in cells
+			static constexpr float DuckWakeRadius = 3.0f;
+			static constexpr float DuckWakeAmplitude = 0.002f;
+
+			//ducks swimming around the one leaving the wake, drawn as instances of a single model
+			static constexpr size_t FlockSize = 64;
+			static constexpr float FlockSpeed = 0.15f;
+			//scale of the water grid and the environment, and of the duck model
+			static constexpr float SceneScale = 20.0f;
+			static constexpr float DuckScale = 0.4f;
+
+			void _moveDuck(float dt);
+			void _moveFlock(float dt);
+			//position and direction of the duck leaving the wake
+			PathInstance _duckPose() const;
+			void _uploadWater();
+
+			WaterSurface m_water;
+			ImpulseQueue m_impulses;
+			RainSource m_rain;
+			GUIVariable<float>* m_rainRate;
+			GUIVariable<float>* m_dropRadius;
+			GUIVariable<float>* m_dropAmplitude;
+			BSplinePath m_duckPath;
+			//speed used by the simulation steps, copied from m_duckSpeed between batches of steps
+			float m_duckStepSpeed;
+			GUIVariable<float>* m_duckSpeed;
+			GUIVariable<float>* m_waterLevel;
+			PathFlock m_flock;
+			std::vector<PathInstance> m_flockInstances;
+			//pose of the duck leaving the wake, copied between batches of simulation steps
+			PathInstance m_leadDuck;
+			std::vector<DirectX::XMFLOAT4X4> m_flockTransforms;
+			size_t m_flockPass;
+			size_t m_flockGroup;
+			TextureStream* m_heightMap;
+			TextureStream* m_normalMap;
+			std::vector<WaterSurface::DirtyRect> m_dirtyRects;
+			std::unique_ptr<SimulationRecorder> m_recorder;
+			//declared last, so its worker thread stops before the systems it steps are destroyed
+			utils::fixed_step_scheduler m_scheduler;
 		};
 	}
 }
@@ -1,6 +1,7 @@
 #include "duckBase.h"
 #include "model.h"
 #include "windowsx.h"
+#include <cassert>
 
 using namespace std;
 using namespace DirectX;
@@ -19,6 +20,14 @@ public:
 		context->CopyResource(_getDestination(context).get(), _getSource(context).get());
 	}
 
+	//the source is the target bound when the list is executed, copying doesn't change the bound state
+	void Begin(CommandList& commands) const override
+	{
+		commands.Native([](const void* effect, void* context) {
+			static_cast<const CopyTextureEffectBase*>(effect)->Begin(*static_cast<const dx_ptr<ID3D11DeviceContext>*>(context));
+		}, this, false);
+	}
+
 protected:
 	virtual dx_ptr<ID3D11Resource> _getSource(const dx_ptr<ID3D11DeviceContext>& context) const = 0;
 	virtual dx_ptr<ID3D11Resource> _getDestination(const dx_ptr<ID3D11DeviceContext>& context) const = 0;
@@ -113,9 +122,13 @@ protected:
 };
 
 DuckBase::DuckBase(HINSTANCE hInst)
-	: dx_app(hInst, 1280, 720, L"Shader Demo"), m_loader(m_device), m_layouts(m_device), m_camera(0.01f, 50.0f, 5),
+	: dx_app(hInst, 1280, 720, L"Shader Demo"), m_loader(m_device), m_layouts(m_device), m_executor(m_device.context()), m_camera(0.01f, 50.0f, 5),
 	  m_frustrum(get_window().client_size(), XM_PIDIV4, 0.5f, 85.0f), m_gui(m_device, get_window())
 {
+	//the back buffer is never aliased, its format doesn't matter to the graph
+	const SIZE size = get_window().client_size();
+	m_windowTexture = m_graph.ImportTexture({ static_cast<uint32_t>(size.cx), static_cast<uint32_t>(size.cy),
+		DXGI_FORMAT_R8G8B8A8_UNORM });
 }
 
 std::optional<LRESULT> DuckBase::process_message(windows::message const &msg)
@@ -184,19 +197,74 @@ void DuckBase::update(utils::clock const &clock)
 	ImGui::Begin("Variables", nullptr,
 		ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize |
 		ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoSavedSettings);
-	m_variables.UpdateFrame(m_device.context(), clock);
+	m_variables.UpdateFrame(clock);
+	size_t draws = 0, culled = 0, instancedDraws = 0, instances = 0, culledInstances = 0;
+	CBufferStats uploads;
+	for (const auto& p : m_passes)
+	{
+		draws += p.DrawCount();
+		culled += p.CulledCount();
+		instancedDraws += p.InstancedDrawCount();
+		instances += p.InstanceCount();
+		culledInstances += p.CulledInstanceCount();
+		uploads.mapped += p.CBufferUploads().mapped;
+		uploads.skipped += p.CBufferUploads().skipped;
+	}
+	ImGui::Text("Draws: %zu (%zu culled)", draws - culled, culled);
+	ImGui::Text("Instanced draws: %zu, instances: %zu (%zu culled)", instancedDraws, instances, culledInstances);
+	ImGui::Text("Constant buffer maps: %zu (%zu skipped)", uploads.mapped, uploads.skipped);
+	const StateCacheStats& state = m_executor.State().Stats();
+	size_t commands = m_commands.Size() + m_guiCommands.Size();
+	for (const CommandList& list : m_passCommands)
+		commands += list.Size();
+	ImGui::Text("Commands: %zu, state calls: %zu (%zu redundant skipped)", commands, state.issued, state.skipped);
+	ImGui::Text("Passes: %zu (%zu culled), render target textures: %zu", m_graph.PassCount(),
+		m_graph.PassCount() - m_graph.Order().size(), m_graph.PhysicalTextures().size());
 	ImGui::End();
 }
 
 void DuckBase::render()
 {
+	if (!m_graphCompiled)
+		_compileGraph();
+	m_commands.Clear();
 	auto& rt = window_target();
 	float clearColor[4] = { 0.5f, 0.5f, 1.0f, 0.0f };
-	rt.ClearRenderTargets(m_device.context(), clearColor);
-	rt.Begin(m_device.context());
-	for (auto& p : m_passes)
-		p.Execute(m_device.context(), m_variables);
-	m_gui.Render(m_device);
+	rt.ClearRenderTargets(m_commands, clearColor);
+	rt.Begin(m_commands);
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, m_camera.view_matrix() * m_frustrum.getProjectionMatrix());
+	const CullingFrustum frustum = ExtractFrustum(viewProj.m);
+	//draws are keyed by the position of their pass in the order of execution, culled passes aren't collected
+	const vector<uint32_t>& order = m_graph.Order();
+	m_queue.Clear();
+	for (size_t i = 0; i < order.size(); ++i)
+		m_passes[order[i]].Collect(m_queue, static_cast<uint32_t>(i), &frustum);
+	m_queue.Sort();
+	m_queue.PassRanges(order.size(), m_passDraws);
+	//Passes only read the variables and models while recording, each fills the constant buffers of its own
+	//effects from its own model semantics. Replayed in order, the lists bind the same state as a serial recording.
+	m_passCommands.resize(order.size());
+	m_workers.parallel_for(0, order.size(), 1, [this, &order](size_t first, size_t last) {
+		for (size_t i = first; i < last; ++i)
+		{
+			m_passCommands[i].Clear();
+			_recordSteps(m_passCommands[i], m_passSteps[i].first, m_passSteps[i].second);
+			//passes drawing to render targets may run before
+			if (m_windowPasses[order[i]])
+				window_target().Begin(m_passCommands[i]);
+			m_passes[order[i]].Execute(m_passCommands[i], m_variables, m_passDraws[i].first, m_passDraws[i].second);
+		}
+	});
+	m_guiCommands.Clear();
+	m_gui.Render(m_device, m_guiCommands);
+	//the cache is cleared once a frame, so that objects created at addresses of destroyed ones aren't taken for them
+	m_executor.State().Invalidate();
+	m_executor.State().ResetStats();
+	m_executor.Execute(m_commands);
+	for (const CommandList& commands : m_passCommands)
+		m_executor.Execute(commands);
+	m_executor.Execute(m_guiCommands);
 }
 
 size_t DuckBase::addModelFromFile(const std::string& path)
@@ -214,6 +282,7 @@ size_t DuckBase::addModelFromString(const std::string& model, bool smoothNormals
 size_t DuckBase::addPass(const std::wstring& vsShader, const std::wstring& psShader)
 {
 	m_passes.emplace_back(m_device, m_variables, &m_layouts, vsShader, psShader);
+	_addWindowPass();
 	return m_passes.size() - 1;
 }
 
@@ -221,23 +290,134 @@ size_t DuckBase::addPass(const std::wstring& vsShader, const std::wstring& gsSha
 	const std::wstring& psShader)
 {
 	m_passes.emplace_back(m_device, m_variables, &m_layouts, vsShader, gsShader, psShader);
+	_addWindowPass();
 	return m_passes.size() - 1;
 }
 
 size_t DuckBase::addPass(const std::wstring& vsShader, const std::wstring& psShader,
 	const std::string& renderTarget, bool clearRenderTarget)
 {
-	m_passes.emplace_back(m_device, m_variables, &m_layouts, m_variables.GetRenderTarget(renderTarget),
-		clearRenderTarget, vsShader, psShader);
+	const GraphTarget& target = m_renderTargets.at(renderTarget);
+	const FrameTextureDesc& desc = m_graph.Desc(target.color);
+	//views of the target are set once the graph assigns it memory, clears are steps of the graph
+	const SIZE size{ static_cast<LONG>(desc.width), static_cast<LONG>(desc.height) };
+	m_passes.emplace_back(m_device, m_variables, &m_layouts, RenderTargetsEffect{ directx::viewport{ size }, 1 },
+		vsShader, psShader);
+	const uint32_t graphPass = _addGraphPass(renderTarget);
+	const WriteMode mode = clearRenderTarget ? WriteMode::Clear : WriteMode::Load;
+	m_graph.Write(graphPass, target.color, mode);
+	m_graph.Write(graphPass, target.depth, mode);
 	return m_passes.size() - 1;
 }
 size_t DuckBase::addPass(const std::wstring& vsShader, const std::wstring& psShader,
 	const RenderTargetsEffect& renderTarget, bool clearRenderTarget)
 {
 	m_passes.emplace_back(m_device, m_variables, &m_layouts, renderTarget, clearRenderTarget, vsShader, psShader);
+	//the graph doesn't know who reads targets of the application
+	m_graph.KeepPass(_addGraphPass());
 	return m_passes.size() - 1;
 }
 
+void DuckBase::addRenderTarget(const std::string& name, const directx::tex2d_info& desc)
+{
+	const uint32_t color = m_graph.AddTexture({ desc.Width, desc.Height, static_cast<uint32_t>(desc.Format) });
+	const uint32_t depth = m_graph.AddTexture({ desc.Width, desc.Height, DXGI_FORMAT_D24_UNORM_S8_UINT });
+	m_renderTargets.emplace(name, GraphTarget{ color, depth });
+	m_variables.AddTextureName(name);
+}
+
+uint32_t DuckBase::_addGraphPass(const std::string& renderTarget)
+{
+	const uint32_t pass = m_graph.AddPass();
+	assert(pass == m_passes.size() - 1);
+	for (const std::string& name : m_passes[pass].TextureNames())
+		if (auto it = m_renderTargets.find(name); it != m_renderTargets.end())
+			m_graph.Read(pass, it->second.color);
+	m_passTargets.push_back(renderTarget);
+	m_windowPasses.push_back(false);
+	m_graphCompiled = false;
+	return pass;
+}
+
+void DuckBase::_addWindowPass()
+{
+	const uint32_t pass = _addGraphPass();
+	m_graph.Write(pass, m_windowTexture);
+	m_windowPasses[pass] = true;
+}
+
+void DuckBase::_compileGraph()
+{
+	m_graph.Compile();
+	//draws are split between the executed passes by the pass field of their sort keys
+	if (m_graph.Order().size() > drawKey::MaxPasses)
+		throw utils::custom_error{ L"Too many render passes to tell their draws apart" };
+	m_graphTextures.clear();
+	for (const FrameTextureDesc& desc : m_graph.PhysicalTextures())
+	{
+		GraphTexture texture;
+		directx::tex2d_info info(desc.width, desc.height, static_cast<DXGI_FORMAT>(desc.format), 1);
+		if (desc.format == DXGI_FORMAT_D24_UNORM_S8_UINT)
+		{
+			info.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+			texture.texture = m_device.CreateTexture(info);
+			texture.depthStencil = m_device.CreateDepthStencilView(texture.texture);
+		}
+		else
+		{
+			info.BindFlags |= D3D11_BIND_RENDER_TARGET;
+			texture.texture = m_device.CreateTexture(info);
+			texture.view = m_device.CreateShaderResourceView(texture.texture);
+			texture.renderTarget = m_device.CreateRenderTargetView(texture.texture);
+		}
+		m_graphTextures.push_back(move(texture));
+	}
+	for (uint32_t pass : m_graph.Order())
+	{
+		RenderPass& p = m_passes[pass];
+		for (const std::string& name : p.TextureNames())
+			if (auto it = m_renderTargets.find(name); it != m_renderTargets.end())
+				p.SetTexture(name, m_graphTextures[m_graph.Physical(m_graph.ReadTexture(pass, it->second.color))].view);
+		if (m_passTargets[pass].empty())
+			continue;
+		const GraphTarget& target = m_renderTargets.at(m_passTargets[pass]);
+		const FrameTextureDesc& desc = m_graph.Desc(target.color);
+		const SIZE size{ static_cast<LONG>(desc.width), static_cast<LONG>(desc.height) };
+		p.SetRenderTarget(RenderTargetsEffect{ directx::viewport{ size },
+			directx::clone(m_graphTextures[m_graph.Physical(target.depth)].depthStencil),
+			directx::clone(m_graphTextures[m_graph.Physical(target.color)].renderTarget) });
+	}
+	//steps preceding each pass end with the pass itself
+	m_passSteps.clear();
+	const vector<FrameStep>& steps = m_graph.Steps();
+	size_t first = 0;
+	for (size_t i = 0; i < steps.size(); ++i)
+		if (steps[i].type == FrameStepType::Pass)
+		{
+			m_passSteps.emplace_back(first, i);
+			first = i + 1;
+		}
+	m_graphCompiled = true;
+}
+
+void DuckBase::_recordSteps(CommandList& commands, size_t first, size_t last) const
+{
+	static constexpr float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	//the window is only drawn to, so only render targets of the graph are cleared or copied
+	const vector<FrameStep>& steps = m_graph.Steps();
+	for (size_t i = first; i < last; ++i)
+	{
+		const FrameStep& step = steps[i];
+		const GraphTexture& texture = m_graphTextures[m_graph.Physical(step.index)];
+		if (step.type == FrameStepType::Copy)
+			commands.CopyResource(texture.texture.get(), m_graphTextures[m_graph.Physical(step.source)].texture.get());
+		else if (texture.depthStencil)
+			commands.ClearDepthStencil(texture.depthStencil.get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+		else
+			commands.ClearRenderTarget(texture.renderTarget.get(), clearColor);
+	}
+}
+
 void DuckBase::addRasterizerState(size_t passId, const directx::rasterizer_info& desc)
 {
 	m_passes[passId].AddEffect(make_unique<RasterizerEffect>(m_device.CreateRasterizerState(desc)));
@@ -248,12 +428,29 @@ void DuckBase::addModelToPass(size_t passId, size_t modelId)
 	m_passes[passId].AddModel(m_models[modelId].get());
 }
 
+size_t DuckBase::addInstancedModelToPass(size_t passId, size_t modelId, size_t maxInstances)
+{
+	return m_passes[passId].AddInstancedModel(m_device, m_models[modelId].get(), maxInstances);
+}
+
 void DuckBase::copyRenderTarget(size_t passId, std::string dstTexture)
 {
+	_keepCopyingPass(passId, dstTexture);
 	pass(passId).EmplaceEffect<CopyRenderTargetEffect>(m_variables.GetTexture(dstTexture));
 }
 
 void DuckBase::copyDepthBuffer(size_t passId, std::string dstTexture)
 {
+	_keepCopyingPass(passId, dstTexture);
 	pass(passId).EmplaceEffect<CopyDephtBufferEffect>(m_variables.GetTexture(dstTexture));
 }
+
+void DuckBase::_keepCopyingPass(size_t passId, const std::string& dstTexture)
+{
+	//render targets of the graph have no textures of their own until it is compiled, passes read them directly
+	if (m_renderTargets.count(dstTexture))
+		throw utils::custom_error{ L"Render targets of the frame graph can't be copied into" };
+	//the copy is read outside of the graph, so the pass has to be kept even if nothing reads its target
+	m_graph.KeepPass(static_cast<uint32_t>(passId));
+	m_graphCompiled = false;
+}
@@ -6,6 +6,10 @@
 #include "viewFrustrum.h"
 #include "guiRenderer.h"
 #include "modelLoader.h"
+#include "dxCommandExecutor.h"
+#include "thread_pool.h"
+#include "frameGraph.h"
+#include <map>
 
 namespace mini
 {
@@ -34,6 +38,15 @@ namespace mini
 			size_t addPass(const std::wstring& vsShader, const std::wstring& psShader,
 				const RenderTargetsEffect& renderTarget, bool clearRenderTarget = false);
 			void addRasterizerState(size_t passId, const directx::rasterizer_info& desc);
+			//Adds a render target passes draw to and read by its name, with a depth buffer of the same size. Passes drawing
+			//to it are culled if nothing drawn to the window reads it. Its color and depth buffers are textures of
+			//the frame graph: cleared before their first use in a frame, sharing memory with other render targets
+			//not used at the same time. Only size and format of desc are used.
+			void addRenderTarget(const std::string& name, const directx::tex2d_info& desc);
+			void addRenderTarget(const std::string& name, SIZE size)
+			{
+				addRenderTarget(name, directx::tex2d_info(static_cast<UINT>(size.cx), static_cast<UINT>(size.cy)));
+			}
 
 			Model& model(size_t modelId) { return *m_models[modelId]; }
 			const Model& model(size_t modelId) const { return *m_models[modelId]; }
@@ -42,20 +55,76 @@ namespace mini
 			const RenderPass& pass(size_t passId) const { return m_passes[passId]; }
 
 			void addModelToPass(size_t passId, size_t modelId);
+			//returns the instance group of the pass, see RenderPass::SetInstances
+			size_t addInstancedModelToPass(size_t passId, size_t modelId, size_t maxInstances);
 
+			//The pass copies its render target or depth buffer into texture dstTexture, which can't be a render target
+			//added with addRenderTarget. Passes copying are never culled.
 			void copyRenderTarget(size_t passId, std::string dstTexture);
 			void copyDepthBuffer(size_t passId, std::string dstTexture);
 
 			CBVariableManager m_variables;
+			//records render passes in parallel, shared with other per frame work of derived applications
+			utils::thread_pool m_workers;
 
 		private:
 			static constexpr float ROTATION_SPEED = 0.01f;
 			static constexpr float ZOOM_SPEED = 0.02f;
 
+			//textures of the frame graph holding a render target added by addRenderTarget
+			struct GraphTarget
+			{
+				uint32_t color;
+				uint32_t depth;
+			};
+
+			//physical texture of the frame graph and its views, depth buffers have no shader resource view
+			struct GraphTexture
+			{
+				directx::dx_ptr<ID3D11Texture2D> texture;
+				directx::dx_ptr<ID3D11ShaderResourceView> view;
+				directx::dx_ptr<ID3D11RenderTargetView> renderTarget;
+				directx::dx_ptr<ID3D11DepthStencilView> depthStencil;
+			};
+
+			//adds the pass last added to the graph, reading the render targets its shaders read
+			uint32_t _addGraphPass(const std::string& renderTarget = {});
+			//adds the pass last added to the graph, drawing to the window
+			void _addWindowPass();
+			//rejects copies into render targets of the graph and keeps the copying pass from being culled
+			void _keepCopyingPass(size_t passId, const std::string& dstTexture);
+			//compiles the graph, creates its textures and binds them to the passes
+			void _compileGraph();
+			//records clears and copies [first, last) of the steps of the graph
+			void _recordSteps(CommandList& commands, size_t first, size_t last) const;
+
 			ModelLoader m_loader;
 			std::vector<std::unique_ptr<Model>> m_models;
 			std::vector<RenderPass> m_passes;
 			InputLayoutManager m_layouts;
+			//Passes and render targets, compiled on the first frame after a pass is added. Pass i of the graph is
+			//m_passes[i], passes without render targets draw to the window, imported to the graph.
+			FrameGraph m_graph;
+			uint32_t m_windowTexture;
+			std::map<std::string, GraphTarget> m_renderTargets;
+			//render target of each pass, empty for passes drawing to the window or to targets of the application
+			std::vector<std::string> m_passTargets;
+			std::vector<bool> m_windowPasses;
+			std::vector<GraphTexture> m_graphTextures;
+			//clears and copies of the graph recorded before each pass, in the order of execution
+			std::vector<std::pair<size_t, size_t>> m_passSteps;
+			bool m_graphCompiled = false;
+			//Commands of the frame, recorded by render and executed at its end in this order: clear of the window
+			//target, commands of every pass kept by the graph in its order, each recorded into its own list on
+			//a worker thread after the clears and copies preceding the pass, and the GUI.
+			CommandList m_commands;
+			std::vector<CommandList> m_passCommands;
+			CommandList m_guiCommands;
+			//draws of each pass in the sorted queue, in the order of execution
+			std::vector<RenderQueue::Range> m_passDraws;
+			DxCommandExecutor m_executor;
+			//visible draws of all passes, submitted in the order of their sort keys
+			RenderQueue m_queue;
 			directx::orbit_camera m_camera;
 			ViewFrustrum m_frustrum;
 			GUIRenderer m_gui;
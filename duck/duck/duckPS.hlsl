@@ -0,0 +1,26 @@
+float4 camPos;
+float4 lightPos;
+float3 lightColor;
+float3 surfaceColor;
+float ks, kd, ka, m;
+
+struct PSInput
+{
+    float4 pos : SV_POSITION;
+    float3 worldPos : POSITION0;
+    float3 norm : NORMAL0;
+};
+
+float4 main(PSInput i) : SV_TARGET
+{
+    float3 N = normalize(i.norm);
+    float3 V = normalize(camPos.xyz - i.worldPos);
+    float3 L = normalize(lightPos.xyz - i.worldPos);
+    float3 H = normalize(L + V);
+    
+    float3 color = surfaceColor * ka;
+    color += lightColor * surfaceColor * kd * saturate(dot(N, L));
+    color += lightColor * ks * pow(saturate(dot(N, H)), m);
+    color = pow(saturate(color), 0.4545f);
+    return float4(color, 1);
+}
@@ -0,0 +1,35 @@
+matrix modelMtx, modelInvTMtx, viewProjMtx;
+
+struct VSInput
+{
+    float3 pos : POSITION0;
+    float3 norm : NORMAL0;
+    //rows of the transform of the instance, applied after the model matrix
+    float4 instance0 : INSTANCE_TRANSFORM0;
+    float4 instance1 : INSTANCE_TRANSFORM1;
+    float4 instance2 : INSTANCE_TRANSFORM2;
+    float4 instance3 : INSTANCE_TRANSFORM3;
+};
+
+struct VSOutput
+{
+    float4 pos : SV_POSITION;
+    float3 worldPos : POSITION0;
+    float3 norm : NORMAL0;
+};
+
+VSOutput main(VSInput i)
+{
+    VSOutput o;
+    float4x4 instanceMtx = float4x4(i.instance0, i.instance1, i.instance2, i.instance3);
+    float4 p = mul(modelMtx, float4(i.pos, 1));
+    p = mul(p, instanceMtx);
+    o.worldPos = p.xyz;
+    o.pos = mul(viewProjMtx, p);
+    
+    //instances are only rotated and moved, so their transform keeps the normals perpendicular
+    float4 n = mul(modelInvTMtx, float4(i.norm, 0));
+    n = mul(n, instanceMtx);
+    o.norm = normalize(n.xyz);
+    return o;
+}
@@ -0,0 +1,69 @@
+#include "dxTextureUpload.h"
+#include "dxDevice.h"
+#include "exceptions.h"
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace directx;
+
+DxTextureUploadBackend::DxTextureUploadBackend(const DxDevice& device, const tex2d_info& desc, UploadMode mode,
+	size_t ringSize)
+	: m_context(device.context().get())
+{
+	tex2d_info textureDesc = desc;
+	if (mode == UploadMode::WriteDiscard)
+	{
+		textureDesc.Usage = D3D11_USAGE_DYNAMIC;
+		textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	}
+	else
+	{
+		textureDesc.Usage = D3D11_USAGE_DEFAULT;
+		textureDesc.CPUAccessFlags = 0;
+	}
+	m_texture = device.CreateTexture(textureDesc);
+	if (mode != UploadMode::StagingRing)
+		return;
+	tex2d_info stagingDesc = textureDesc;
+	stagingDesc.Usage = D3D11_USAGE_STAGING;
+	stagingDesc.BindFlags = 0;
+	stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	stagingDesc.MiscFlags = 0;
+	m_staging.reserve(ringSize);
+	for (size_t i = 0; i < ringSize; ++i)
+		m_staging.push_back(device.CreateTexture(stagingDesc));
+}
+
+D3D11_BOX DxTextureUploadBackend::_box(const TextureRect& rect)
+{
+	D3D11_BOX box;
+	box.left = static_cast<UINT>(rect.x);
+	box.top = static_cast<UINT>(rect.y);
+	box.right = static_cast<UINT>(rect.x + rect.width);
+	box.bottom = static_cast<UINT>(rect.y + rect.height);
+	box.front = 0;
+	box.back = 1;
+	return box;
+}
+
+MappedTexture DxTextureUploadBackend::_map(ID3D11Texture2D* texture, D3D11_MAP mapType)
+{
+	D3D11_MAPPED_SUBRESOURCE resource;
+	auto hr = m_context->Map(texture, 0, mapType, 0, &resource);
+	if (FAILED(hr))
+		throw utils::winapi_error{ hr };
+	return { static_cast<unsigned char*>(resource.pData), resource.RowPitch };
+}
+
+void DxTextureUploadBackend::UpdateRegion(const TextureRect& rect, const void* src, size_t srcRowPitch)
+{
+	const D3D11_BOX box = _box(rect);
+	m_context->UpdateSubresource(m_texture.get(), 0, &box, src, static_cast<UINT>(srcRowPitch), 0);
+}
+
+void DxTextureUploadBackend::CopyStaging(size_t slot, const TextureRect& rect)
+{
+	const D3D11_BOX box = _box(rect);
+	m_context->CopySubresourceRegion(m_texture.get(), 0, box.left, box.top, 0, m_staging[slot].get(), 0, &box);
+}
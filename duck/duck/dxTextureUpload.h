@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include "textureUpload.h"
+#include "dxptr.h"
+#include "dxstructures.h"
+
+namespace mini
+{
+	class DxDevice;
+
+	namespace gk2
+	{
+		//Direct3D 11 implementation of texture streaming. Creates the texture (dynamic in WriteDiscard mode,
+		//default otherwise) and, in StagingRing mode, ringSize staging textures of the same size and format.
+		class DxTextureUploadBackend : public ITextureUploadBackend
+		{
+		public:
+			DxTextureUploadBackend(const DxDevice& device, const directx::tex2d_info& desc, UploadMode mode, size_t ringSize);
+
+			const directx::dx_ptr<ID3D11Texture2D>& Texture() const { return m_texture; }
+
+			void UpdateRegion(const TextureRect& rect, const void* src, size_t srcRowPitch) override;
+			MappedTexture MapDiscard() override { return _map(m_texture.get(), D3D11_MAP_WRITE_DISCARD); }
+			void UnmapDiscard() override { m_context->Unmap(m_texture.get(), 0); }
+			MappedTexture MapStaging(size_t slot) override { return _map(m_staging[slot].get(), D3D11_MAP_WRITE); }
+			void UnmapStaging(size_t slot) override { m_context->Unmap(m_staging[slot].get(), 0); }
+			void CopyStaging(size_t slot, const TextureRect& rect) override;
+
+		private:
+			static D3D11_BOX _box(const TextureRect& rect);
+			MappedTexture _map(ID3D11Texture2D* texture, D3D11_MAP mapType);
+
+			//owned by the device, which outlives all textures
+			ID3D11DeviceContext* m_context;
+			directx::dx_ptr<ID3D11Texture2D> m_texture;
+			std::vector<directx::dx_ptr<ID3D11Texture2D>> m_staging;
+		};
+	}
+}
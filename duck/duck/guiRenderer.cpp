@@ -152,7 +152,7 @@ void GUIRenderer::Update(float dt)
 	ImGui::NewFrame();
 }
 
-void GUIRenderer::Render(const DxDevice& device)
+void GUIRenderer::Render(const DxDevice& device, CommandList& commands)
 {
 	ImGui::Render();
 	ImDrawData* draw_data = ImGui::GetDrawData();
@@ -167,42 +167,46 @@ void GUIRenderer::Render(const DxDevice& device)
 		m_indexCount = draw_data->TotalIdxCount + 10000;
 		m_indexBuffer = device.CreateIndexBuffer<ImDrawIdx>(m_indexCount);
 	}
-	D3D11_MAPPED_SUBRESOURCE vtx_resource, idx_resource;
-	auto hr = device.context()->Map(m_vertexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &vtx_resource);
-	if (FAILED(hr))
-		throw winapi_error{ hr };
-	hr = device.context()->Map(m_indexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &idx_resource);
-	if (FAILED(hr))
-		throw winapi_error{ hr };
-	ImDrawVert* vtx_dst = reinterpret_cast<ImDrawVert*>(vtx_resource.pData);
-	ImDrawIdx* idx_dst = reinterpret_cast<ImDrawIdx*>(idx_resource.pData);
-	for (int n = 0; n < draw_data->CmdListsCount; n++)
+	//vertices and indices are written in place, each pointer is valid only until the next command
+	if (draw_data->TotalVtxCount > 0)
 	{
-		const ImDrawList* cmd_list = draw_data->CmdLists[n];
-		memcpy(vtx_dst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
-		memcpy(idx_dst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
-		vtx_dst += cmd_list->VtxBuffer.Size;
-		idx_dst += cmd_list->IdxBuffer.Size;
+		ImDrawVert* vtx_dst = static_cast<ImDrawVert*>(commands.UpdateBuffer(m_vertexBuffer.get(),
+			static_cast<uint32_t>(draw_data->TotalVtxCount * sizeof(ImDrawVert))));
+		for (int n = 0; n < draw_data->CmdListsCount; n++)
+		{
+			const ImDrawList* cmd_list = draw_data->CmdLists[n];
+			memcpy(vtx_dst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
+			vtx_dst += cmd_list->VtxBuffer.Size;
+		}
+	}
+	if (draw_data->TotalIdxCount > 0)
+	{
+		ImDrawIdx* idx_dst = static_cast<ImDrawIdx*>(commands.UpdateBuffer(m_indexBuffer.get(),
+			static_cast<uint32_t>(draw_data->TotalIdxCount * sizeof(ImDrawIdx))));
+		for (int n = 0; n < draw_data->CmdListsCount; n++)
+		{
+			const ImDrawList* cmd_list = draw_data->CmdLists[n];
+			memcpy(idx_dst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+			idx_dst += cmd_list->IdxBuffer.Size;
+		}
 	}
-	device.context()->Unmap(m_vertexBuffer.get(), 0);
-	device.context()->Unmap(m_indexBuffer.get(), 0);
 
-	device.context()->IASetInputLayout(m_layout.get());
+	commands.SetInputLayout(m_layout.get());
 	ID3D11Buffer* tmp = m_vertexBuffer.get();
 	unsigned stride = sizeof(ImDrawVert), offset = 0;
-	device.context()->IASetVertexBuffers(0, 1, &tmp, &stride, &offset);
+	commands.SetVertexBuffers(0, 1, &tmp, &stride, &offset);
 	constexpr auto format = sizeof(ImDrawIdx) == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
-	device.context()->IASetIndexBuffer(m_indexBuffer.get(), format, 0);
-	device.context()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	device.context()->VSSetShader(m_vs.get(), nullptr, 0);
+	commands.SetIndexBuffer(m_indexBuffer.get(), format, 0);
+	commands.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commands.SetShader(ShaderStage::VS, m_vs.get());
 	tmp = m_cbProj;
-	device.context()->VSSetConstantBuffers(0, 1, &tmp);
-	device.context()->PSSetShader(m_ps.get(), nullptr, 0);
+	commands.SetConstantBuffers(ShaderStage::VS, 0, 1, &tmp);
+	commands.SetShader(ShaderStage::PS, m_ps.get());
 	ID3D11SamplerState* tmps = m_sampler.get();
-	device.context()->PSSetSamplers(0, 1, &tmps);
-	device.context()->OMSetBlendState(m_bs.get(), nullptr, 0xffffffff);
-	device.context()->OMSetDepthStencilState(m_dss.get(), 0);
-	device.context()->RSSetState(m_rs.get());
+	commands.SetSamplers(ShaderStage::PS, 0, 1, &tmps);
+	commands.SetBlendState(m_bs.get(), nullptr, 0xffffffff);
+	commands.SetDepthStencilState(m_dss.get(), 0);
+	commands.SetRasterizerState(m_rs.get());
 
 	int vtx_offset = 0;
 	int idx_offset = 0;
@@ -220,13 +224,13 @@ void GUIRenderer::Render(const DxDevice& device)
 			{
 				const D3D11_RECT r = { static_cast<LONG>(pcmd->ClipRect.x), static_cast<LONG>(pcmd->ClipRect.y),
 					static_cast<LONG>(pcmd->ClipRect.z), static_cast<LONG>(pcmd->ClipRect.w) };
-				device.context()->PSSetShaderResources(0, 1, reinterpret_cast<ID3D11ShaderResourceView* const*>(&pcmd->TextureId));
-				device.context()->RSSetScissorRects(1, &r);
-				device.context()->DrawIndexed(pcmd->ElemCount, idx_offset, vtx_offset);
+				commands.SetShaderResources(ShaderStage::PS, 0, 1, reinterpret_cast<ID3D11ShaderResourceView* const*>(&pcmd->TextureId));
+				commands.SetScissorRects(1, &r);
+				commands.DrawIndexed(pcmd->ElemCount, idx_offset, vtx_offset);
 			}
 			idx_offset += pcmd->ElemCount;
 		}
 		vtx_offset += cmd_list->VtxBuffer.Size;
 	}
-	device.context()->ClearState();
+	commands.ClearState();
 }
@@ -23,7 +23,9 @@ namespace mini
 
 			void Update(float dt);
 
-			void Render(const DxDevice& device);
+			//Records drawing of the GUI, buffers too small for it are recreated on the device.
+			//User callbacks of the draw lists are called while recording.
+			void Render(const DxDevice& device, CommandList& commands);
 
 		private:
 			dx_ptr<ID3D11VertexShader> m_vs;
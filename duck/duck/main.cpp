@@ -1,6 +1,7 @@
 ﻿#include "exceptions.h"
 #include "cbVariable.h"
 #include "duck.h"
+#include <shellapi.h>
 
 using namespace std;
 using namespace mini;
@@ -17,7 +18,17 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE , _In_ LPWSTR,
 			throw utils::winapi_error{ hr };
 		if (!SetProcessDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2))
 			throw utils::winapi_error{ };
-		gk2::Duck app(hInstance);
+		//"--record <file>" records the input of the water simulation, to be replayed headless by DuckBench
+		std::wstring waterLog;
+		int argc;
+		LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+		if (!argv)
+			throw utils::winapi_error{ };
+		for (int i = 1; i + 1 < argc; ++i)
+			if (wcscmp(argv[i], L"--record") == 0)
+				waterLog = argv[i + 1];
+		LocalFree(argv);
+		gk2::Duck app(hInstance, waterLog);
 
 		exit_code = app.run(cmdShow);
 	}
@@ -59,8 +59,10 @@ Model ModelLoader::convertToModel(const aiScene* scene, InputLayoutManager& layo
 	assert(scene->HasMeshes());
 	vector<Mesh> meshes;
 	vector<size_t> meshSignatures;
+	vector<MeshBounds> meshBounds;
 	meshes.reserve(scene->mNumMeshes);
 	meshSignatures.reserve(scene->mNumMeshes);
+	meshBounds.reserve(scene->mNumMeshes);
 	for (auto ppMesh = scene->mMeshes; ppMesh < scene->mMeshes + scene->mNumMeshes; ++ppMesh)
 	{
 		auto pAIMesh = *ppMesh;
@@ -105,13 +107,19 @@ Model ModelLoader::convertToModel(const aiScene* scene, InputLayoutManager& layo
 		meshes.emplace_back(move(vertexBuffers), std::move(vbStrides), m_device.CreateIndexBuffer(indices),
 			static_cast<unsigned int>(indices.size()));
 		meshSignatures.push_back(layouts.registerVertexAttributesID(move(bufferElements)));
+		//bounding volumes for culling
+		static_assert(sizeof(aiVector3D) == sizeof(XMFLOAT3));
+		auto positions = reinterpret_cast<const XMFLOAT3*>(pAIMesh->mVertices);
+		MeshBounds& bounds = meshBounds.emplace_back();
+		BoundingBox::CreateFromPoints(bounds.box, pAIMesh->mNumVertices, positions, sizeof(aiVector3D));
+		BoundingSphere::CreateFromPoints(bounds.sphere, pAIMesh->mNumVertices, positions, sizeof(aiVector3D));
 	}
 	vector<ModelNode> nodes;
 	//there should be at least as many nodes as there are meshes, so that number is a good first approximation
 	//of the number of nodes
 	nodes.reserve(scene->mNumMeshes);
 	addNode(nodes, scene->mRootNode);
-	return Model(move(meshes), move(meshSignatures), move(nodes));
+	return Model(move(meshes), move(meshSignatures), move(nodes), move(meshBounds));
 }
 
 Model ModelLoader::LoadFromFile(const string& filename, InputLayoutManager& layouts, bool smoothNormals)
@@ -3,6 +3,8 @@
 #include <D3DCompiler.h>
 #include "spriteRenderer.h"
 #include "inputLayoutManager.h"
+#include <algorithm>
+#include <cassert>
 
 using namespace std;
 using namespace DirectX;
@@ -10,6 +12,24 @@ using namespace mini;
 using namespace gk2;
 using namespace directx;
 
+namespace
+{
+	//adds bounds of a mesh placed by world to the batch, center - if not null, receives the center of the sphere
+	uint32_t addBounds(CullingBatch& batch, const MeshBounds& bounds, FXMMATRIX world, XMFLOAT3* center = nullptr)
+	{
+		BoundingSphere sphere;
+		bounds.sphere.Transform(sphere, world);
+		if (center)
+			*center = sphere.Center;
+		BoundingBox box;
+		bounds.box.Transform(box, world);
+		const XMFLOAT3 boxMin{ box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z };
+		const XMFLOAT3 boxMax{ box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z };
+		return batch.Add({ sphere.Center.x, sphere.Center.y, sphere.Center.z, sphere.Radius },
+			{ boxMin.x, boxMin.y, boxMin.z, boxMax.x, boxMax.y, boxMax.z });
+	}
+}
+
 void RenderPass::_initShaders(const DxDevice& device, const CBVariableManager& variables,
 	const wstring& vsShader, const wstring& psShader)
 {
@@ -21,9 +41,11 @@ void RenderPass::_initShaders(const DxDevice& device, const CBVariableManager& v
 	AddEffect(make_unique<BasicEffect>(move(vs), move(ps)));
 	D3D11_SHADER_DESC desc;
 	const auto vsRefl = _reflectShader(vsCode, desc);
-	_addShaderConstantBuffers<VSConstantBuffers>(device, vsRefl, desc);
+	_addShaderConstantBuffers<VSConstantBuffers>(device, variables, vsRefl, desc);
+	_addShaderSamplers<VSSamplers>(variables, vsRefl, desc);
+	_addShaderTextures<VSShaderResources>(variables, vsRefl, desc);
 	const auto psRefl = _reflectShader(psCode, desc);
-	_addShaderConstantBuffers<PSConstantBuffers>(device, psRefl, desc);
+	_addShaderConstantBuffers<PSConstantBuffers>(device, variables, psRefl, desc);
 	_addShaderSamplers<PSSamplers>(variables, psRefl, desc);
 	_addShaderTextures<PSShaderResources>(variables, psRefl, desc);
 }
@@ -37,7 +59,7 @@ void RenderPass::_initShaders(const DxDevice& device, const CBVariableManager& v
 	AddEffect(make_unique<GeometryShaderComponent>(move(gs)));
 	D3D11_SHADER_DESC desc;
 	auto gsRefl = _reflectShader(gsCode, desc);
-	_addShaderConstantBuffers<GSConstantBuffers>(device, gsRefl, desc);
+	_addShaderConstantBuffers<GSConstantBuffers>(device, variables, gsRefl, desc);
 }
 
 RenderPass::RenderPass(const DxDevice& device, const CBVariableManager& variables, InputLayoutManager* layouts,
@@ -58,6 +80,7 @@ void RenderPass::_addRenderTarget(const RenderTargetsEffect& renderTarget, bool
 {
 	auto rt = make_unique<RenderTargetsEffect>(renderTarget);
 	rt->SetClearOnBegin(clearRenderTarget);
+	m_renderTarget = rt.get();
 	AddEffect(move(rt));
 }
 
@@ -65,7 +88,9 @@ RenderPass::RenderPass(const DxDevice& device, const CBVariableManager& variable
 	const RenderTargetsEffect& renderTarget, bool clearRenderTarget, const wstring& vsShader, const wstring& psShader)
 	: m_layouts(layouts)
 {
-	AddEffect(RenderTargetsEffect{ renderTarget.getViewport(),renderTarget.m_buffers.size() });
+	auto unbind = make_unique<RenderTargetsEffect>(renderTarget.getViewport(), renderTarget.m_buffers.size());
+	m_unbindTarget = unbind.get();
+	AddEffect(move(unbind));
 	_initShaders(device, variables, vsShader, psShader);
 	_addRenderTarget(renderTarget, clearRenderTarget);
 }
@@ -75,7 +100,10 @@ RenderPass::RenderPass(const DxDevice& device, const CBVariableManager& variable
 	const wstring& vsShader, const wstring& gsShader, const wstring& psShader)
 	: m_layouts(layouts)
 {
-	AddEffect(RenderTargetsEffect{ renderTarget.getViewport(),nullptr, dx_ptr<ID3D11RenderTargetView>(nullptr) });
+	auto unbind = make_unique<RenderTargetsEffect>(renderTarget.getViewport(), nullptr,
+		dx_ptr<ID3D11RenderTargetView>(nullptr));
+	m_unbindTarget = unbind.get();
+	AddEffect(move(unbind));
 	_initShaders(device, variables, vsShader, gsShader, psShader);
 	_addRenderTarget(renderTarget, clearRenderTarget);
 }
@@ -85,27 +113,220 @@ void RenderPass::AddModel(const Model* m)
 	m_models.push_back(m);
 }
 
+size_t RenderPass::AddInstancedModel(const DxDevice& device, const Model* m, size_t maxInstances)
+{
+	InstancedModel instanced{ m, maxInstances };
+	const auto itEnd = m->end();
+	for (auto it = m->begin(); it != itEnd; ++it)
+		instanced.attributeIDs.push_back(
+			m_layouts->registerInstanceAttributesID(it.meshSignatureID(), VertexAttributes(InstanceLayout)));
+	const size_t bufferInstances = max<size_t>(maxInstances * instanced.attributeIDs.size(), 1);
+	instanced.buffer = device.CreateVertexBuffer<XMFLOAT4X4>(static_cast<unsigned>(bufferInstances));
+	instanced.transforms.reserve(maxInstances);
+	instanced.visible.reserve(bufferInstances);
+	m_instancedModels.push_back(move(instanced));
+	return m_instancedModels.size() - 1;
+}
+
+void RenderPass::SetInstances(size_t group, const XMFLOAT4X4* transforms, size_t count)
+{
+	InstancedModel& instanced = m_instancedModels[group];
+	assert(count <= instanced.capacity);
+	instanced.transforms.assign(transforms, transforms + min(count, instanced.capacity));
+}
+
+void RenderPass::SetTexture(const string& name, const dx_ptr<ID3D11ShaderResourceView>& view)
+{
+	for (const ShaderTextures& textures : m_shaderTextures)
+		for (size_t i = 0; i < textures.names.size(); ++i)
+			if (textures.names[i] == name)
+				textures.views->SetResource(static_cast<UINT>(i), view);
+}
+
+void RenderPass::SetRenderTarget(const RenderTargetsEffect& renderTarget)
+{
+	assert(m_renderTarget && m_unbindTarget);
+	*m_renderTarget = renderTarget;
+	m_unbindTarget->SetViewport(renderTarget.getViewport());
+}
+
 void RenderPass::AddEffect(std::unique_ptr<EffectComponent>&& effect)
 {
 	m_effect.m_components.push_back(move(effect));
 }
 
-void RenderPass::Execute(const dx_ptr<ID3D11DeviceContext>& context, CBVariableManager& manager)
+void RenderPass::_cull(const CullingFrustum* frustum)
 {
-	m_effect.Begin(context);
+	m_draws.clear();
+	m_visibleDraws.clear();
+	m_visibleCenters.clear();
 	for (const Model* model : m_models)
 	{
 		const auto itEnd = model->end();
 		for (auto it = model->begin(); it != itEnd; ++it)
+			m_draws.push_back(it);
+	}
+	if (!frustum)
+	{
+		m_visibleDraws = m_draws;
+		return;
+	}
+	//bounds are transformed even if the pass isn't culled, their centers give the depth of the draws
+	m_culling.Clear();
+	m_batchDraws.clear();
+	m_drawCenters.resize(m_draws.size());
+	m_drawVisible.assign(m_draws.size(), m_cullingEnabled ? 0 : 1);
+	for (size_t i = 0; i < m_draws.size(); ++i)
+	{
+		const XMFLOAT4X4& world = m_draws[i].transform();
+		const MeshBounds* bounds = m_draws[i].meshBounds();
+		if (!bounds)
+		{
+			m_drawVisible[i] = 1;
+			m_drawCenters[i] = { world._41, world._42, world._43 };
+			continue;
+		}
+		addBounds(m_culling, *bounds, XMLoadFloat4x4(&world), &m_drawCenters[i]);
+		m_batchDraws.push_back(static_cast<uint32_t>(i));
+	}
+	if (m_cullingEnabled)
+	{
+		m_culling.Cull(*frustum, m_visibleObjects);
+		for (uint32_t object : m_visibleObjects)
+			m_drawVisible[m_batchDraws[object]] = 1;
+	}
+	for (size_t i = 0; i < m_draws.size(); ++i)
+		if (m_drawVisible[i])
+		{
+			m_visibleDraws.push_back(m_draws[i]);
+			m_visibleCenters.push_back(m_drawCenters[i]);
+		}
+}
+
+void RenderPass::_cullInstances(const CullingFrustum* frustum)
+{
+	m_instancedDraws.clear();
+	m_instanceCount = 0;
+	m_culledInstances = 0;
+	const bool culling = frustum && m_cullingEnabled;
+	for (size_t group = 0; group < m_instancedModels.size(); ++group)
+	{
+		InstancedModel& instanced = m_instancedModels[group];
+		instanced.visible.clear();
+		if (instanced.transforms.empty())
+			continue;
+		size_t mesh = 0;
+		const auto itEnd = instanced.model->end();
+		for (auto it = instanced.model->begin(); it != itEnd; ++it, ++mesh)
 		{
-			manager.UpdateModel(it);
-			_updateCBuffers(context, manager);
-			context->IASetInputLayout(m_layouts->getLayout(it.meshSignatureID(), m_vsSignatureID).get());
-			it.mesh().Render(context);
+			const size_t start = instanced.visible.size();
+			const MeshBounds* bounds = it.meshBounds();
+			if (!culling || !bounds)
+				instanced.visible.insert(instanced.visible.end(), instanced.transforms.begin(), instanced.transforms.end());
+			else
+			{
+				//instances of each mesh are culled separately, visible ones follow the ones of the previous meshes
+				const XMMATRIX world = XMLoadFloat4x4(&it.transform());
+				m_culling.Clear();
+				for (const XMFLOAT4X4& transform : instanced.transforms)
+					addBounds(m_culling, *bounds, world * XMLoadFloat4x4(&transform));
+				m_culling.Cull(*frustum, m_visibleObjects);
+				for (uint32_t i : m_visibleObjects)
+					instanced.visible.push_back(instanced.transforms[i]);
+			}
+			const size_t count = instanced.visible.size() - start;
+			m_instanceCount += count;
+			m_culledInstances += instanced.transforms.size() - count;
+			if (count > 0)
+				m_instancedDraws.push_back({ it, group, instanced.attributeIDs[mesh], nullptr, static_cast<UINT>(start),
+					static_cast<UINT>(count) });
 		}
 	}
 }
 
+void RenderPass::_uploadInstances(CommandList& commands)
+{
+	for (InstancedModel& instanced : m_instancedModels)
+		if (!instanced.visible.empty())
+			commands.UpdateBuffer(instanced.buffer.get(), instanced.visible.data(),
+				static_cast<uint32_t>(instanced.visible.size() * sizeof(XMFLOAT4X4)));
+}
+
+uint32_t RenderPass::_meshID(const Mesh& mesh)
+{
+	return m_meshIDs.try_emplace(&mesh, static_cast<uint32_t>(m_meshIDs.size())).first->second;
+}
+
+void RenderPass::Collect(RenderQueue& queue, uint32_t pass, const CullingFrustum* frustum)
+{
+	_cull(frustum);
+	_cullInstances(frustum);
+	//shaders and textures are bound by the effect of the pass, the same for all of its draws
+	DrawKeyFields fields{ pass, 0, 0, 0, 0, 0.0f };
+	//layouts are created on first use, so they are looked up here rather than while recording
+	m_drawLayouts.clear();
+	for (size_t i = 0; i < m_visibleDraws.size(); ++i)
+	{
+		const auto& it = m_visibleDraws[i];
+		m_drawLayouts.push_back(m_layouts->getLayout(it.meshSignatureID(), m_vsSignatureID).get());
+		fields.layout = static_cast<uint32_t>(it.meshSignatureID());
+		fields.mesh = _meshID(it.mesh());
+		//distance of the center of the bounds from the near plane, whose normal faces the inside of the view volume
+		if (frustum)
+		{
+			const XMFLOAT3& center = m_visibleCenters[i];
+			const CullingPlane& nearPlane = frustum->planes[4];
+			fields.depth = nearPlane.nx * center.x + nearPlane.ny * center.y + nearPlane.nz * center.z + nearPlane.d;
+		}
+		queue.Push(drawKey::Make(fields), static_cast<uint32_t>(i));
+	}
+	fields.depth = 0.0f;
+	for (size_t i = 0; i < m_instancedDraws.size(); ++i)
+	{
+		m_instancedDraws[i].layout = m_layouts->getLayout(m_instancedDraws[i].attributesID, m_vsSignatureID).get();
+		fields.layout = static_cast<uint32_t>(m_instancedDraws[i].attributesID);
+		fields.mesh = _meshID(m_instancedDraws[i].node.mesh());
+		queue.Push(drawKey::Make(fields), static_cast<uint32_t>(i) | InstancedDrawBit);
+	}
+}
+
+void RenderPass::_draw(CommandList& commands, const CBVariableManager& manager, const Model::NodeIterator& it,
+	ID3D11InputLayout* layout)
+{
+	manager.UpdateModel(it, m_recorder.ModelSemantics());
+	m_recorder.Draw(commands, layout, it.mesh().Bindings());
+}
+
+void RenderPass::_drawInstanced(CommandList& commands, const CBVariableManager& manager, const InstancedDraw& draw)
+{
+	//per object buffers hold the node transform shared by all instances, so they change once per mesh
+	manager.UpdateModel(draw.node, m_recorder.ModelSemantics());
+	m_recorder.DrawInstanced(commands, draw.layout, draw.node.mesh().Bindings(), InstanceSlot,
+		m_instancedModels[draw.group].buffer.get(), sizeof(XMFLOAT4X4), draw.instanceCount, draw.startInstance);
+}
+
+void RenderPass::Execute(CommandList& commands, const CBVariableManager& manager, const RenderQueue::Item* first,
+	const RenderQueue::Item* last)
+{
+	m_effect.Begin(commands);
+	//a pass with no visible draws uploads nothing
+	if (first == last)
+	{
+		m_recorder.ResetStats();
+		return;
+	}
+	m_recorder.Begin(commands);
+	if (!m_instancedDraws.empty())
+		_uploadInstances(commands);
+	for (; first != last; ++first)
+	{
+		if (first->draw & InstancedDrawBit)
+			_drawInstanced(commands, manager, m_instancedDraws[first->draw & ~InstancedDrawBit]);
+		else
+			_draw(commands, manager, m_visibleDraws[first->draw], m_drawLayouts[first->draw]);
+	}
+}
+
 dx_ptr<ID3D11ShaderReflection> RenderPass::_reflectShader(const vector<BYTE>& shaderCode, D3D11_SHADER_DESC& shaderDesc)
 {
 	ID3D11ShaderReflection *temp;
@@ -146,12 +367,6 @@ vector<CBufferDesc> RenderPass::_getConstantbuffer_infos(const dx_ptr<ID3D11Shad
 	return result;
 }
 
-void RenderPass::_updateCBuffers(const dx_ptr<ID3D11DeviceContext>& context, const CBVariableManager& manager)
-{
-	for (auto cb : m_cbuffers)
-		cb->Update(context, manager);
-}
-
 vector<string> RenderPass::_getNames(const dx_ptr<ID3D11ShaderReflection>& shaderRefl, const D3D11_SHADER_DESC& shaderDesc, D3D_SHADER_INPUT_TYPE type)
 {
 	vector<string> samplers;
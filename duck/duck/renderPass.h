@@ -4,7 +4,12 @@
 #include "cbVariableManager.h"
 #include "dxDevice.h"
 #include "exceptions.h"
+#include "frustumCulling.h"
+#include "passRecorder.h"
+#include "renderQueue.h"
+#include <algorithm>
 #include <type_traits>
+#include <unordered_map>
 
 typedef struct _D3D11_SHADER_DESC D3D11_SHADER_DESC;
 struct ID3D11ShaderReflection;
@@ -19,15 +24,8 @@ namespace mini
 			// TODO : remove once moved to new namespace
 			template<typename T>
 			using dx_ptr = mini::directx::dx_ptr<T>;
-			class ICBVariablesEffect
-			{
-			public:
-				virtual ~ICBVariablesEffect() = default;
-				virtual void Update(const dx_ptr<ID3D11DeviceContext>& context, const CBVariableManager& manager) = 0;
-			};
-
 			template<typename ConstantBufferEffectT>
-			class CBVariablesEffect : public ConstantBufferEffectT, public ICBVariablesEffect
+			class CBVariablesEffect : public ConstantBufferEffectT
 			{
 			public:
 				using MyBase = ConstantBufferEffectT;
@@ -39,36 +37,23 @@ namespace mini
 
 
 
-				CBVariablesEffect(const DxDevice& device, std::vector<CBufferDesc>&& buffers)
-					: m_bufferDescriptions(std::move(buffers))
+				//variables of the buffers are resolved here, they have to be added to the manager before.
+				//The buffers are filled by recorder, model related semantics are read from its table.
+				CBVariablesEffect(const DxDevice& device, const CBVariableManager& variables, PassRecorder& recorder,
+					const std::vector<CBufferDesc>& buffers)
 				{
-					for (unsigned int i = 0; i < m_bufferDescriptions.size(); ++i)
+					for (unsigned int i = 0; i < buffers.size(); ++i)
 					{
-						CBufferDesc& bufferDesc = m_bufferDescriptions[i];
+						const CBufferDesc& bufferDesc = buffers[i];
 						MyBase::SetResource(i,
 							device.CreateBuffer(
 								directx::buffer_info::const_buffer(
 									static_cast<UINT>(bufferDesc.size))));
+						recorder.AddBuffer(MyBase::m_buffers[i].get(),
+							variables.CompileCBuffer(bufferDesc, &recorder.ModelSemantics()),
+							variables.GetUpdateFrequency(bufferDesc) == UpdateFrequency::PerObject);
 					}
 				}
-
-				void Update(const dx_ptr<ID3D11DeviceContext>& context, const CBVariableManager& manager) override
-				{
-					for (unsigned int i = 0; i < m_bufferDescriptions.size(); ++i)
-					{
-						D3D11_MAPPED_SUBRESOURCE resource;
-						ID3D11Buffer* cbuffer = MyBase::m_buffers[i].get();
-						auto hr = context->Map(cbuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
-						if (FAILED(hr))
-							throw utils::winapi_error{ hr };
-						manager.FillCBuffer(resource.pData, m_bufferDescriptions[i]);
-						context->Unmap(cbuffer, 0);
-					}
-				}
-
-			private:
-
-				std::vector<CBufferDesc> m_bufferDescriptions;
 			};
 
 		public:
@@ -78,6 +63,17 @@ namespace mini
 				{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 2, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 			};
 
+			//Instanced models get their per instance world transforms from a dynamic vertex buffer bound to the last
+			//input slot, read by vertex shaders as rows INSTANCE_TRANSFORM0-3. An instance transform is applied
+			//after the world transform of the mesh node, i.e. p * modelMtx * instanceMtx.
+			static constexpr UINT InstanceSlot = D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT - 1;
+			static constexpr D3D11_INPUT_ELEMENT_DESC InstanceLayout[4] = {
+				{ "INSTANCE_TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, InstanceSlot, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+				{ "INSTANCE_TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, InstanceSlot, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+				{ "INSTANCE_TRANSFORM", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, InstanceSlot, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+				{ "INSTANCE_TRANSFORM", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, InstanceSlot, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+			};
+
 			RenderPass(const DxDevice& device, const CBVariableManager& variables, InputLayoutManager* layouts,
 				const std::wstring& vsShader, const std::wstring& psShader);
 			RenderPass(const DxDevice& device, const CBVariableManager& variables, InputLayoutManager* layouts,
@@ -100,6 +96,13 @@ namespace mini
 			//stores the pointer to the model. Make sure it will exist throughout RenderPass lifetime.
 			void AddModel(const Model* m);
 
+			//Stores the pointer to the model, like AddModel, but each of its meshes is drawn for all instances of the group
+			//with a single DrawIndexedInstanced call. Returns the ID of the group passed to SetInstances.
+			//maxInstances - capacity of the instance buffer of the group
+			size_t AddInstancedModel(const DxDevice& device, const Model* m, size_t maxInstances);
+			//copies the transforms of the instances drawn by the following Execute calls, count <= maxInstances
+			void SetInstances(size_t group, const DirectX::XMFLOAT4X4* transforms, size_t count);
+
 			void AddEffect(std::unique_ptr<EffectComponent>&& effect);
 
 			template<class T>
@@ -116,7 +119,35 @@ namespace mini
 				AddEffect(std::make_unique<T>(std::forward<TArgs>(args)...));
 			}
 
-			void Execute(const dx_ptr<ID3D11DeviceContext>& context, CBVariableManager& manager);
+			//Culls the draws of the pass and pushes the visible ones to the queue, with keys made of pass
+			//and the state each draw binds. frustum - if not null, meshes whose bounds lie outside of it are not drawn
+			void Collect(RenderQueue& queue, uint32_t pass, const CullingFrustum* frustum = nullptr);
+			//Records beginning of the pass and draws [first, last) pushed by the last Collect, in this order.
+			//Only the pass itself is changed: model related semantics go to a table of the pass, and input layouts
+			//are looked up by Collect. Different passes can thus be recorded into their own lists concurrently,
+			//as long as the manager and models aren't changed meanwhile.
+			void Execute(CommandList& commands, const CBVariableManager& manager, const RenderQueue::Item* first,
+				const RenderQueue::Item* last);
+
+			//names of the textures read by the shaders of the pass, each once
+			const std::vector<std::string>& TextureNames() const { return m_textureNames; }
+			//replaces the view bound to the slots of the shaders reading texture name
+			void SetTexture(const std::string& name, const dx_ptr<ID3D11ShaderResourceView>& view);
+			//Replaces the render target bound by a pass created with one. Targets bound before the pass are unbound
+			//first, so that the pass can read them, then the shaders and the target are bound.
+			void SetRenderTarget(const RenderTargetsEffect& renderTarget);
+
+			//disables culling of this pass, e.g. when its render target isn't seen through the main camera
+			void SetCulling(bool enabled) { m_cullingEnabled = enabled; }
+			//draws considered and skipped by the last Collect
+			size_t DrawCount() const { return m_draws.size(); }
+			size_t CulledCount() const { return m_draws.size() - m_visibleDraws.size(); }
+			//instanced draws collected by the last Collect, and their instances drawn and culled
+			size_t InstancedDrawCount() const { return m_instancedDraws.size(); }
+			size_t InstanceCount() const { return m_instanceCount; }
+			size_t CulledInstanceCount() const { return m_culledInstances; }
+			//constant buffer updates recorded and skipped by the last Execute
+			const CBufferStats& CBufferUploads() const { return m_recorder.Stats(); }
 
 		private:
 			void _initShaders(const DxDevice& device, const CBVariableManager& variables,
@@ -131,17 +162,27 @@ namespace mini
 
 			std::vector<CBufferDesc> _getConstantbuffer_infos(const dx_ptr<ID3D11ShaderReflection>& shaderRefl, const D3D11_SHADER_DESC& shaderDesc);
 
-			void _updateCBuffers(const dx_ptr<ID3D11DeviceContext>& context, const CBVariableManager& manager);
+			//fills m_visibleDraws with the draws of all models of the pass which intersect frustum, and
+			//m_visibleCenters with the centers of their bounds if frustum isn't null
+			void _cull(const CullingFrustum* frustum);
+			//gathers the instances of every mesh of the instanced models which intersect frustum, fills m_instancedDraws
+			void _cullInstances(const CullingFrustum* frustum);
+			//copies the visible instances to the instance buffers
+			void _uploadInstances(CommandList& commands);
+			//small identifier of the mesh for sort keys, assigned on first use
+			uint32_t _meshID(const Mesh& mesh);
+			void _draw(CommandList& commands, const CBVariableManager& manager, const Model::NodeIterator& it,
+				ID3D11InputLayout* layout);
 
 			template<typename ConstantBufferEffectT>
-			void _addShaderConstantBuffers(const DxDevice& device, const dx_ptr<ID3D11ShaderReflection>& shaderRefl, const D3D11_SHADER_DESC& shaderDesc)
+			void _addShaderConstantBuffers(const DxDevice& device, const CBVariableManager& variables,
+				const dx_ptr<ID3D11ShaderReflection>& shaderRefl, const D3D11_SHADER_DESC& shaderDesc)
 			{
 				std::vector<CBufferDesc> buffers = _getConstantbuffer_infos(shaderRefl, shaderDesc);
 				if (!buffers.empty())
 				{
-					auto uptr = std::make_unique<CBVariablesEffect<ConstantBufferEffectT>>(device, std::move(buffers));
-					m_cbuffers.push_back(uptr.get());
-					m_effect.m_components.push_back(std::move(uptr));
+					m_effect.m_components.push_back(std::make_unique<CBVariablesEffect<ConstantBufferEffectT>>(device,
+						variables, m_recorder, buffers));
 				}
 			}
 
@@ -173,15 +214,79 @@ namespace mini
 					for (size_t i = 0; i < textureNames.size(); ++i)
 						if (!textureNames[i].empty())
 							uptr->SetResource(static_cast<UINT>(i), variables.GetTexture(textureNames[i]));
+					for (const std::string& name : textureNames)
+						if (!name.empty() && std::find(m_textureNames.begin(), m_textureNames.end(), name) == m_textureNames.end())
+							m_textureNames.push_back(name);
+					m_shaderTextures.push_back({ std::move(textureNames), uptr.get() });
 					m_effect.m_components.push_back(std::move(uptr));
 				}
 			}
 
+			struct InstancedModel
+			{
+				const Model* model;
+				size_t capacity;
+				std::vector<DirectX::XMFLOAT4X4> transforms;
+				//room for capacity instances of every mesh of the model
+				dx_ptr<ID3D11Buffer> buffer;
+				//vertex attributes of the meshes extended with InstanceLayout, in the order of drawing
+				std::vector<size_t> attributeIDs;
+				//visible instances of every mesh, copied to the buffer
+				std::vector<DirectX::XMFLOAT4X4> visible;
+			};
+
+			struct InstancedDraw
+			{
+				Model::NodeIterator node;
+				size_t group;
+				size_t attributesID;
+				ID3D11InputLayout* layout;
+				UINT startInstance;
+				UINT instanceCount;
+			};
+
+			void _drawInstanced(CommandList& commands, const CBVariableManager& manager, const InstancedDraw& draw);
+
 			DynamicEffect m_effect;
 			InputLayoutManager* m_layouts;
 			std::vector<const Model*> m_models;
-			std::vector<ICBVariablesEffect*> m_cbuffers;
+			//textures bound to a shader stage, names indexed by their slots (empty for unused slots)
+			struct ShaderTextures
+			{
+				std::vector<std::string> names;
+				ShaderResourceSet* views;
+			};
+			std::vector<ShaderTextures> m_shaderTextures;
+			std::vector<std::string> m_textureNames;
+			//target bound by the pass, and the effect unbinding targets of previous passes, if created with a target
+			RenderTargetsEffect* m_renderTarget = nullptr;
+			RenderTargetsEffect* m_unbindTarget = nullptr;
+			//fills the constant buffers of the pass and records its draws
+			PassRecorder m_recorder;
 			size_t m_vsSignatureID;
+
+			//visibility list of the pass, the containers are reused between frames
+			bool m_cullingEnabled = true;
+			std::vector<Model::NodeIterator> m_draws;
+			std::vector<Model::NodeIterator> m_visibleDraws;
+			//world space centers of the bounds of all draws and of the visible ones, filled when culling
+			std::vector<DirectX::XMFLOAT3> m_drawCenters;
+			std::vector<DirectX::XMFLOAT3> m_visibleCenters;
+			//input layout of each visible draw
+			std::vector<ID3D11InputLayout*> m_drawLayouts;
+			std::vector<uint8_t> m_drawVisible;
+			//index of the draw of each object of the batch
+			std::vector<uint32_t> m_batchDraws;
+			std::vector<uint32_t> m_visibleObjects;
+			CullingBatch m_culling;
+
+			std::vector<InstancedModel> m_instancedModels;
+			std::vector<InstancedDraw> m_instancedDraws;
+			//draws pushed to a queue are indices to m_visibleDraws, or to m_instancedDraws with this bit set
+			static constexpr uint32_t InstancedDrawBit = 1u << 31;
+			std::unordered_map<const Mesh*, uint32_t> m_meshIDs;
+			size_t m_instanceCount = 0;
+			size_t m_culledInstances = 0;
 		};
 	}
 }
@@ -1,6 +1,7 @@
 float4 camPos;
 sampler samp;
 textureCUBE envMap;
+Texture2D normalMap;
 float time;
 
 struct PSInput
@@ -28,7 +29,9 @@ float fresnel(float3 N, float3 V)
 
 float4 main(PSInput i) : SV_TARGET
 {   
-    float3 norm = float3(0, 1, 0);
+    //water grid spans [-1, 1] in local x and z, which map to the normal map's u and v
+    float2 uv = i.localPos.xz * 0.5 + 0.5;
+    float3 norm = normalize(normalMap.Sample(samp, uv).xyz);
     float3 viewVec = normalize(camPos.xyz - i.worldPos);
     float n = 3.0 / 4.0;
     if (dot(norm, viewVec) < 0)
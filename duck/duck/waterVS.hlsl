@@ -1,5 +1,7 @@
 matrix modelMtx, viewProjMtx;
 float waterLevel;
+sampler samp;
+Texture2D heightMap;
 
 struct VSOutput
 {
@@ -11,8 +13,10 @@ struct VSOutput
 VSOutput main(float3 pos : POSITION0)
 {
     VSOutput o;
+    //water grid spans [-1, 1] in local x and z, which map to the height map's u and v
+    float2 uv = pos.xz * 0.5 + 0.5;
     o.localPos = pos;
-    o.localPos.y = waterLevel;
+    o.localPos.y = waterLevel + heightMap.SampleLevel(samp, uv, 0).r;
     
     float4 p = float4(o.localPos, 1);
     p = mul(modelMtx, p);
@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+namespace mini
+{
+	namespace gk2
+	{
+		namespace bench
+		{
+			struct Benchmark
+			{
+				const char* name;
+				//returns false if any of the checks of the benchmark failed
+				bool (*run)();
+			};
+
+			//Runs func repeatedly for at least minSeconds (and at least once)
+			//and returns the average duration of a single run in seconds.
+			template<typename F>
+			double Measure(F&& func, double minSeconds = 0.5)
+			{
+				using clock = std::chrono::steady_clock;
+				const auto start = clock::now();
+				uint64_t runs = 0;
+				std::chrono::duration<double> elapsed{ 0.0 };
+				do
+				{
+					func();
+					++runs;
+					elapsed = clock::now() - start;
+				} while (elapsed.count() < minSeconds);
+				return elapsed.count() / static_cast<double>(runs);
+			}
+
+			bool WaterKernels();
+			bool WaterParallel();
+			bool WaterSparse();
+			bool WaterNormals();
+			bool RainInjection();
+			bool WaterReplay();
+
+			//replays a recorded simulation log, printing checksums every checksumInterval steps
+			int Replay(const char* path, uint64_t checksumInterval);
+			bool TextureUpload();
+			bool PathFollow();
+			bool PathFlocks();
+			bool FrustumCulling();
+			bool CBufferPlans();
+			bool SemanticUpdates();
+			bool RenderQueues();
+			bool DuckFrames();
+			bool FrameGraphs();
+		}
+	}
+}
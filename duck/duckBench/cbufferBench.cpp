@@ -0,0 +1,142 @@
+#include "benchmark.h"
+#include "cbufferPlan.h"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+namespace
+{
+	//stand-in for ICBVariable, the variables of the manager are separate heap allocations copied through a virtual call
+	class Variable
+	{
+	public:
+		virtual ~Variable() = default;
+		virtual void copyTo(void* buffer, size_t bufferSize) const = 0;
+		virtual void addToPlan(CBufferPlan& plan, size_t offset, size_t size) const = 0;
+	};
+
+	template<size_t Size>
+	class BytesVariable : public Variable
+	{
+	public:
+		explicit BytesVariable(unsigned char seed)
+		{
+			for (size_t i = 0; i < Size; ++i)
+				value[i] = static_cast<unsigned char>(seed + i);
+		}
+
+		void copyTo(void* buffer, size_t) const override { memcpy(buffer, value, Size); }
+		void addToPlan(CBufferPlan& plan, size_t offset, size_t) const override { plan.Add(value, offset, Size); }
+
+		alignas(16) unsigned char value[Size];
+	};
+
+	struct VariableDesc
+	{
+		string name;
+		size_t offset, size;
+	};
+
+	struct BufferDesc
+	{
+		const char* name;
+		size_t size;
+		vector<VariableDesc> variables;
+	};
+
+	class Variables
+	{
+	public:
+		template<size_t Size>
+		void Add(const string& name)
+		{
+			auto var = make_unique<BytesVariable<Size>>(static_cast<unsigned char>(m_variables.size()));
+			m_names.emplace(name, var.get());
+			m_variables.push_back(move(var));
+		}
+
+		//what CBVariableManager::FillCBuffer did on every draw
+		void Fill(void* buffer, const BufferDesc& desc) const
+		{
+			for (auto& v : desc.variables)
+			{
+				auto it = m_names.find(v.name);
+				if (it == m_names.end()) continue;
+				it->second->copyTo(static_cast<unsigned char*>(buffer) + v.offset, v.size);
+			}
+		}
+
+		CBufferPlan Compile(const BufferDesc& desc) const
+		{
+			CBufferPlan plan(desc.size);
+			for (auto& v : desc.variables)
+			{
+				auto it = m_names.find(v.name);
+				if (it == m_names.end()) continue;
+				it->second->addToPlan(plan, v.offset, v.size);
+			}
+			return plan;
+		}
+
+	private:
+		vector<unique_ptr<Variable>> m_variables;
+		map<string, Variable*> m_names;
+	};
+}
+
+bool bench::CBufferPlans()
+{
+	//variables registered by the duck application and a few more, as a larger scene would have
+	Variables variables;
+	for (const char* name : { "modelMtx", "modelInvTMtx", "viewProjMtx", "mvpMtx" })
+		variables.Add<64>(name);
+	for (const char* name : { "camPos", "lightPos", "lightColor", "surfaceColor" })
+		variables.Add<16>(name);
+	for (const char* name : { "ks", "kd", "ka", "m", "waterLevel", "rainRate", "dropRadius", "dropAmplitude", "duckSpeed" })
+		variables.Add<4>(name);
+	for (int i = 0; i < 32; ++i)
+		variables.Add<16>("material" + to_string(i));
+
+	vector<BufferDesc> buffers = {
+		{ "phongVS", 192, { { "modelMtx", 0, 64 }, { "modelInvTMtx", 64, 64 }, { "viewProjMtx", 128, 64 } } },
+		{ "phongPS", 80, { { "camPos", 0, 16 }, { "lightPos", 16, 16 }, { "lightColor", 32, 16 }, { "surfaceColor", 48, 12 },
+			{ "ks", 60, 4 }, { "kd", 64, 4 }, { "ka", 68, 4 }, { "m", 72, 4 }, { "time", 76, 4 } } },
+		{ "waterVS", 132, { { "modelMtx", 0, 64 }, { "viewProjMtx", 64, 64 }, { "waterLevel", 128, 4 } } },
+		{ "materials", 512, {} },
+	};
+	for (int i = 0; i < 32; ++i)
+		buffers.back().variables.push_back({ "material" + to_string(i), static_cast<size_t>(16 * i), 16 });
+
+	static constexpr int Draws = 10000;
+	printf("%-10s %6s %6s %14s %14s %8s %8s\n", "buffer", "vars", "copies", "lookup ns", "plan ns", "speedup", "matches");
+	bool passed = true;
+	for (const BufferDesc& desc : buffers)
+	{
+		const CBufferPlan plan = variables.Compile(desc);
+		vector<unsigned char> expected(desc.size, 0), actual(desc.size, 0);
+		variables.Fill(expected.data(), desc);
+		plan.Execute(actual.data());
+		const bool matches = expected == actual;
+		passed = passed && matches;
+
+		const double lookup = Measure([&] {
+			for (int i = 0; i < Draws; ++i)
+				variables.Fill(expected.data(), desc);
+		}, 0.2) / Draws;
+		const double planned = Measure([&] {
+			for (int i = 0; i < Draws; ++i)
+				plan.Execute(actual.data());
+		}, 0.2) / Draws;
+		printf("%-10s %6zu %6zu %14.1f %14.1f %7.1fx %8s\n", desc.name, desc.variables.size(), plan.Copies().size(),
+			lookup * 1e9, planned * 1e9, lookup / planned, matches ? "yes" : "NO");
+	}
+	return passed;
+}
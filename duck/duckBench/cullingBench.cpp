@@ -0,0 +1,124 @@
+#include "benchmark.h"
+#include "frustumCulling.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+namespace
+{
+	//row-vector view-projection of a camera at (0, 1, -5) looking at the origin, fov 45 degrees, aspect 16:9
+	void viewProjection(float (&out)[4][4])
+	{
+		const float zn = 0.1f, zf = 100.0f, yScale = 1.0f / tan(0.3926991f), xScale = yScale / (16.0f / 9.0f);
+		const float eye[3] = { 0.0f, 1.0f, -5.0f };
+		float forward[3] = { -eye[0], -eye[1], -eye[2] };
+		const float fl = sqrt(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+		for (float& c : forward)
+			c /= fl;
+		float right[3] = { forward[2], 0.0f, -forward[0] };
+		const float rl = sqrt(right[0] * right[0] + right[2] * right[2]);
+		right[0] /= rl;
+		right[2] /= rl;
+		const float up[3] = { forward[1] * right[2] - forward[2] * right[1], forward[2] * right[0] - forward[0] * right[2],
+			forward[0] * right[1] - forward[1] * right[0] };
+		float view[4][4] = {};
+		for (int i = 0; i < 3; ++i)
+		{
+			view[i][0] = right[i];
+			view[i][1] = up[i];
+			view[i][2] = forward[i];
+		}
+		for (int j = 0; j < 3; ++j)
+		{
+			const float* axis = j == 0 ? right : j == 1 ? up : forward;
+			view[3][j] = -(axis[0] * eye[0] + axis[1] * eye[1] + axis[2] * eye[2]);
+		}
+		view[3][3] = 1.0f;
+		const float proj[4][4] = { { xScale, 0, 0, 0 }, { 0, yScale, 0, 0 }, { 0, 0, zf / (zf - zn), 1 }, { 0, 0, -zn * zf / (zf - zn), 0 } };
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+			{
+				out[i][j] = 0.0f;
+				for (int k = 0; k < 4; ++k)
+					out[i][j] += view[i][k] * proj[k][j];
+			}
+	}
+
+	//true if any of the sample points of the box is inside the view volume, away from its boundary by more
+	//than the precision of the planes extracted from a single precision matrix
+	bool anyPointVisible(const float (&m)[4][4], const CullingBox& box)
+	{
+		static constexpr int Steps = 4;
+		for (int a = 0; a <= Steps; ++a)
+			for (int b = 0; b <= Steps; ++b)
+				for (int c = 0; c <= Steps; ++c)
+				{
+					const float p[3] = { box.minX + (box.maxX - box.minX) * a / Steps, box.minY + (box.maxY - box.minY) * b / Steps,
+						box.minZ + (box.maxZ - box.minZ) * c / Steps };
+					float clip[4];
+					for (int j = 0; j < 4; ++j)
+						clip[j] = p[0] * m[0][j] + p[1] * m[1][j] + p[2] * m[2][j] + m[3][j];
+					const float w = clip[3] * 0.999f;
+					if (fabs(clip[0]) <= w && fabs(clip[1]) <= w && clip[2] >= 0.001f * clip[3] && clip[2] <= w)
+						return true;
+				}
+		return false;
+	}
+}
+
+bool bench::FrustumCulling()
+{
+	static constexpr size_t Counts[] = { 1000, 10000, 100000 };
+	static constexpr SimdLevel Levels[] = { SimdLevel::Scalar, SimdLevel::AVX2 };
+	float viewProj[4][4];
+	viewProjection(viewProj);
+	const CullingFrustum frustum = ExtractFrustum(viewProj);
+	printf("%-10s %-8s %10s %12s %14s %10s %12s\n", "objects", "isa", "visible", "us/cull", "ns/object", "same", "conservative");
+	bool passed = true;
+	for (size_t count : Counts)
+	{
+		//small props scattered around the pond, in a square of 200 units centered at the camera
+		mt19937 random(5489u);
+		uniform_real_distribution<float> position(-100.0f, 100.0f), size(0.1f, 2.0f);
+		CullingBatch batch;
+		vector<CullingBox> boxes;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float x = position(random), y = position(random) * 0.05f, z = position(random);
+			const float ex = size(random), ey = size(random), ez = size(random);
+			const CullingBox box{ x - ex, y - ey, z - ez, x + ex, y + ey, z + ez };
+			batch.Add({ x, y, z, sqrt(ex * ex + ey * ey + ez * ez) }, box);
+			boxes.push_back(box);
+		}
+		vector<uint32_t> reference, visible;
+		for (SimdLevel level : Levels)
+		{
+			if (level > DetectSimdLevel())
+				continue;
+			batch.SetSimdLevel(level);
+			batch.Cull(frustum, visible);
+			if (level == SimdLevel::Scalar)
+				reference = visible;
+			//objects with any sampled point inside the view volume must never be culled
+			bool conservative = true;
+			size_t next = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				const bool kept = next < visible.size() && visible[next] == i;
+				next += kept;
+				conservative = conservative && (kept || !anyPointVisible(viewProj, boxes[i]));
+			}
+			passed = passed && visible == reference && conservative;
+			const double seconds = Measure([&] { batch.Cull(frustum, visible); }, 0.2);
+			printf("%-10zu %-8s %10zu %12.1f %14.2f %10s %12s\n", count, SimdLevelName(level), visible.size(), seconds * 1e6,
+				seconds * 1e9 / static_cast<double>(count), visible == reference ? "yes" : "NO", conservative ? "yes" : "NO");
+		}
+	}
+	return passed;
+}
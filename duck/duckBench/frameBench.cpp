@@ -0,0 +1,386 @@
+#include "benchmark.h"
+#include "commandList.h"
+#include "nullCommandExecutor.h"
+#include "passRecorder.h"
+#include "renderQueue.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+namespace
+{
+	//values of the Direct3D 11 enumerations recorded by the duck application
+	constexpr uint32_t TopologyTriangleList = 4;
+	constexpr uint32_t FormatR16Uint = 57;
+	constexpr uint32_t ClearDepthAndStencil = 3;
+	//slot of the instance buffers of RenderPass, the last one
+	constexpr uint32_t InstanceSlot = commandLimits::VertexBufferSlots - 1;
+
+	//stand-in of a Direct3D object, only its address is recorded
+	struct Object
+	{
+		unsigned char unused;
+	};
+
+	struct SceneMesh
+	{
+		Object vertexBuffers[3];
+		Object* vertexBufferPointers[3];
+		Object indexBuffer;
+		uint32_t strides[3];
+		uint32_t offsets[3];
+		CommandMesh<Object> bindings;
+	};
+
+	//objects bound by the effect of a pass, its constant buffers are filled by the recorder like in RenderPass
+	struct ScenePass
+	{
+		Object vs, ps, rasterizer, sampler, layout;
+		Object textures[2];
+		Object perObjectBuffer, perFrameBuffer;
+		PassRecorder recorder;
+		vector<uint32_t> meshes;
+		vector<Float4x4> transforms;
+		//draws of an instanced pass draw all instances of their mesh, whose transforms follow the ones of the
+		//previous meshes in the instance buffer, uploaded every frame
+		bool instanced = false;
+		Object instanceBuffer;
+		vector<Float4x4> instances;
+	};
+
+	struct SceneDesc
+	{
+		const char* name;
+		uint32_t passes;
+		uint32_t drawsPerPass;
+		uint32_t meshes;
+		//index of the pass drawing its meshes instanced, or -1, its number of draws and instances of each
+		int instancedPass;
+		uint32_t instancedDraws;
+		uint32_t instances;
+		//draw commands of the GUI
+		uint32_t guiDraws;
+	};
+
+	//FNV-1a hash of the recorded commands and the data of buffer updates, independent of how the commands are split
+	//into lists. Objects are left out, the ones of different scenes lie at different addresses.
+	void hashCommands(const CommandList& commands, uint64_t& hash)
+	{
+		const auto add = [&hash](const void* data, size_t size) {
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; ++i)
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+		};
+		for (const Command& c : commands.Commands())
+		{
+			add(&c.type, sizeof(c.type));
+			add(&c.stage, sizeof(c.stage));
+			add(&c.start, sizeof(c.start));
+			add(&c.count, sizeof(c.count));
+			add(c.args, sizeof(c.args));
+			if (c.type == CommandType::UpdateBuffer)
+				add(commands.Payload<unsigned char>(c), c.count);
+		}
+	}
+
+	Float4x4 translation(float x, float y, float z)
+	{
+		return { { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { x, y, z, 1 } } };
+	}
+
+	//Records frames the way DuckBase::render does: the window target is cleared and bound, draws of all passes
+	//are sorted by their keys, every pass binds its effect, fills the buffers whose variables changed and draws
+	//its meshes, the GUI uploads its vertices and draws its lists. Passes are recorded either into the list of the
+	//frame or each into its own list, in parallel. Queue ranges, constant buffers and draws are recorded by the
+	//same code as in RenderPass; effects and the GUI record the commands of their Direct3D counterparts.
+	class Scene
+	{
+	public:
+		explicit Scene(const SceneDesc& desc)
+			: m_desc(desc), m_meshes(desc.meshes), m_passes(desc.passes)
+		{
+			using VS = VariableSemantic;
+			for (VS s : { VS::MatVP, VS::Vec4CamPos })
+			{
+				m_semantics.Add(s);
+				m_semantics.MarkRead(s);
+			}
+			mt19937 random(5489u);
+			for (SceneMesh& mesh : m_meshes)
+			{
+				const auto indexCount = static_cast<uint32_t>(36 + 6 * (random() % 1000));
+				for (int i = 0; i < 3; ++i)
+					mesh.vertexBufferPointers[i] = &mesh.vertexBuffers[i];
+				mesh.strides[0] = mesh.strides[1] = 12;
+				mesh.strides[2] = 8;
+				mesh.offsets[0] = mesh.offsets[1] = mesh.offsets[2] = 0;
+				mesh.bindings = { TopologyTriangleList, &mesh.indexBuffer, FormatR16Uint, indexCount, 3,
+					mesh.vertexBufferPointers, mesh.strides, mesh.offsets };
+			}
+			for (uint32_t p = 0; p < desc.passes; ++p)
+			{
+				ScenePass& pass = m_passes[p];
+				//phong-like buffers of the duck shaders: per object matrices, per frame camera and light
+				SemanticTable& model = pass.recorder.ModelSemantics();
+				model.MarkRead(VS::MatM);
+				model.MarkRead(VS::MatMInvT);
+				CBufferPlan perObject(192);
+				perObject.Add(model.Data(VS::MatM), 0, 64);
+				perObject.Add(model.Data(VS::MatMInvT), 64, 64);
+				perObject.Add(m_semantics.Data(VS::MatVP), 128, 64);
+				perObject.AddVersion(&model.Version(VS::MatM));
+				perObject.AddVersion(&m_semantics.Version(VS::MatVP));
+				pass.recorder.AddBuffer(&pass.perObjectBuffer, move(perObject), true);
+				CBufferPlan perFrame(80);
+				perFrame.Add(m_semantics.Data(VS::Vec4CamPos), 0, 16);
+				perFrame.Add(m_light, 16, sizeof(m_light));
+				perFrame.AddVersion(&m_semantics.Version(VS::Vec4CamPos));
+				pass.recorder.AddBuffer(&pass.perFrameBuffer, move(perFrame), false);
+				pass.instanced = static_cast<int>(p) == desc.instancedPass;
+				const uint32_t draws = pass.instanced ? desc.instancedDraws : desc.drawsPerPass;
+				if (pass.instanced)
+					pass.instances.resize(static_cast<size_t>(draws) * desc.instances);
+				for (uint32_t i = 0; i < draws; ++i)
+				{
+					pass.meshes.push_back(random() % desc.meshes);
+					pass.transforms.push_back(translation(static_cast<float>(random() % 100), 0.0f,
+						static_cast<float>(random() % 100)));
+				}
+			}
+			m_guiVertices.resize(desc.guiDraws * 120 * 20);
+			m_guiIndices.resize(desc.guiDraws * 180 * 2);
+		}
+
+		//records the whole frame into commands
+		void Record(CommandList& commands, uint32_t frame)
+		{
+			_beginFrame(commands, frame);
+			for (uint32_t p = 0; p < m_passes.size(); ++p)
+				_recordPass(commands, p);
+			_recordGui(commands);
+		}
+
+		//records the frame into commands, passes, one list per pass, and gui, in this order of execution
+		void Record(CommandList& commands, vector<CommandList>& passes, CommandList& gui, utils::thread_pool& pool,
+			uint32_t frame)
+		{
+			_beginFrame(commands, frame);
+			passes.resize(m_passes.size());
+			pool.parallel_for(0, m_passes.size(), 1, [&](size_t first, size_t last) {
+				for (size_t p = first; p < last; ++p)
+				{
+					passes[p].Clear();
+					_recordPass(passes[p], static_cast<uint32_t>(p));
+				}
+			});
+			gui.Clear();
+			_recordGui(gui);
+		}
+
+	private:
+		void _beginFrame(CommandList& commands, uint32_t frame)
+		{
+			commands.Clear();
+			const float clearColor[4] = { 0.5f, 0.5f, 1.0f, 0.0f };
+			commands.ClearRenderTarget(&m_windowTarget, clearColor);
+			commands.ClearDepthStencil(&m_depthStencil, ClearDepthAndStencil, 1.0f, 0);
+			commands.SetViewports(1, &m_viewport);
+			Object* target = &m_windowTarget;
+			commands.SetRenderTargets(1, &target, &m_depthStencil);
+			//the camera moves every frame, so all buffers are filled again
+			m_semantics.SetViewAndProjection(translation(0.0f, 0.0f, 5.0f + 0.01f * (frame % 100)), m_projection);
+
+			m_queue.Clear();
+			for (uint32_t p = 0; p < m_passes.size(); ++p)
+			{
+				ScenePass& pass = m_passes[p];
+				//instances move every frame, like the flock of the application, and their draws have no depth
+				for (size_t i = 0; i < pass.instances.size(); ++i)
+					pass.instances[i] = translation(static_cast<float>(i % 16), 0.0f,
+						static_cast<float>(i / 16) + 0.01f * (frame % 100));
+				for (uint32_t i = 0; i < pass.meshes.size(); ++i)
+					m_queue.Push(drawKey::Make({ p, 0, 0, 0, pass.meshes[i],
+						pass.instanced ? 0.0f : pass.transforms[i].m[3][2] }), i);
+			}
+			m_queue.Sort();
+			m_queue.PassRanges(m_passes.size(), m_passDraws);
+		}
+
+		//changes only the pass itself, the frame semantics and meshes are read
+		void _recordPass(CommandList& commands, uint32_t p)
+		{
+			ScenePass& pass = m_passes[p];
+			_begin(commands, pass);
+			if (m_passDraws[p].first == m_passDraws[p].second)
+			{
+				pass.recorder.ResetStats();
+				return;
+			}
+			pass.recorder.Begin(commands);
+			if (pass.instanced)
+				commands.UpdateBuffer(&pass.instanceBuffer, pass.instances.data(),
+					static_cast<uint32_t>(pass.instances.size() * sizeof(Float4x4)));
+			for (const RenderQueue::Item* item = m_passDraws[p].first; item != m_passDraws[p].second; ++item)
+			{
+				pass.recorder.ModelSemantics().SetModel(pass.transforms[item->draw], m_semantics);
+				const CommandMesh<Object>& mesh = m_meshes[pass.meshes[item->draw]].bindings;
+				if (pass.instanced)
+					pass.recorder.DrawInstanced(commands, &pass.layout, mesh, InstanceSlot, &pass.instanceBuffer,
+						sizeof(Float4x4), m_desc.instances, item->draw * m_desc.instances);
+				else
+					pass.recorder.Draw(commands, &pass.layout, mesh);
+			}
+		}
+
+		void _begin(CommandList& commands, ScenePass& pass)
+		{
+			commands.SetShader(ShaderStage::VS, &pass.vs);
+			commands.SetShader(ShaderStage::PS, &pass.ps);
+			Object* buffer = &pass.perObjectBuffer;
+			commands.SetConstantBuffers(ShaderStage::VS, 0, 1, &buffer);
+			buffer = &pass.perFrameBuffer;
+			commands.SetConstantBuffers(ShaderStage::PS, 0, 1, &buffer);
+			Object* sampler = &pass.sampler;
+			commands.SetSamplers(ShaderStage::PS, 0, 1, &sampler);
+			Object* textures[2] = { &pass.textures[0], &pass.textures[1] };
+			commands.SetShaderResources(ShaderStage::PS, 0, 2, textures);
+			commands.SetRasterizerState(&pass.rasterizer);
+		}
+
+		void _recordGui(CommandList& commands)
+		{
+			commands.UpdateBuffer(&m_guiVertexBuffer, m_guiVertices.data(), static_cast<uint32_t>(m_guiVertices.size()));
+			commands.UpdateBuffer(&m_guiIndexBuffer, m_guiIndices.data(), static_cast<uint32_t>(m_guiIndices.size()));
+			commands.SetInputLayout(&m_guiLayout);
+			Object* buffer = &m_guiVertexBuffer;
+			static constexpr uint32_t stride = 20, offset = 0;
+			commands.SetVertexBuffers(0, 1, &buffer, &stride, &offset);
+			commands.SetIndexBuffer(&m_guiIndexBuffer, FormatR16Uint, 0);
+			commands.SetPrimitiveTopology(TopologyTriangleList);
+			commands.SetShader(ShaderStage::VS, &m_guiVS);
+			buffer = &m_guiProjection;
+			commands.SetConstantBuffers(ShaderStage::VS, 0, 1, &buffer);
+			commands.SetShader(ShaderStage::PS, &m_guiPS);
+			Object* sampler = &m_guiSampler;
+			commands.SetSamplers(ShaderStage::PS, 0, 1, &sampler);
+			commands.SetBlendState(&m_guiBlend, nullptr, 0xffffffff);
+			commands.SetDepthStencilState(&m_guiDepth, 0);
+			commands.SetRasterizerState(&m_guiRasterizer);
+			Object* font = &m_guiFont;
+			for (uint32_t i = 0; i < m_desc.guiDraws; ++i)
+			{
+				const CommandRect rect{ 980, static_cast<int32_t>(i * 20), 1280, static_cast<int32_t>(i * 20 + 20) };
+				commands.SetShaderResources(ShaderStage::PS, 0, 1, &font);
+				commands.SetScissorRects(1, &rect);
+				commands.DrawIndexed(180, i * 180, 0);
+			}
+			commands.ClearState();
+		}
+
+		SceneDesc m_desc;
+		vector<SceneMesh> m_meshes;
+		vector<ScenePass> m_passes;
+		SemanticTable m_semantics;
+		RenderQueue m_queue;
+		vector<RenderQueue::Range> m_passDraws;
+		Float4x4 m_projection = { { { 1.8f, 0, 0, 0 }, { 0, 2.4f, 0, 0 }, { 0, 0, 1.0f, 1 }, { 0, 0, -0.5f, 0 } } };
+		float m_light[16] = { -1.0f, 0.0f, -3.5f, 1.0f, 12.0f, 9.0f, 10.0f, 0.0f, 0.5f, 1.0f, 0.8f, 0.8f, 0.5f, 0.2f, 1.0f };
+		CommandViewport m_viewport{ 0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 1.0f };
+		Object m_windowTarget, m_depthStencil;
+		Object m_guiVertexBuffer, m_guiIndexBuffer, m_guiLayout, m_guiVS, m_guiPS, m_guiProjection, m_guiSampler;
+		Object m_guiBlend, m_guiDepth, m_guiRasterizer, m_guiFont;
+		vector<unsigned char> m_guiVertices, m_guiIndices;
+	};
+}
+
+bool bench::DuckFrames()
+{
+	static constexpr SceneDesc Scenes[] = {
+		//the passes of the duck application: environment, instanced flock of three meshes and the lead duck,
+		//water, with its GUI window
+		{ "duck", 3, 1, 5, 1, 3, 65, 40 },
+		//larger scene, as many draws as the render queue is profiled with
+		{ "scene", 8, 1000, 200, -1, 0, 0, 40 },
+	};
+	//a model of the frame: passes and the queue are recorded by the code of the application, effects and the GUI
+	//by stand-ins of them binding objects without a device
+	printf("modelled frames: passes recorded by PassRecorder, effects and GUI by stand-ins\n\n");
+	printf("%-6s %8s %8s %10s %10s %10s %10s %8s\n", "scene", "draws", "commands", "payload KB", "record us",
+		"execute us", "redundant", "errors");
+	bool passed = true;
+	for (const SceneDesc& desc : Scenes)
+	{
+		Scene scene(desc);
+		CommandList commands;
+		NullCommandExecutor executor;
+		uint32_t frame = 0;
+		const double recordSeconds = Measure([&] { scene.Record(commands, frame++); }, 0.3);
+		//the last recorded frame is checked
+		const double executeSeconds = Measure([&] {
+			executor.Reset();
+			executor.Execute(commands);
+		}, 0.3);
+		const CommandStats& stats = executor.Stats();
+		printf("%-6s %8zu %8zu %10.1f %10.1f %10.1f %10zu %8zu\n", desc.name, stats.draws, stats.commands,
+			commands.PayloadSize() / 1024.0, recordSeconds * 1e6, executeSeconds * 1e6, stats.redundant, stats.errors);
+		passed = passed && stats.errors == 0;
+		for (const CommandError& error : executor.Errors())
+			printf("  command %zu: %s\n", error.command, error.message);
+	}
+
+	//Passes of the larger scene recorded each into its own list. The last frame repeats the camera of the one before,
+	//so the lists are compared also when buffers are skipped by dirty tracking.
+	const SceneDesc& desc = Scenes[1];
+	static constexpr uint32_t CheckedFrames[] = { 0, 1, 1 };
+	uint64_t serialHash = 14695981039346656037ull;
+	{
+		Scene scene(desc);
+		CommandList commands;
+		for (uint32_t frame : CheckedFrames)
+			scene.Record(commands, frame);
+		hashCommands(commands, serialHash);
+	}
+	Scene serial(desc);
+	CommandList serialCommands;
+	uint32_t serialFrame = 0;
+	const double serialSeconds = Measure([&] { serial.Record(serialCommands, serialFrame++); }, 0.3);
+
+	constexpr unsigned MaxThreads = 8;
+	const unsigned hardwareThreads = max(1U, thread::hardware_concurrency());
+	printf("\n%-8s %10s %10s %8s %s\n", "threads", "record us", "speedup", "errors", "identical");
+	for (unsigned threads = 1; threads <= min(MaxThreads, hardwareThreads); threads *= 2)
+	{
+		//calling thread takes part in the work, so the pool needs one thread less
+		utils::thread_pool pool(threads - 1);
+		Scene scene(desc);
+		CommandList commands, gui;
+		vector<CommandList> passes;
+		for (uint32_t frame : CheckedFrames)
+			scene.Record(commands, passes, gui, pool, frame);
+		uint64_t hash = 14695981039346656037ull;
+		NullCommandExecutor executor;
+		hashCommands(commands, hash);
+		executor.Execute(commands);
+		for (const CommandList& pass : passes)
+		{
+			hashCommands(pass, hash);
+			executor.Execute(pass);
+		}
+		hashCommands(gui, hash);
+		executor.Execute(gui);
+		uint32_t frame = 0;
+		passed = passed && executor.Stats().errors == 0 && hash == serialHash;
+		const double seconds = Measure([&] { scene.Record(commands, passes, gui, pool, frame++); }, 0.3);
+		printf("%-8u %10.1f %10.2f %8zu %s\n", threads, seconds * 1e6, serialSeconds / seconds,
+			executor.Stats().errors, hash == serialHash ? "yes" : "NO");
+	}
+	return passed;
+}
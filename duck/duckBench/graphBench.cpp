@@ -0,0 +1,206 @@
+#include "benchmark.h"
+#include "frameGraph.h"
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+namespace
+{
+	//values of DXGI_FORMAT
+	constexpr uint32_t FormatRGBA8 = 28;
+	constexpr uint32_t FormatRGBA16F = 10;
+	constexpr uint32_t FormatD24S8 = 45;
+
+	struct GraphStats
+	{
+		size_t clears = 0, copies = 0, passes = 0;
+		//transient textures used by the steps, and the physical textures they are kept in
+		size_t textures = 0, physical = 0;
+	};
+
+	GraphStats stats(const FrameGraph& graph)
+	{
+		GraphStats result;
+		for (const FrameStep& step : graph.Steps())
+		{
+			result.clears += step.type == FrameStepType::Clear;
+			result.copies += step.type == FrameStepType::Copy;
+			result.passes += step.type == FrameStepType::Pass;
+		}
+		for (uint32_t texture = 0; texture < graph.TextureCount(); ++texture)
+			result.textures += graph.Physical(texture) != FrameGraph::None;
+		result.physical = graph.PhysicalTextures().size();
+		return result;
+	}
+
+	void printSteps(const FrameGraph& graph, const char* const* passNames)
+	{
+		for (const FrameStep& step : graph.Steps())
+			if (step.type == FrameStepType::Pass)
+				printf("  %s\n", passNames[step.index]);
+			else if (step.type == FrameStepType::Clear)
+				printf("  clear texture %u (physical %u)\n", step.index, graph.Physical(step.index));
+			else
+				printf("  copy texture %u into %u (physical %u)\n", step.source, step.index, graph.Physical(step.index));
+	}
+
+	bool report(const char* name, const FrameGraph& graph, const vector<uint32_t>& expectedOrder, size_t clears,
+		size_t copies, size_t physical)
+	{
+		const GraphStats s = stats(graph);
+		const bool expected = graph.Order() == expectedOrder && s.clears == clears && s.copies == copies &&
+			s.physical == physical;
+		printf("%-10s %7zu %7zu %7zu %7zu %9zu %9zu %s\n", name, graph.PassCount(), graph.PassCount() - s.passes,
+			s.clears, s.copies, s.textures, s.physical, expected ? "yes" : "NO");
+		return expected;
+	}
+
+	//the passes of the duck application, all drawing to the back buffer
+	bool duckFrame()
+	{
+		FrameGraph graph;
+		const uint32_t window = graph.ImportTexture({ 1280, 720, FormatRGBA8 });
+		const uint32_t env = graph.AddPass();
+		const uint32_t flock = graph.AddPass();
+		const uint32_t water = graph.AddPass();
+		graph.Write(env, window);
+		graph.Write(flock, window);
+		graph.Write(water, window);
+		graph.Compile();
+		return report("duck", graph, { env, flock, water }, 0, 0, 0);
+	}
+
+	//Deferred shading frame with passes added in no particular order: the G-buffer is decorated by decals
+	//reading the albedo they write, a debug view of normals is never shown
+	bool deferredFrame(bool print)
+	{
+		FrameGraph graph;
+		const uint32_t window = graph.ImportTexture({ 1280, 720, FormatRGBA8 });
+		const uint32_t shadow = graph.AddTexture({ 2048, 2048, FormatD24S8 });
+		const uint32_t albedo = graph.AddTexture({ 1280, 720, FormatRGBA8 });
+		const uint32_t normal = graph.AddTexture({ 1280, 720, FormatRGBA8 });
+		const uint32_t depth = graph.AddTexture({ 1280, 720, FormatD24S8 });
+		const uint32_t lit = graph.AddTexture({ 1280, 720, FormatRGBA16F });
+		const uint32_t bloomA = graph.AddTexture({ 640, 360, FormatRGBA16F });
+		const uint32_t bloomB = graph.AddTexture({ 640, 360, FormatRGBA16F });
+		const uint32_t bloomC = graph.AddTexture({ 640, 360, FormatRGBA16F });
+		const uint32_t debug = graph.AddTexture({ 1280, 720, FormatRGBA8 });
+		const uint32_t ui = graph.AddTexture({ 1280, 720, FormatRGBA8 });
+		static const char* const names[] = { "tonemap", "lighting", "gbuffer", "shadows", "bloom down", "bloom blur x",
+			"bloom blur y", "debug normals", "decals", "ui" };
+		const uint32_t tonemap = graph.AddPass();
+		graph.Read(tonemap, lit);
+		graph.Read(tonemap, bloomC);
+		graph.Read(tonemap, ui);
+		graph.Write(tonemap, window, WriteMode::Overwrite);
+		const uint32_t lighting = graph.AddPass();
+		graph.Read(lighting, albedo);
+		graph.Read(lighting, normal);
+		graph.Read(lighting, depth);
+		graph.Read(lighting, shadow);
+		graph.Write(lighting, lit, WriteMode::Overwrite);
+		const uint32_t gbuffer = graph.AddPass();
+		graph.Write(gbuffer, albedo);
+		graph.Write(gbuffer, normal);
+		graph.Write(gbuffer, depth, WriteMode::Clear);
+		const uint32_t shadows = graph.AddPass();
+		graph.Write(shadows, shadow, WriteMode::Clear);
+		const uint32_t bloomDown = graph.AddPass();
+		graph.Read(bloomDown, lit);
+		graph.Write(bloomDown, bloomA, WriteMode::Overwrite);
+		const uint32_t blurX = graph.AddPass();
+		graph.Read(blurX, bloomA);
+		graph.Write(blurX, bloomB, WriteMode::Overwrite);
+		const uint32_t blurY = graph.AddPass();
+		graph.Read(blurY, bloomB);
+		graph.Write(blurY, bloomC, WriteMode::Overwrite);
+		const uint32_t debugNormals = graph.AddPass();
+		graph.Read(debugNormals, normal);
+		graph.Write(debugNormals, debug);
+		const uint32_t decals = graph.AddPass();
+		graph.Read(decals, albedo);
+		graph.Read(decals, depth);
+		graph.Write(decals, albedo);
+		const uint32_t uiPass = graph.AddPass();
+		graph.Write(uiPass, ui);
+		graph.Compile();
+		//G-buffer albedo and normal are cleared before their first use, the UI before being drawn,
+		//depth and shadows are cleared by their passes. The UI is drawn into the memory of the albedo, done after
+		//lighting, and the second blur into the memory of the first.
+		const bool expected = report("deferred", graph, { gbuffer, shadows, decals, lighting, bloomDown, blurX, blurY, uiPass, tonemap },
+			5, 1, 8);
+		if (print)
+			printSteps(graph, names);
+		return expected;
+	}
+
+	//a pass reading the output of a pass reading its own
+	bool cyclicFrame()
+	{
+		FrameGraph graph;
+		const uint32_t window = graph.ImportTexture({ 1280, 720, FormatRGBA8 });
+		const uint32_t a = graph.AddTexture({ 256, 256, FormatRGBA8 });
+		const uint32_t b = graph.AddTexture({ 256, 256, FormatRGBA8 });
+		const uint32_t first = graph.AddPass();
+		graph.Read(first, b);
+		graph.Write(first, a);
+		const uint32_t second = graph.AddPass();
+		graph.Read(second, a);
+		graph.Write(second, b);
+		graph.Write(second, window);
+		bool thrown = false;
+		try
+		{
+			graph.Compile();
+		}
+		catch (const logic_error&)
+		{
+			thrown = true;
+		}
+		printf("%-10s %7zu %47s %s\n", "cycle", graph.PassCount(), "rejected:", thrown ? "yes" : "NO");
+		return thrown;
+	}
+}
+
+bool bench::FrameGraphs()
+{
+	printf("%-10s %7s %7s %7s %7s %9s %9s %s\n", "graph", "passes", "culled", "clears", "copies", "textures",
+		"physical", "expected");
+	bool passed = duckFrame();
+	passed = deferredFrame(false) && passed;
+	passed = cyclicFrame() && passed;
+	printf("\nsteps of the deferred frame:\n");
+	deferredFrame(true);
+
+	//Chains of post processing passes over a few sizes, each pass reading outputs of the ones before.
+	//Compilation happens when passes change, not every frame.
+	static constexpr uint32_t Passes = 500, Sizes = 4;
+	mt19937 random(5489u);
+	FrameGraph graph;
+	const uint32_t window = graph.ImportTexture({ 1280, 720, FormatRGBA8 });
+	vector<uint32_t> outputs;
+	for (uint32_t i = 0; i < Passes; ++i)
+	{
+		const uint32_t size = 1280u >> (random() % Sizes);
+		const uint32_t pass = graph.AddPass();
+		const uint32_t output = graph.AddTexture({ size, size * 9 / 16, FormatRGBA16F });
+		for (int r = 0; r < 2 && !outputs.empty(); ++r)
+			graph.Read(pass, outputs[outputs.size() - 1 - random() % min<size_t>(outputs.size(), 8)]);
+		graph.Write(pass, output, random() % 4 == 0 ? WriteMode::Load : WriteMode::Overwrite);
+		outputs.push_back(output);
+	}
+	const uint32_t present = graph.AddPass();
+	graph.Read(present, outputs.back());
+	graph.Write(present, window, WriteMode::Overwrite);
+	const double seconds = Measure([&] { graph.Compile(); }, 0.2);
+	const GraphStats s = stats(graph);
+	printf("\n%u passes: %.1f us to compile, %zu culled, %zu textures in %zu physical\n", Passes + 1, seconds * 1e6,
+		graph.PassCount() - s.passes, s.textures, s.physical);
+	return passed;
+}
@@ -0,0 +1,68 @@
+#include "benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+static constexpr Benchmark Benchmarks[] = {
+	{ "waterKernels", WaterKernels },
+	{ "waterParallel", WaterParallel },
+	{ "waterSparse", WaterSparse },
+	{ "waterNormals", WaterNormals },
+	{ "rainInjection", RainInjection },
+	{ "waterReplay", WaterReplay },
+	{ "textureUpload", TextureUpload },
+	{ "pathFollow", PathFollow },
+	{ "pathFlock", PathFlocks },
+	{ "frustumCulling", FrustumCulling },
+	{ "cbufferPlan", CBufferPlans },
+	{ "semanticTable", SemanticUpdates },
+	{ "renderQueue", RenderQueues },
+	{ "duckFrame", DuckFrames },
+	{ "frameGraph", FrameGraphs },
+};
+
+static constexpr uint64_t DefaultChecksumInterval = 100;
+
+//Runs benchmarks whose names were passed as arguments, or all of them if there are no arguments.
+//Exits with 2 if any of their checks failed.
+//"replay <log> [checksum interval]" replays a recorded simulation log instead.
+int main(int argc, char* argv[])
+{
+	if (argc >= 3 && strcmp(argv[1], "replay") == 0)
+		return Replay(argv[2], argc >= 4 ? strtoull(argv[3], nullptr, 10) : DefaultChecksumInterval);
+	bool anyRun = false;
+	vector<const char*> failed;
+	for (const Benchmark& b : Benchmarks)
+	{
+		bool selected = argc == 1;
+		for (int i = 1; i < argc && !selected; ++i)
+			selected = strcmp(argv[i], b.name) == 0;
+		if (!selected)
+			continue;
+		printf("== %s ==\n", b.name);
+		if (!b.run())
+			failed.push_back(b.name);
+		anyRun = true;
+	}
+	if (!anyRun)
+	{
+		printf("Usage: DuckBench [benchmark...] | replay <log> [checksum interval]\nAvailable benchmarks:\n");
+		for (const Benchmark& b : Benchmarks)
+			printf("  %s\n", b.name);
+		return 1;
+	}
+	if (failed.empty())
+		return 0;
+	fprintf(stderr, "\nchecks failed:");
+	for (const char* name : failed)
+		fprintf(stderr, " %s", name);
+	fprintf(stderr, "\n");
+	return 2;
+}
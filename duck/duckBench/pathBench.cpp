@@ -0,0 +1,48 @@
+#include "benchmark.h"
+#include "bsplinePath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+bool bench::PathFollow()
+{
+	static constexpr PathPoint Min{ -0.8f, -0.8f }, Max{ 0.8f, 0.8f };
+	static constexpr float Speeds[] = { 0.001f, 0.01f, 0.1f };
+	static constexpr size_t Steps = 200000;
+	printf("%-8s %10s %12s %12s %10s %10s\n", "speed", "segments", "within 1%", "max step", "outside", "ns/step");
+	bool passed = true;
+	for (float speed : Speeds)
+	{
+		BSplinePath path(Min, Max);
+		PathPoint prev = path.Position();
+		float maxStep = 0.0f;
+		size_t outside = 0, constant = 0;
+		for (size_t i = 0; i < Steps; ++i)
+		{
+			path.Advance(speed);
+			const PathPoint p = path.Position();
+			//chord between consecutive positions, shorter than the arc only on sharp bends
+			const float step = hypot(p.x - prev.x, p.y - prev.y);
+			if (fabs(step - speed) <= 0.01f * speed)
+				++constant;
+			maxStep = max(maxStep, step);
+			if (p.x < Min.x || p.x > Max.x || p.y < Min.y || p.y > Max.y)
+				++outside;
+			prev = p;
+		}
+		//the path never leaves its bounding rectangle
+		passed = passed && outside == 0;
+		const double seconds = Measure([&path, speed] {
+			for (int i = 0; i < 1000; ++i)
+				path.Advance(speed);
+		}, 0.2) / 1000;
+		printf("%-8.3f %10llu %11.2f%% %12.6f %10zu %10.1f\n", speed, static_cast<unsigned long long>(path.SegmentIndex()),
+			100.0 * static_cast<double>(constant) / Steps, maxStep, outside, seconds * 1e9);
+	}
+	return passed;
+}
@@ -0,0 +1,100 @@
+#include "benchmark.h"
+#include "renderQueue.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+namespace
+{
+	//state changes made by submitting draws in the given order
+	struct Switches
+	{
+		size_t shaders = 0, layouts = 0, textures = 0, meshes = 0;
+	};
+
+	Switches countSwitches(const vector<DrawKeyFields>& draws, const vector<uint32_t>& order)
+	{
+		Switches result;
+		const DrawKeyFields* last = nullptr;
+		for (uint32_t i : order)
+		{
+			const DrawKeyFields& d = draws[i];
+			result.shaders += !last || last->shaders != d.shaders;
+			result.layouts += !last || last->layout != d.layout;
+			result.textures += !last || last->textures != d.textures;
+			result.meshes += !last || last->mesh != d.mesh;
+			last = &d;
+		}
+		return result;
+	}
+}
+
+bool bench::RenderQueues()
+{
+	static constexpr size_t Draws = 100000;
+	static constexpr uint32_t Passes = 8, ShaderSets = 32, Layouts = 4, TextureSets = 64, Meshes = 500;
+	//synthetic draws, issued pass after pass, with random state inside a pass
+	mt19937 random(5489u);
+	vector<DrawKeyFields> draws(Draws);
+	for (size_t i = 0; i < Draws; ++i)
+	{
+		DrawKeyFields& d = draws[i];
+		d.pass = static_cast<uint32_t>(i * Passes / Draws);
+		d.shaders = random() % ShaderSets;
+		d.layout = random() % Layouts;
+		d.textures = random() % TextureSets;
+		d.mesh = random() % Meshes;
+		d.depth = uniform_real_distribution<float>(0.1f, 100.0f)(random);
+	}
+
+	RenderQueue queue;
+	const double buildSeconds = Measure([&] {
+		queue.Clear();
+		for (size_t i = 0; i < Draws; ++i)
+			queue.Push(drawKey::Make(draws[i]), static_cast<uint32_t>(i));
+	}, 0.2);
+	const vector<RenderQueue::Item> unsorted = queue.Items();
+	vector<RenderQueue::Item> reference;
+	//refilling the queue is timed separately and subtracted
+	const double refillSeconds = Measure([&] {
+		queue.Clear();
+		for (const RenderQueue::Item& item : unsorted)
+			queue.Push(item.key, item.draw);
+	}, 0.2);
+	const double radixSeconds = Measure([&] {
+		queue.Clear();
+		for (const RenderQueue::Item& item : unsorted)
+			queue.Push(item.key, item.draw);
+		queue.Sort();
+	}, 0.2) - refillSeconds;
+	const double stdSeconds = Measure([&] {
+		reference = unsorted;
+		stable_sort(reference.begin(), reference.end(),
+			[](const RenderQueue::Item& a, const RenderQueue::Item& b) { return a.key < b.key; });
+	}, 0.2);
+	const bool matches = equal(reference.begin(), reference.end(), queue.Items().begin(), queue.Items().end(),
+		[](const RenderQueue::Item& a, const RenderQueue::Item& b) { return a.key == b.key && a.draw == b.draw; });
+
+	printf("%zu draws, %u passes: keys %.1f us, radix sort %.1f us (%d digit passes), std::stable_sort %.1f us, %.1fx, %s\n",
+		Draws, Passes, buildSeconds * 1e6, radixSeconds * 1e6, queue.SortPasses(), stdSeconds * 1e6,
+		stdSeconds / radixSeconds, matches ? "same order" : "ORDER DIFFERS");
+
+	vector<uint32_t> submitted(Draws), sorted;
+	for (uint32_t i = 0; i < Draws; ++i)
+		submitted[i] = i;
+	for (const RenderQueue::Item& item : queue.Items())
+		sorted.push_back(item.draw);
+	printf("%-10s %10s %10s %10s %10s\n", "order", "shaders", "layouts", "textures", "meshes");
+	for (auto [name, order] : { make_pair("submitted", &submitted), make_pair("sorted", &sorted) })
+	{
+		const Switches s = countSwitches(draws, *order);
+		printf("%-10s %10zu %10zu %10zu %10zu\n", name, s.shaders, s.layouts, s.textures, s.meshes);
+	}
+	return matches;
+}
@@ -0,0 +1,75 @@
+#include "benchmark.h"
+#include "waterSurface.h"
+#include "impulses.h"
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+bool bench::RainInjection()
+{
+	static constexpr size_t Resolutions[] = { 1024, 4096 };
+	static constexpr size_t DropCounts[] = { 1000, 10000, 50000 };
+	static constexpr unsigned Batches = 32;
+	printf("%-8s %8s %14s %10s\n", "grid", "drops", "us/batch", "ns/drop");
+	for (size_t n : Resolutions)
+	{
+		WaterSurface surface(n);
+		for (size_t drops : DropCounts)
+		{
+			ImpulseQueue queue(drops);
+			RainSource rain(n);
+			vector<Impulse> batch;
+			using clock = chrono::steady_clock;
+			clock::duration injectTime{ 0 };
+			for (unsigned i = 0; i < Batches; ++i)
+			{
+				//one second of rain at the given rate, so exactly drops impulses are queued
+				rain.Generate(queue, 1.0f, static_cast<float>(drops), RainSource::DefaultRadius, RainSource::DefaultAmplitude);
+				const auto start = clock::now();
+				batch.clear();
+				queue.Drain(batch);
+				surface.ApplyImpulses(batch);
+				injectTime += clock::now() - start;
+			}
+			const double seconds = chrono::duration<double>(injectTime).count() / Batches;
+			printf("%-8zu %8zu %14.1f %10.1f\n", n, drops, seconds * 1e6, seconds * 1e9 / static_cast<double>(drops));
+		}
+	}
+
+	//all impulses pushed concurrently by several producers have to come out of the queue exactly once
+	static constexpr unsigned Producers = 4;
+	static constexpr size_t PerProducer = 100000;
+	ImpulseQueue queue(1024);
+	vector<thread> producers;
+	for (unsigned p = 0; p < Producers; ++p)
+		producers.emplace_back([&queue, p] {
+			for (size_t i = 0; i < PerProducer; ++i)
+				while (!queue.Push({ static_cast<float>(i), static_cast<float>(p), 1.0f, 1.0f }))
+					this_thread::yield();
+		});
+	vector<Impulse> received;
+	vector<size_t> next(Producers, 0);
+	bool ordered = true;
+	while (received.size() < Producers * PerProducer)
+	{
+		const size_t first = received.size();
+		if (queue.Drain(received) == 0)
+			this_thread::yield();
+		for (size_t i = first; i < received.size(); ++i)
+		{
+			//impulses of a single producer keep their order
+			const auto p = static_cast<size_t>(received[i].y);
+			ordered = ordered && static_cast<size_t>(received[i].x) == next[p]++;
+		}
+	}
+	for (auto& t : producers)
+		t.join();
+	printf("%u producers: %zu impulses received, in order: %s\n", Producers, received.size(), ordered ? "yes" : "NO");
+	return ordered && received.size() == Producers * PerProducer;
+}
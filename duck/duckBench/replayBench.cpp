@@ -0,0 +1,81 @@
+#include "benchmark.h"
+#include "simulationLog.h"
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+static void printCheckpoint(const SimulationReplay::Checkpoint& c)
+{
+	printf("%10llu %016llx %12.3f %12.3f\n", static_cast<unsigned long long>(c.step),
+		static_cast<unsigned long long>(c.checksum), c.meanStepSeconds * 1000.0, c.maxStepSeconds * 1000.0);
+}
+
+static void printResult(const SimulationReplay::Result& r)
+{
+	printf("%llu steps, %llu impulses, %.3f ms/step (max %.3f ms), final checksum %016llx\n",
+		static_cast<unsigned long long>(r.steps), static_cast<unsigned long long>(r.impulses),
+		r.steps ? r.totalStepSeconds * 1000.0 / static_cast<double>(r.steps) : 0.0, r.maxStepSeconds * 1000.0,
+		static_cast<unsigned long long>(r.finalChecksum));
+}
+
+int bench::Replay(const char* path, uint64_t checksumInterval)
+{
+	try
+	{
+		SimulationReplay replay(path);
+		WaterSurface surface = simulation_log::CreateSurface(replay.Header());
+		printf("%10s %16s %12s %12s\n", "step", "checksum", "ms/step", "max ms");
+		printResult(replay.Run(surface, checksumInterval, printCheckpoint));
+		return 0;
+	}
+	catch (const exception& e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+}
+
+bool bench::WaterReplay()
+{
+	static constexpr size_t Resolution = 1024;
+	static constexpr unsigned Steps = 512;
+	static constexpr uint64_t ChecksumInterval = 128;
+	static constexpr float Pi = 3.14159265f;
+	const auto path = filesystem::temp_directory_path() / "duckBenchReplay.dwlg";
+	//live session: rain and a duck swimming in a circle, stepped in parallel
+	uint64_t liveChecksum;
+	{
+		WaterSurface surface(Resolution);
+		ImpulseQueue queue;
+		RainSource rain(Resolution);
+		surface.SetImpulseQueue(&queue);
+		utils::thread_pool pool;
+		SimulationRecorder recorder(path, surface);
+		for (unsigned i = 0; i < Steps; ++i)
+		{
+			const float angle = 2.0f * Pi * static_cast<float>(i) / static_cast<float>(Steps);
+			const float x = Resolution / 2 + Resolution / 4 * cos(angle), y = Resolution / 2 + Resolution / 4 * sin(angle);
+			recorder.RecordDuck(x, y);
+			queue.Push({ x, y, 3.0f, 0.01f });
+			rain.Generate(queue, surface.TimeStep(), 2000.0f, RainSource::DefaultRadius, RainSource::DefaultAmplitude);
+			surface.Step(pool);
+			recorder.RecordStep(surface.TimeStep(), surface.StepImpulses());
+		}
+		liveChecksum = HeightChecksum(surface);
+	}
+	printf("log size: %.1f KB\n", static_cast<double>(filesystem::file_size(path)) / 1024.0);
+	SimulationReplay replay(path);
+	WaterSurface surface = simulation_log::CreateSurface(replay.Header());
+	printf("%10s %16s %12s %12s\n", "step", "checksum", "ms/step", "max ms");
+	const auto result = replay.Run(surface, ChecksumInterval, printCheckpoint);
+	printResult(result);
+	const bool matches = result.finalChecksum == liveChecksum;
+	printf("matches live session: %s\n", matches ? "yes" : "NO");
+	filesystem::remove(path);
+	return matches;
+}
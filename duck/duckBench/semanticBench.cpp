@@ -0,0 +1,229 @@
+#include "benchmark.h"
+#include "semanticTable.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+namespace
+{
+	using VS = VariableSemantic;
+
+	constexpr VS offset(VS s, int k) { return static_cast<VS>(static_cast<int>(s) + k); }
+
+	//Semantic storage as it was before the table: a map from the semantic to a separately allocated value,
+	//walked for every update, computing every registered semantic with general inverses
+	class MapSemantics
+	{
+	public:
+		explicit MapSemantics(uint64_t mask)
+		{
+			for (size_t i = 0; i < SemanticTable::Count; ++i)
+				if (mask & (uint64_t(1) << i))
+					m_values.emplace(static_cast<VS>(i), make_unique<Float4x4>());
+			//model view semantics need the view and projection
+			m_values.emplace(VS::MatV, make_unique<Float4x4>());
+			m_values.emplace(VS::MatP, make_unique<Float4x4>());
+		}
+
+		void SetViewAndProjection(const Float4x4& view, const Float4x4& projection)
+		{
+			_setFamily(VS::MatV, view);
+			//rows of the inverse view are camera axes and position
+			static constexpr pair<VS, int> CameraRows[] = { { VS::Vec4CamRight, 0 }, { VS::Vec4CamUp, 1 },
+				{ VS::Vec4CamDir, 2 }, { VS::Vec4CamPos, 3 } };
+			Float4x4 viewInv;
+			bool inverted = false;
+			for (auto [s, row] : CameraRows)
+			{
+				auto it = m_values.find(s);
+				if (it == m_values.end())
+					continue;
+				if (!inverted)
+					matrix::GeneralInverse(view, viewInv);
+				inverted = true;
+				copy_n(viewInv.m[row], 4, it->second->m[0]);
+			}
+			Float4x4 vp;
+			matrix::Multiply(view, projection, vp);
+			_setFamily(VS::MatVP, vp);
+			_setFamily(VS::MatP, projection);
+		}
+
+		void SetModel(const Float4x4& model)
+		{
+			_setFamily(VS::MatM, model);
+			Float4x4 mv, mvp;
+			matrix::Multiply(model, *m_values.find(VS::MatV)->second, mv);
+			_setFamily(VS::MatMV, mv);
+			matrix::Multiply(mv, *m_values.find(VS::MatP)->second, mvp);
+			_setFamily(VS::MatMVP, mvp);
+		}
+
+		const Float4x4* Find(VS s) const
+		{
+			auto it = m_values.find(s);
+			return it != m_values.end() ? it->second.get() : nullptr;
+		}
+
+	private:
+		void _setFamily(VS m, const Float4x4& value)
+		{
+			auto it = m_values.lower_bound(m);
+			if (it == m_values.end() || it->first > offset(m, 3))
+				return;
+			Float4x4 inv;
+			bool inverted = false;
+			for (; it != m_values.end() && it->first <= offset(m, 3); ++it)
+			{
+				const int k = static_cast<int>(it->first) - static_cast<int>(m);
+				if (k >= 2 && !inverted)
+				{
+					matrix::GeneralInverse(value, inv);
+					inverted = true;
+				}
+				const Float4x4& source = k >= 2 ? inv : value;
+				if (k % 2)
+					matrix::Transpose(source, *it->second);
+				else
+					*it->second = source;
+			}
+		}
+
+		map<VS, unique_ptr<Float4x4>> m_values;
+	};
+
+	Float4x4 lookAt(const float (&eye)[3])
+	{
+		float forward[3] = { -eye[0], -eye[1], -eye[2] };
+		const float fl = sqrt(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+		for (float& c : forward)
+			c /= fl;
+		float right[3] = { forward[2], 0.0f, -forward[0] };
+		const float rl = sqrt(right[0] * right[0] + right[2] * right[2]);
+		right[0] /= rl;
+		right[2] /= rl;
+		const float up[3] = { forward[1] * right[2] - forward[2] * right[1], forward[2] * right[0] - forward[0] * right[2],
+			forward[0] * right[1] - forward[1] * right[0] };
+		Float4x4 view{};
+		for (int i = 0; i < 3; ++i)
+		{
+			view.m[i][0] = right[i];
+			view.m[i][1] = up[i];
+			view.m[i][2] = forward[i];
+		}
+		const float* axes[3] = { right, up, forward };
+		for (int j = 0; j < 3; ++j)
+			view.m[3][j] = -(axes[j][0] * eye[0] + axes[j][1] * eye[1] + axes[j][2] * eye[2]);
+		view.m[3][3] = 1.0f;
+		return view;
+	}
+
+	//rotations about y with a uniform scale, every fourth one stretched along x
+	vector<Float4x4> models(size_t count)
+	{
+		mt19937 random(5489u);
+		uniform_real_distribution<float> angle(0.0f, 6.2831853f), scale(0.5f, 20.0f), position(-10.0f, 10.0f);
+		vector<Float4x4> result(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float a = angle(random), s = scale(random), sx = i % 4 == 3 ? 2.0f * s : s;
+			result[i] = { { { sx * cos(a), 0.0f, -sx * sin(a), 0.0f }, { 0.0f, s, 0.0f, 0.0f }, { s * sin(a), 0.0f, s * cos(a), 0.0f },
+				{ position(random), position(random), position(random), 1.0f } } };
+		}
+		return result;
+	}
+
+	//largest difference between the values of read matrix semantics relative to their magnitude
+	float maxDifference(const SemanticTable& table, const MapSemantics& reference, uint64_t mask)
+	{
+		float result = 0.0f;
+		for (size_t i = 0; i < SemanticTable::Count; ++i)
+		{
+			const VS s = static_cast<VS>(i);
+			if (!(mask & SemanticTable::Bit(s)) || !SemanticTable::IsMatrix(s))
+				continue;
+			const float* a = table.Data(s);
+			const float* b = &reference.Find(s)->m[0][0];
+			float magnitude = 0.0f, difference = 0.0f;
+			for (int k = 0; k < 16; ++k)
+			{
+				magnitude = max(magnitude, fabs(b[k]));
+				difference = max(difference, fabs(a[k] - b[k]));
+			}
+			result = max(result, difference / max(magnitude, 1e-6f));
+		}
+		return result;
+	}
+}
+
+bool bench::SemanticUpdates()
+{
+	static constexpr size_t Objects = 10000;
+	struct Case
+	{
+		const char* name;
+		uint64_t mask;
+	};
+	//semantics read by the duck shaders, and every model related one
+	const Case cases[] = {
+		{ "duck", SemanticTable::Bit(VS::MatM) | SemanticTable::Bit(VS::MatMInvT) | SemanticTable::Bit(VS::MatVP) |
+			SemanticTable::Bit(VS::Vec4CamPos) | SemanticTable::Bit(VS::MatMVP) },
+		{ "allModel", SemanticTable::Bits(VS::MatM, VS::MatMVPInvT) | SemanticTable::Bit(VS::MatVP) |
+			SemanticTable::Bit(VS::Vec4CamPos) },
+	};
+	const float eye[3] = { 3.0f, 4.0f, -12.0f };
+	const Float4x4 view = lookAt(eye);
+	const float zn = 0.1f, zf = 100.0f, yScale = 1.0f / tan(0.3926991f), xScale = yScale / (16.0f / 9.0f);
+	const Float4x4 projection{ { { xScale, 0, 0, 0 }, { 0, yScale, 0, 0 }, { 0, 0, zf / (zf - zn), 1 }, { 0, 0, -zn * zf / (zf - zn), 0 } } };
+	const vector<Float4x4> objects = models(Objects);
+
+	printf("%-10s %14s %14s %14s %8s %12s\n", "semantics", "map us/frame", "table us/frame", "table ns/obj", "speedup", "max diff");
+	for (const Case& c : cases)
+	{
+		MapSemantics reference(c.mask);
+		SemanticTable table;
+		for (size_t i = 0; i < SemanticTable::Count; ++i)
+			if (c.mask & (uint64_t(1) << i))
+			{
+				table.Add(static_cast<VS>(i));
+				table.MarkRead(static_cast<VS>(i));
+			}
+		//checks every object against the map with general inverses
+		float difference = 0.0f;
+		reference.SetViewAndProjection(view, projection);
+		table.SetViewAndProjection(view, projection);
+		table.SetViewport(1280.0f, 720.0f, 0.785f, zn, zf);
+		difference = max(difference, maxDifference(table, reference, c.mask & SemanticTable::Bits(VS::MatV, VS::MatPInvT)));
+		for (const Float4x4& m : objects)
+		{
+			reference.SetModel(m);
+			table.SetModel(m);
+			difference = max(difference, maxDifference(table, reference, c.mask & SemanticTable::Bits(VS::MatM, VS::MatMVPInvT)));
+		}
+
+		const double mapSeconds = Measure([&] {
+			reference.SetViewAndProjection(view, projection);
+			for (const Float4x4& m : objects)
+				reference.SetModel(m);
+		}, 0.2);
+		const double tableSeconds = Measure([&] {
+			table.SetViewAndProjection(view, projection);
+			table.SetViewport(1280.0f, 720.0f, 0.785f, zn, zf);
+			for (const Float4x4& m : objects)
+				table.SetModel(m);
+		}, 0.2);
+		printf("%-10s %14.1f %14.1f %14.1f %7.1fx %12.2g\n", c.name, mapSeconds * 1e6, tableSeconds * 1e6,
+			tableSeconds * 1e9 / Objects, mapSeconds / tableSeconds, difference);
+	}
+	return true;
+}
@@ -0,0 +1,59 @@
+#include "benchmark.h"
+#include "waterSurface.h"
+#include "textureUpload.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+bool bench::TextureUpload()
+{
+	static constexpr size_t Resolution = 2048;
+	static constexpr unsigned Frames = 256;
+	static constexpr float Pi = 3.14159265f;
+	static constexpr UploadMode Modes[] = { UploadMode::UpdateSubresource, UploadMode::WriteDiscard, UploadMode::StagingRing };
+	static constexpr const char* ModeNames[] = { "UpdateSubresource", "WriteDiscard", "StagingRing" };
+	printf("%-18s %12s %14s %10s %10s %s\n", "mode", "ms/frame", "MB/frame", "maps", "gpuCopies", "matches");
+	bool passed = true;
+	for (size_t m = 0; m < size(Modes); ++m)
+	{
+		//same calm pond with a duck wake as in waterSparse, one step per frame
+		WaterSurface surface(Resolution);
+		TextureStream stream(make_unique<NullTextureUploadBackend>(Resolution, Resolution, sizeof(float),
+			TextureStream::DefaultRingSize), Resolution, Resolution, sizeof(float), Modes[m]);
+		auto& backend = static_cast<const NullTextureUploadBackend&>(stream.Backend());
+		vector<WaterSurface::DirtyRect> rects;
+		using clock = chrono::steady_clock;
+		clock::duration uploadTime{ 0 };
+		for (unsigned i = 0; i < Frames; ++i)
+		{
+			const float angle = 2.0f * Pi * static_cast<float>(i) / static_cast<float>(Frames);
+			surface.Disturb(static_cast<size_t>(Resolution / 2 + Resolution / 4 * cos(angle)),
+				static_cast<size_t>(Resolution / 2 + Resolution / 4 * sin(angle)), 0.01f);
+			surface.Step();
+			rects.clear();
+			surface.TakeDirtyRects(rects);
+			const auto start = clock::now();
+			stream.Upload(surface.Heights(), surface.RowPitch() * sizeof(float), rects);
+			uploadTime += clock::now() - start;
+		}
+		bool matches = true;
+		for (size_t y = 0; y < Resolution && matches; ++y)
+			matches = memcmp(backend.Texture() + y * backend.RowPitch(), surface.Heights() + y * surface.RowPitch(),
+				Resolution * sizeof(float)) == 0;
+		passed = passed && matches;
+		const UploadStats& stats = stream.Stats();
+		printf("%-18s %12.3f %14.3f %10llu %10llu %s\n", ModeNames[m],
+			chrono::duration<double>(uploadTime).count() * 1000.0 / Frames,
+			static_cast<double>(stats.bytes) / (1024.0 * 1024.0) / Frames,
+			static_cast<unsigned long long>(stats.maps), static_cast<unsigned long long>(stats.gpuCopies),
+			matches ? "yes" : "NO");
+	}
+	return passed;
+}
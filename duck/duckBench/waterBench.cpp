@@ -0,0 +1,160 @@
+#include "benchmark.h"
+#include "waterSurface.h"
+#include <cstdio>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace bench;
+
+//surface which steps every block, so the throughput does not depend on how far the waves have spread
+static WaterSurface makeSurface(size_t resolution)
+{
+	WaterSurface surface(resolution);
+	surface.SetActivityThreshold(-1.0f);
+	surface.Disturb(resolution / 2, resolution / 2, 0.5f);
+	surface.Disturb(resolution / 3, resolution / 4, -0.25f);
+	return surface;
+}
+
+static bool sameHeights(const WaterSurface& a, const WaterSurface& b)
+{
+	const size_t n = a.Resolution();
+	for (size_t y = 0; y < n; ++y)
+		if (memcmp(a.Heights() + y * a.RowPitch(), b.Heights() + y * b.RowPitch(), n * sizeof(float)) != 0)
+			return false;
+	return true;
+}
+
+bool bench::WaterKernels()
+{
+	static constexpr size_t Resolutions[] = { 256, 1024, 4096 };
+	static constexpr unsigned ValidationSteps = 16;
+	const SimdLevel best = DetectSimdLevel();
+	printf("%-8s %-8s %16s %12s %s\n", "grid", "isa", "cells/s", "ms/step", "bit-exact");
+	bool passed = true;
+	for (size_t n : Resolutions)
+	{
+		WaterSurface reference = makeSurface(n);
+		reference.SetSimdLevel(SimdLevel::Scalar);
+		for (unsigned i = 0; i < ValidationSteps; ++i)
+			reference.Step();
+		for (int l = 0; l <= static_cast<int>(best); ++l)
+		{
+			const auto level = static_cast<SimdLevel>(l);
+			WaterSurface surface = makeSurface(n);
+			surface.SetSimdLevel(level);
+			for (unsigned i = 0; i < ValidationSteps; ++i)
+				surface.Step();
+			const bool exact = sameHeights(surface, reference);
+			passed = passed && exact;
+			const double seconds = Measure([&surface] { surface.Step(); });
+			printf("%-8zu %-8s %16.0f %12.3f %s\n", n, SimdLevelName(level),
+				static_cast<double>(n * n) / seconds, seconds * 1000.0, exact ? "yes" : "NO");
+		}
+	}
+	return passed;
+}
+
+bool bench::WaterParallel()
+{
+	static constexpr size_t Resolution = 2048;
+	static constexpr unsigned MaxThreads = 16;
+	static constexpr unsigned ValidationSteps = 16;
+	const unsigned hardwareThreads = max(1U, thread::hardware_concurrency());
+	WaterSurface reference = makeSurface(Resolution);
+	for (unsigned i = 0; i < ValidationSteps; ++i)
+		reference.Step();
+	printf("%-8s %12s %10s %s\n", "threads", "ms/step", "speedup", "deterministic");
+	double serialSeconds = 0.0;
+	bool passed = true;
+	for (unsigned threads = 1; threads <= min(MaxThreads, hardwareThreads); threads *= 2)
+	{
+		//calling thread takes part in the work, so the pool needs one thread less
+		utils::thread_pool pool(threads - 1);
+		WaterSurface surface = makeSurface(Resolution);
+		for (unsigned i = 0; i < ValidationSteps; ++i)
+			surface.Step(pool);
+		const bool deterministic = sameHeights(surface, reference);
+		passed = passed && deterministic;
+		const double seconds = Measure([&surface, &pool] { surface.Step(pool); });
+		if (threads == 1)
+			serialSeconds = seconds;
+		printf("%-8u %12.3f %10.2f %s\n", threads, seconds * 1000.0, serialSeconds / seconds,
+			deterministic ? "yes" : "NO");
+	}
+	return passed;
+}
+
+bool bench::WaterSparse()
+{
+	static constexpr size_t Resolution = 2048;
+	static constexpr unsigned Steps = 512;
+	static constexpr float Pi = 3.14159265f;
+	//calm pond with a single duck swimming in a circle and leaving a wake
+	auto simulate = [](float threshold, double& seconds, double& steppedFraction) {
+		WaterSurface surface(Resolution);
+		surface.SetActivityThreshold(threshold);
+		vector<WaterSurface::DirtyRect> rects;
+		size_t stepped = 0;
+		using clock = chrono::steady_clock;
+		const auto start = clock::now();
+		for (unsigned i = 0; i < Steps; ++i)
+		{
+			const float angle = 2.0f * Pi * static_cast<float>(i) / static_cast<float>(Steps);
+			surface.Disturb(static_cast<size_t>(Resolution / 2 + Resolution / 4 * cos(angle)),
+				static_cast<size_t>(Resolution / 2 + Resolution / 4 * sin(angle)), 0.01f);
+			surface.Step();
+			stepped += surface.SteppedBlockCount();
+			rects.clear();
+			surface.TakeDirtyRects(rects);
+		}
+		seconds = chrono::duration<double>(clock::now() - start).count() / Steps;
+		steppedFraction = static_cast<double>(stepped) / static_cast<double>(surface.BlockCount() * Steps);
+		return surface;
+	};
+	double denseSeconds, sparseSeconds, denseFraction, sparseFraction;
+	const WaterSurface dense = simulate(-1.0f, denseSeconds, denseFraction);
+	const WaterSurface sparse = simulate(WaterSurface::DefaultActivityThreshold, sparseSeconds, sparseFraction);
+	float maxError = 0.0f;
+	for (size_t y = 0; y < Resolution; ++y)
+		for (size_t x = 0; x < Resolution; ++x)
+			maxError = max(maxError, fabs(dense.Height(x, y) - sparse.Height(x, y)));
+	printf("%-8s %12s %14s %10s\n", "mode", "ms/step", "blocks stepped", "speedup");
+	printf("%-8s %12.3f %13.1f%% %10.2f\n", "dense", denseSeconds * 1000.0, denseFraction * 100.0, 1.0);
+	printf("%-8s %12.3f %13.1f%% %10.2f\n", "sparse", sparseSeconds * 1000.0, sparseFraction * 100.0,
+		denseSeconds / sparseSeconds);
+	printf("max height difference: %g\n", maxError);
+	return true;
+}
+
+bool bench::WaterNormals()
+{
+	static constexpr size_t Resolution = 2048;
+	static constexpr unsigned Steps = 64;
+	WaterSurface plain = makeSurface(Resolution);
+	const double stepSeconds = Measure([&plain] { plain.Step(); });
+	WaterSurface fused = makeSurface(Resolution);
+	fused.EnableNormals(true);
+	const double fusedSeconds = Measure([&fused] { fused.Step(); });
+	//every block changes in a dense step, so UpdateNormals() recomputes the whole map in a separate pass
+	WaterSurface separate = makeSurface(Resolution);
+	separate.EnableNormals(true);
+	using clock = chrono::steady_clock;
+	clock::duration normalsTime{ 0 };
+	for (unsigned i = 0; i < Steps; ++i)
+	{
+		separate.Step();
+		const auto start = clock::now();
+		separate.UpdateNormals();
+		normalsTime += clock::now() - start;
+	}
+	const double separateSeconds = chrono::duration<double>(normalsTime).count() / Steps;
+	printf("grid %zu: step %.3f ms, normals fused into the step +%.3f ms, normals in a separate pass +%.3f ms\n",
+		Resolution, stepSeconds * 1000.0, (fusedSeconds - stepSeconds) * 1000.0, separateSeconds * 1000.0);
+	return true;
+}
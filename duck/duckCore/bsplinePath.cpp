@@ -0,0 +1,132 @@
+#include "bsplinePath.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+namespace
+{
+	//3-point Gauss-Legendre quadrature on [-1, 1]
+	constexpr float GaussNodes[3] = { -0.774596669f, 0.0f, 0.774596669f };
+	constexpr float GaussWeights[3] = { 5.0f / 9.0f, 8.0f / 9.0f, 5.0f / 9.0f };
+}
+
+PathSegment::PathSegment(const PathPoint control[4])
+{
+	const float x[4] = { control[0].x, control[1].x, control[2].x, control[3].x };
+	const float y[4] = { control[0].y, control[1].y, control[2].y, control[3].y };
+	bspline::Coefficients(x, m_x);
+	bspline::Coefficients(y, m_y);
+	constexpr float h = 1.0f / Samples;
+	//independent evaluations first, so the compiler can vectorize them
+	float nodeSpeeds[3][Samples];
+	for (size_t i = 0; i <= Samples; ++i)
+		m_speeds[i] = _speed(static_cast<float>(i) * h);
+	for (size_t k = 0; k < 3; ++k)
+	{
+		const float offset = 0.5f * (1.0f + GaussNodes[k]);
+		for (size_t i = 0; i < Samples; ++i)
+			nodeSpeeds[k][i] = _speed((static_cast<float>(i) + offset) * h);
+	}
+	m_lengths[0] = 0.0f;
+	for (size_t i = 0; i < Samples; ++i)
+	{
+		const float length = GaussWeights[0] * nodeSpeeds[0][i] + GaussWeights[1] * nodeSpeeds[1][i] + GaussWeights[2] * nodeSpeeds[2][i];
+		m_lengths[i + 1] = m_lengths[i] + 0.5f * h * length;
+	}
+}
+
+float PathSegment::_speed(float t) const
+{
+	const PathPoint d = Derivative(t);
+	return sqrt(d.x * d.x + d.y * d.y);
+}
+
+PathPoint PathSegment::Position(float t) const
+{
+	return { bspline::Evaluate(m_x, t), bspline::Evaluate(m_y, t) };
+}
+
+PathPoint PathSegment::Derivative(float t) const
+{
+	return { bspline::Derivative(m_x, t), bspline::Derivative(m_y, t) };
+}
+
+float PathSegment::Parameter(float s, size_t& hint) const
+{
+	s = clamp(s, 0.0f, Length());
+	size_t i = min(hint, Samples - 1);
+	while (i > 0 && m_lengths[i] > s)
+		--i;
+	while (i < Samples - 1 && m_lengths[i + 1] < s)
+		++i;
+	hint = i;
+	return bspline::ArcParameter(m_lengths, m_speeds, Samples, i, s);
+}
+
+BSplinePath::BSplinePath(PathPoint min, PathPoint max, uint32_t seed)
+	: m_min(min), m_max(max), m_random(seed), m_segmentIndex(0), m_distance(0.0f), m_t(0.0f), m_sample(0)
+{
+	m_control[0] = _randomPoint({ 0.5f * (min.x + max.x), 0.5f * (min.y + max.y) });
+	for (int i = 1; i < 4; ++i)
+		m_control[i] = _randomPoint(m_control[i - 1]);
+	m_segment = PathSegment(m_control);
+}
+
+PathPoint gk2::RandomPathPoint(mt19937& random, PathPoint min, PathPoint max, PathPoint prev, float minSpacing)
+{
+	uniform_real_distribution<float> x(min.x, max.x), y(min.y, max.y);
+	PathPoint p;
+	//bounded number of attempts, the rectangle may be too small for the spacing
+	for (int attempt = 0; attempt < 16; ++attempt)
+	{
+		p = { x(random), y(random) };
+		if (hypot(p.x - prev.x, p.y - prev.y) >= minSpacing)
+			break;
+	}
+	return p;
+}
+
+PathPoint BSplinePath::_randomPoint(PathPoint prev)
+{
+	return RandomPathPoint(m_random, m_min, m_max, prev, MinSpacing * min(m_max.x - m_min.x, m_max.y - m_min.y));
+}
+
+void BSplinePath::_nextSegment()
+{
+	copy(m_control + 1, m_control + 4, m_control);
+	m_control[3] = _randomPoint(m_control[2]);
+	m_segment = PathSegment(m_control);
+	++m_segmentIndex;
+	m_sample = 0;
+}
+
+void BSplinePath::Advance(float distance)
+{
+	m_distance += max(distance, 0.0f);
+	while (m_distance >= m_segment.Length())
+	{
+		m_distance -= m_segment.Length();
+		_nextSegment();
+	}
+	m_t = m_segment.Parameter(m_distance, m_sample);
+}
+
+PathPoint BSplinePath::Direction() const
+{
+	PathPoint d = m_segment.Derivative(m_t);
+	float length = hypot(d.x, d.y);
+	if (length <= 1e-6f)
+	{
+		//cusp, fall back to the direction of the table interval
+		const PathPoint a = m_segment.Position(static_cast<float>(m_sample) / PathSegment::Samples);
+		const PathPoint b = m_segment.Position(static_cast<float>(m_sample + 1) / PathSegment::Samples);
+		d = { b.x - a.x, b.y - a.y };
+		length = hypot(d.x, d.y);
+		if (length <= 0.0f)
+			return { 1.0f, 0.0f };
+	}
+	return { d.x / length, d.y / length };
+}
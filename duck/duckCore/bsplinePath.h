@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+
+namespace mini
+{
+	namespace gk2
+	{
+		struct PathPoint
+		{
+			float x, y;
+		};
+
+		namespace bspline
+		{
+			//Basis matrix of the uniform cubic B-spline. A segment with control points P0..P3 is
+			//	P(t) = [t^3 t^2 t 1] * Basis * [P0 P1 P2 P3]^T, t in [0, 1]
+			constexpr float Basis[4][4] = {
+				{ -1.0f / 6.0f,  3.0f / 6.0f, -3.0f / 6.0f, 1.0f / 6.0f },
+				{  3.0f / 6.0f, -6.0f / 6.0f,  3.0f / 6.0f, 0.0f },
+				{ -3.0f / 6.0f,  0.0f,         3.0f / 6.0f, 0.0f },
+				{  1.0f / 6.0f,  4.0f / 6.0f,  1.0f / 6.0f, 0.0f }
+			};
+
+			//coefficients of t^3, t^2, t and 1 of one coordinate of a segment (Basis * control)
+			inline void Coefficients(const float control[4], float out[4])
+			{
+				for (int i = 0; i < 4; ++i)
+					out[i] = Basis[i][0] * control[0] + Basis[i][1] * control[1] + Basis[i][2] * control[2] + Basis[i][3] * control[3];
+			}
+
+			inline float Evaluate(const float c[4], float t) { return ((c[0] * t + c[1]) * t + c[2]) * t + c[3]; }
+			inline float Derivative(const float c[4], float t) { return (3.0f * c[0] * t + 2.0f * c[1]) * t + c[2]; }
+
+			//Parameter of the point at distance s along a segment, for s in interval i of the tables of arc lengths
+			//and speeds at samples + 1 uniformly spaced parameters (see PathSegment).
+			//Cubic Hermite interpolation of the parameter as a function of distance, with the slopes dt/ds known from
+			//the speeds, no root finding involved. Slopes are limited (Fritsch-Carlson), so the interpolant stays
+			//monotonic near cusps, where the speed drops to zero.
+			inline float ArcParameter(const float* lengths, const float* speeds, size_t samples, size_t i, float s)
+			{
+				const float interval = lengths[i + 1] - lengths[i];
+				if (!(interval > 0.0f))
+					return static_cast<float>(i) / static_cast<float>(samples);
+				//a zero speed gives an infinite slope, clamped like any other
+				const float h = 1.0f / static_cast<float>(samples);
+				const float m0 = std::min(interval / (h * speeds[i]), 3.0f);
+				const float m1 = std::min(interval / (h * speeds[i + 1]), 3.0f);
+				const float f = (s - lengths[i]) / interval;
+				const float f2 = f * f, f3 = f2 * f;
+				const float u = (-2.0f * f3 + 3.0f * f2) + m0 * (f3 - 2.0f * f2 + f) + m1 * (f3 - f2);
+				return (static_cast<float>(i) + u) * h;
+			}
+		}
+
+		//random point of the rectangle [min, max], at least minSpacing away from prev if a few attempts find one
+		PathPoint RandomPathPoint(std::mt19937& random, PathPoint min, PathPoint max, PathPoint prev, float minSpacing);
+
+		//Single segment of a uniform cubic B-spline in polynomial form, with a table of arc lengths and speeds
+		//at uniformly spaced parameters, which maps distance along the segment to the parameter.
+		class PathSegment
+		{
+		public:
+			static constexpr size_t Samples = 32;
+
+			PathSegment() = default;
+			explicit PathSegment(const PathPoint control[4]);
+
+			PathPoint Position(float t) const;
+			PathPoint Derivative(float t) const;
+			float Length() const { return m_lengths[Samples]; }
+			//parameter of the point at distance s from the start of the segment, s is clamped to [0, Length()].
+			//hint - index of the table interval to start looking from; the lookup is O(1) when s grows steadily.
+			float Parameter(float s, size_t& hint) const;
+
+			const float* X() const { return m_x; }
+			const float* Y() const { return m_y; }
+			//arc lengths from the start of the segment to Samples + 1 uniformly spaced parameters
+			const float* Lengths() const { return m_lengths; }
+			//lengths of the derivative at the same parameters
+			const float* Speeds() const { return m_speeds; }
+
+		private:
+			float _speed(float t) const;
+
+			float m_x[4] = {}, m_y[4] = {};
+			float m_lengths[Samples + 1] = {};
+			float m_speeds[Samples + 1] = {};
+		};
+
+		//Endless path of a duck swimming at constant speed inside a rectangle. The path is a uniform cubic
+		//B-spline over a stream of random control points; a B-spline stays inside the convex hull of its
+		//control points, so the duck never leaves the rectangle.
+		class BSplinePath
+		{
+		public:
+			//consecutive control points closer than this fraction of the rectangle size are generated again
+			static constexpr float MinSpacing = 0.25f;
+
+			BSplinePath(PathPoint min, PathPoint max, uint32_t seed = 5489u);
+
+			//moves the duck by distance along the path
+			void Advance(float distance);
+
+			PathPoint Position() const { return m_segment.Position(m_t); }
+			//unit tangent of the path at the position of the duck
+			PathPoint Direction() const;
+			//number of segments passed since the start
+			uint64_t SegmentIndex() const { return m_segmentIndex; }
+			const PathSegment& Segment() const { return m_segment; }
+			float SegmentParameter() const { return m_t; }
+
+		private:
+			PathPoint _randomPoint(PathPoint prev);
+			void _nextSegment();
+
+			PathPoint m_min, m_max;
+			std::mt19937 m_random;
+			//control points of the current segment
+			PathPoint m_control[4];
+			PathSegment m_segment;
+			uint64_t m_segmentIndex;
+			//distance travelled along the current segment and the corresponding parameter
+			float m_distance;
+			float m_t;
+			size_t m_sample;
+		};
+	}
+}
@@ -51,5 +51,21 @@ namespace mini
 			FloatTotalFrames
 			//end clock related
 		};
+
+		//How often values of constant buffer variables change, from the least to the most frequent:
+		//constant throughout a pass (e.g. material parameters), once per frame (camera and clock related semantics)
+		//or for every drawn object (model related semantics)
+		enum class UpdateFrequency
+		{
+			PerPass,
+			PerFrame,
+			PerObject
+		};
+
+		constexpr UpdateFrequency GetUpdateFrequency(VariableSemantic semantic)
+		{
+			return semantic >= VariableSemantic::MatM && semantic <= VariableSemantic::MatMVPInvT ?
+				UpdateFrequency::PerObject : UpdateFrequency::PerFrame;
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "cbufferPlan.h"
+#include <cassert>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+void CBufferPlan::Add(const void* source, size_t offset, size_t size)
+{
+	assert(offset + size <= m_bufferSize);
+	if (size == 0)
+		return;
+	const unsigned char* src = static_cast<const unsigned char*>(source);
+	if (!m_copies.empty())
+	{
+		CBufferCopy& last = m_copies.back();
+		if (last.source + last.size == src && last.offset + last.size == offset)
+		{
+			last.size += static_cast<uint32_t>(size);
+			return;
+		}
+	}
+	m_copies.push_back({ src, static_cast<uint32_t>(offset), static_cast<uint32_t>(size) });
+}
+
+void CBufferPlan::AddVersion(const uint64_t* version)
+{
+	m_versions.push_back(version);
+	m_seenVersions.push_back(*version);
+	m_filled = false;
+}
+
+bool CBufferPlan::TakeChanges()
+{
+	bool changed = !m_filled;
+	for (size_t i = 0; i < m_versions.size(); ++i)
+	{
+		const uint64_t version = *m_versions[i];
+		changed |= version != m_seenVersions[i];
+		m_seenVersions[i] = version;
+	}
+	m_filled = true;
+	return changed;
+}
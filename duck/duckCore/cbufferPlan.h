@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace mini
+{
+	namespace gk2
+	{
+		//Single copy of a plan: size bytes from source to offset of the constant buffer
+		struct CBufferCopy
+		{
+			const unsigned char* source;
+			uint32_t offset;
+			uint32_t size;
+		};
+
+		//Precompiled list of copies filling a constant buffer from variables living at fixed addresses.
+		//Names of the variables are resolved once, when the plan is built, so filling the buffer on every draw
+		//is a loop of memcpy calls. Copies adjacent both in memory and in the buffer are merged.
+		//The plan also watches version counters of the variables, incremented on their every change,
+		//so that a buffer whose variables are all unchanged isn't filled and uploaded again.
+		class CBufferPlan
+		{
+		public:
+			explicit CBufferPlan(size_t bufferSize = 0)
+				: m_bufferSize(bufferSize) { }
+
+			//source has to stay valid (and at the same address) as long as the plan is executed
+			void Add(const void* source, size_t offset, size_t size);
+			//version has to stay valid as long as TakeChanges() is called
+			void AddVersion(const uint64_t* version);
+
+			//Returns true if the buffer has to be filled: on the first call and whenever a watched version differs
+			//from the one seen by the previous call. Remembers the current versions.
+			bool TakeChanges();
+
+			void Execute(void* buffer) const
+			{
+				unsigned char* dst = static_cast<unsigned char*>(buffer);
+				for (const CBufferCopy& c : m_copies)
+					memcpy(dst + c.offset, c.source, c.size);
+			}
+
+			size_t BufferSize() const { return m_bufferSize; }
+			const std::vector<CBufferCopy>& Copies() const { return m_copies; }
+
+		private:
+			size_t m_bufferSize;
+			bool m_filled = false;
+			std::vector<CBufferCopy> m_copies;
+			std::vector<const uint64_t*> m_versions;
+			std::vector<uint64_t> m_seenVersions;
+		};
+	}
+}
@@ -0,0 +1,96 @@
+#include "dampingField.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+namespace
+{
+	//squared distance used for cells without any obstacle in range, finite so the envelope math stays NaN free
+	constexpr float Far = 1e20f;
+}
+
+DampingField::DampingField(size_t resolution)
+	: m_layout(resolution), m_values(m_layout.BufferSize(), 0.0f)
+{ }
+
+void DampingField::_distances1D(size_t count)
+{
+	//lower envelope of parabolas (q - p)^2 + input[p], m_boundaries[i] is where parabola i starts to be the lowest
+	const float* f = m_input.data();
+	size_t k = 0;
+	m_parabolas[0] = 0;
+	m_boundaries[0] = -numeric_limits<float>::infinity();
+	m_boundaries[1] = numeric_limits<float>::infinity();
+	auto intersection = [f](size_t q, size_t p) {
+		const double dq = static_cast<double>(q), dp = static_cast<double>(p);
+		return static_cast<float>(((f[q] + dq * dq) - (f[p] + dp * dp)) / (2.0 * (dq - dp)));
+	};
+	for (size_t q = 1; q < count; ++q)
+	{
+		float s = intersection(q, m_parabolas[k]);
+		//m_boundaries[0] is -infinity, so the loop never goes below the first parabola
+		while (s <= m_boundaries[k])
+			s = intersection(q, m_parabolas[--k]);
+		m_parabolas[++k] = q;
+		m_boundaries[k] = s;
+		m_boundaries[k + 1] = numeric_limits<float>::infinity();
+	}
+	k = 0;
+	for (size_t q = 0; q < count; ++q)
+	{
+		while (m_boundaries[k + 1] < static_cast<float>(q))
+			++k;
+		const float d = static_cast<float>(q) - static_cast<float>(m_parabolas[k]);
+		m_output[q] = min(d * d + f[m_parabolas[k]], Far);
+	}
+}
+
+void DampingField::_obstacleDistances(const vector<uint8_t>& obstacles)
+{
+	const size_t n = m_layout.resolution;
+	assert(obstacles.size() == n * n);
+	m_distances.resize(n * n);
+	m_input.resize(n);
+	m_output.resize(n);
+	m_boundaries.resize(n + 1);
+	m_parabolas.resize(n);
+	for (size_t x = 0; x < n; ++x)
+	{
+		for (size_t y = 0; y < n; ++y)
+			m_input[y] = obstacles[y * n + x] ? 0.0f : Far;
+		_distances1D(n);
+		for (size_t y = 0; y < n; ++y)
+			m_distances[y * n + x] = m_output[y];
+	}
+	for (size_t y = 0; y < n; ++y)
+	{
+		copy_n(m_distances.begin() + y * n, n, m_input.begin());
+		_distances1D(n);
+		copy_n(m_output.begin(), n, m_distances.begin() + y * n);
+	}
+}
+
+void DampingField::Generate(float maxDamping, float dampingRange, float cellSize, const vector<uint8_t>* obstacles)
+{
+	const size_t n = m_layout.resolution;
+	if (obstacles)
+		_obstacleDistances(*obstacles);
+	for (size_t y = 0; y < n; ++y)
+	{
+		float* row = m_values.data() + m_layout.Index(0, y);
+		const size_t dy = min(y, n - 1 - y);
+		for (size_t x = 0; x < n; ++x)
+		{
+			//distance to the nearest edge, in cells
+			float l = static_cast<float>(min(min(x, n - 1 - x), dy));
+			if (obstacles)
+				l = min(l, sqrt(m_distances[y * n + x]));
+			row[x] = maxDamping * min(1.0f, l * cellSize / dampingRange);
+		}
+	}
+}
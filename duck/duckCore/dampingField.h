@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "gridLayout.h"
+
+namespace mini
+{
+	namespace gk2
+	{
+		//Per cell damping coefficients of the water surface, stored with the same layout as the heights,
+		//so the step kernels read both with the same offsets.
+		//Coefficient of a cell is maxDamping * min(1, l / dampingRange), where l is the distance to the nearest wall.
+		//Walls are the edges of the grid and the obstacle cells; cells next to the edges and obstacle cells
+		//get 0, which keeps their heights at 0 and makes the waves reflect off them.
+		class DampingField
+		{
+		public:
+			explicit DampingField(size_t resolution);
+
+			//obstacles - optional mask of resolution x resolution cells, non-zero for solid cells
+			//cellSize - distance between neighbouring cells
+			void Generate(float maxDamping, float dampingRange, float cellSize, const std::vector<uint8_t>* obstacles = nullptr);
+
+			const GridLayout& Layout() const { return m_layout; }
+			//pointer to the coefficient of cell (x, y)
+			const float* Data(size_t x, size_t y) const { return m_values.data() + m_layout.Index(x, y); }
+			float At(size_t x, size_t y) const { return *Data(x, y); }
+
+		private:
+			//Squared distances (in cells) from every cell to the nearest obstacle, computed exactly with
+			//two passes of a one-dimensional lower envelope of parabolas.
+			void _obstacleDistances(const std::vector<uint8_t>& obstacles);
+			void _distances1D(size_t count);
+
+			GridLayout m_layout;
+			AlignedFloats m_values;
+			//scratch buffers of the distance transform
+			std::vector<float> m_distances;
+			std::vector<float> m_input, m_output, m_boundaries;
+			std::vector<size_t> m_parabolas;
+		};
+	}
+}
@@ -0,0 +1,293 @@
+#include "frameGraph.h"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+void FrameGraph::Clear()
+{
+	m_textures.clear();
+	m_declaredTextures = 0;
+	m_passes.clear();
+	m_writers.clear();
+	m_order.clear();
+	m_steps.clear();
+	m_physical.clear();
+}
+
+uint32_t FrameGraph::AddTexture(const FrameTextureDesc& desc)
+{
+	//copies made by the last Compile follow the declared textures
+	m_textures.resize(m_declaredTextures);
+	m_textures.push_back({ desc, false, None, None, None });
+	return static_cast<uint32_t>(m_declaredTextures++);
+}
+
+uint32_t FrameGraph::ImportTexture(const FrameTextureDesc& desc)
+{
+	const uint32_t texture = AddTexture(desc);
+	m_textures[texture].imported = true;
+	return texture;
+}
+
+uint32_t FrameGraph::AddPass()
+{
+	m_passes.emplace_back();
+	return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+void FrameGraph::Read(uint32_t pass, uint32_t texture)
+{
+	assert(pass < m_passes.size() && texture < m_declaredTextures);
+	vector<uint32_t>& reads = m_passes[pass].reads;
+	if (find(reads.begin(), reads.end(), texture) == reads.end())
+		reads.push_back(texture);
+}
+
+void FrameGraph::Write(uint32_t pass, uint32_t texture, WriteMode mode)
+{
+	assert(pass < m_passes.size() && texture < m_declaredTextures);
+	assert(!_findWrite(pass, texture));
+	m_passes[pass].writes.push_back({ texture, mode });
+}
+
+void FrameGraph::KeepPass(uint32_t pass)
+{
+	m_passes[pass].kept = true;
+}
+
+uint32_t FrameGraph::ReadTexture(uint32_t pass, uint32_t texture) const
+{
+	const Pass& p = m_passes[pass];
+	const auto it = find(p.reads.begin(), p.reads.end(), texture);
+	assert(it != p.reads.end() && p.readSources.size() == p.reads.size());
+	return p.readSources[it - p.reads.begin()];
+}
+
+const FrameGraph::WriteAccess* FrameGraph::_findWrite(uint32_t pass, uint32_t texture) const
+{
+	for (const WriteAccess& w : m_passes[pass].writes)
+		if (w.texture == texture)
+			return &w;
+	return nullptr;
+}
+
+size_t FrameGraph::_writerIndex(uint32_t pass, uint32_t texture) const
+{
+	const vector<Writer>& writers = m_writers[texture];
+	for (size_t i = 0; i < writers.size(); ++i)
+		if (writers[i].pass == pass)
+			return i;
+	assert(false);
+	return writers.size();
+}
+
+void FrameGraph::Compile()
+{
+	m_textures.resize(m_declaredTextures);
+	for (Texture& t : m_textures)
+		t.physical = t.firstUse = t.lastUse = None;
+	m_writers.assign(m_declaredTextures, {});
+	for (uint32_t pass = 0; pass < m_passes.size(); ++pass)
+	{
+		Pass& p = m_passes[pass];
+		p.live = false;
+		p.readSources = p.reads;
+		for (const WriteAccess& w : p.writes)
+			m_writers[w.texture].push_back({ pass, w.mode });
+	}
+	_cull();
+	_sort();
+	_schedule();
+	_alias();
+}
+
+void FrameGraph::_cull()
+{
+	vector<uint32_t> pending;
+	const auto keep = [&](uint32_t pass) {
+		if (m_passes[pass].live)
+			return;
+		m_passes[pass].live = true;
+		pending.push_back(pass);
+	};
+	//the contents of a texture before the writer at index end come from the writers back to the last
+	//one not loading the previous contents
+	const auto require = [&](uint32_t texture, size_t end) {
+		const vector<Writer>& writers = m_writers[texture];
+		for (size_t i = end; i-- > 0;)
+		{
+			keep(writers[i].pass);
+			if (writers[i].mode != WriteMode::Load)
+				break;
+		}
+	};
+	for (uint32_t pass = 0; pass < m_passes.size(); ++pass)
+		if (m_passes[pass].kept)
+			keep(pass);
+	for (uint32_t texture = 0; texture < m_declaredTextures; ++texture)
+		if (m_textures[texture].imported)
+			require(texture, m_writers[texture].size());
+	while (!pending.empty())
+	{
+		const uint32_t pass = pending.back();
+		pending.pop_back();
+		const Pass& p = m_passes[pass];
+		for (uint32_t texture : p.reads)
+			require(texture, _findWrite(pass, texture) ? _writerIndex(pass, texture) : m_writers[texture].size());
+		for (const WriteAccess& w : p.writes)
+			if (w.mode == WriteMode::Load)
+				require(w.texture, _writerIndex(pass, w.texture));
+	}
+}
+
+void FrameGraph::_sort()
+{
+	const size_t count = m_passes.size();
+	vector<vector<uint32_t>> next(count);
+	vector<uint32_t> incoming(count, 0);
+	const auto depend = [&](uint32_t before, uint32_t after) {
+		next[before].push_back(after);
+		++incoming[after];
+	};
+	for (uint32_t texture = 0; texture < m_declaredTextures; ++texture)
+	{
+		uint32_t last = None;
+		for (const Writer& w : m_writers[texture])
+		{
+			if (!m_passes[w.pass].live)
+				continue;
+			if (last != None)
+				depend(last, w.pass);
+			last = w.pass;
+		}
+		m_writers[texture].erase(remove_if(m_writers[texture].begin(), m_writers[texture].end(),
+			[this](const Writer& w) { return !m_passes[w.pass].live; }), m_writers[texture].end());
+	}
+	for (uint32_t pass = 0; pass < count; ++pass)
+	{
+		if (!m_passes[pass].live)
+			continue;
+		for (uint32_t texture : m_passes[pass].reads)
+			if (!m_writers[texture].empty() && !_findWrite(pass, texture))
+				depend(m_writers[texture].back().pass, pass);
+	}
+	//of the passes ready to run the one added first goes next
+	priority_queue<uint32_t, vector<uint32_t>, greater<uint32_t>> ready;
+	size_t live = 0;
+	for (uint32_t pass = 0; pass < count; ++pass)
+		if (m_passes[pass].live)
+		{
+			++live;
+			if (incoming[pass] == 0)
+				ready.push(pass);
+		}
+	m_order.clear();
+	while (!ready.empty())
+	{
+		const uint32_t pass = ready.top();
+		ready.pop();
+		m_order.push_back(pass);
+		for (uint32_t after : next[pass])
+			if (--incoming[after] == 0)
+				ready.push(after);
+	}
+	if (m_order.size() != live)
+		throw logic_error("Passes of the frame graph depend on each other in a cycle");
+}
+
+void FrameGraph::_use(uint32_t texture)
+{
+	Texture& t = m_textures[texture];
+	const uint32_t step = static_cast<uint32_t>(m_steps.size());
+	if (t.firstUse == None)
+		t.firstUse = step;
+	t.lastUse = step;
+}
+
+void FrameGraph::_schedule()
+{
+	m_steps.clear();
+	//textures whose contents were cleared or written earlier in the frame
+	vector<bool> defined(m_declaredTextures, false);
+	const auto clear = [&](uint32_t texture) {
+		_use(texture);
+		m_steps.push_back({ FrameStepType::Clear, texture, None });
+		defined[texture] = true;
+	};
+	for (uint32_t pass : m_order)
+	{
+		Pass& p = m_passes[pass];
+		for (size_t i = 0; i < p.reads.size(); ++i)
+		{
+			const uint32_t texture = p.reads[i];
+			const bool written = _findWrite(pass, texture) != nullptr;
+			const bool undefined = !defined[texture] && !m_textures[texture].imported;
+			if (!written)
+			{
+				if (undefined)
+					clear(texture);
+				continue;
+			}
+			//the pass reads the contents from before its writes from a copy
+			const uint32_t copy = static_cast<uint32_t>(m_textures.size());
+			m_textures.push_back({ m_textures[texture].desc, false, None, None, None });
+			defined.push_back(false);
+			p.readSources[i] = copy;
+			if (undefined)
+				clear(copy);
+			else
+			{
+				_use(texture);
+				_use(copy);
+				m_steps.push_back({ FrameStepType::Copy, copy, texture });
+			}
+		}
+		for (const WriteAccess& w : p.writes)
+			if (w.mode == WriteMode::Clear ||
+				(w.mode == WriteMode::Load && !defined[w.texture] && !m_textures[w.texture].imported))
+				clear(w.texture);
+		for (uint32_t texture : p.readSources)
+			_use(texture);
+		for (const WriteAccess& w : p.writes)
+		{
+			_use(w.texture);
+			defined[w.texture] = true;
+		}
+		m_steps.push_back({ FrameStepType::Pass, pass, None });
+	}
+}
+
+void FrameGraph::_alias()
+{
+	m_physical.clear();
+	vector<uint32_t> textures;
+	for (uint32_t texture = 0; texture < m_textures.size(); ++texture)
+		if (!m_textures[texture].imported && m_textures[texture].firstUse != None)
+			textures.push_back(texture);
+	stable_sort(textures.begin(), textures.end(), [this](uint32_t a, uint32_t b) {
+		return m_textures[a].firstUse < m_textures[b].firstUse;
+	});
+	//last step using each physical texture
+	vector<uint32_t> busyUntil;
+	for (uint32_t texture : textures)
+	{
+		Texture& t = m_textures[texture];
+		uint32_t physical = 0;
+		while (physical < m_physical.size() && !(m_physical[physical] == t.desc && busyUntil[physical] < t.firstUse))
+			++physical;
+		if (physical == m_physical.size())
+		{
+			m_physical.push_back(t.desc);
+			busyUntil.push_back(t.lastUse);
+		}
+		else
+			busyUntil[physical] = t.lastUse;
+		t.physical = physical;
+	}
+}
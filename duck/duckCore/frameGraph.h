@@ -0,0 +1,154 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace mini
+{
+	namespace gk2
+	{
+		//Size and format of a texture of a frame graph. Transient textures share memory only with textures
+		//of equal descriptions.
+		struct FrameTextureDesc
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			//format of the graphics API, e.g. a DXGI_FORMAT
+			uint32_t format = 0;
+
+			bool operator==(const FrameTextureDesc& other) const = default;
+		};
+
+		//What a pass expects of the contents of a texture it writes
+		enum class WriteMode : uint8_t
+		{
+			//contents written by the passes before are kept, a transient texture written first in a frame is cleared
+			Load,
+			//the texture is cleared before the pass
+			Clear,
+			//the pass writes every texel, previous contents are neither needed nor cleared
+			Overwrite,
+		};
+
+		enum class FrameStepType : uint8_t
+		{
+			Clear,
+			Copy,
+			Pass,
+		};
+
+		struct FrameStep
+		{
+			FrameStepType type;
+			//the pass executed, or the texture cleared or copied into
+			uint32_t index;
+			//texture copied from
+			uint32_t source;
+		};
+
+		//Declarative description of the passes of a frame and the textures they read and write, compiled into
+		//the steps executing them. The compiler:
+		//- culls passes whose writes aren't read by any pass kept. Passes writing imported textures, which are
+		//  read outside of the graph (e.g. the back buffer), and the ones marked with KeepPass are always kept.
+		//- orders the passes topologically. Passes writing a texture run in the order they were added, passes
+		//  reading a texture they don't write run after all passes writing it. Otherwise passes keep the order
+		//  they were added in. Dependencies forming a cycle throw std::logic_error.
+		//- inserts clears of transient textures only before their first use in a frame (unless the first pass
+		//  overwrites them) and before passes writing them with WriteMode::Clear. Imported textures are only
+		//  cleared for WriteMode::Clear, their owner prepares their contents.
+		//- inserts a copy of a texture before a pass reading and writing it, the pass reads the copy instead.
+		//- assigns transient textures, including copies, to physical textures. Textures whose lifetimes
+		//  (first to last step using them) don't overlap share a physical texture.
+		//Textures and passes are identified by indices returned by AddTexture, ImportTexture and AddPass.
+		class FrameGraph
+		{
+		public:
+			static constexpr uint32_t None = ~0u;
+
+			//removes all passes and textures
+			void Clear();
+
+			uint32_t AddTexture(const FrameTextureDesc& desc);
+			uint32_t ImportTexture(const FrameTextureDesc& desc);
+			uint32_t AddPass();
+			void Read(uint32_t pass, uint32_t texture);
+			//a pass writes a texture at most once
+			void Write(uint32_t pass, uint32_t texture, WriteMode mode = WriteMode::Load);
+			//the pass is never culled, e.g. because it has effects the graph doesn't know about
+			void KeepPass(uint32_t pass);
+
+			//Compiles the passes and textures added so far, replacing the results of the previous Compile
+			void Compile();
+
+			size_t PassCount() const { return m_passes.size(); }
+			//textures added and imported, followed by the copies made by Compile
+			size_t TextureCount() const { return m_textures.size(); }
+			const FrameTextureDesc& Desc(uint32_t texture) const { return m_textures[texture].desc; }
+			bool Imported(uint32_t texture) const { return m_textures[texture].imported; }
+
+			//passes kept, in the order of execution
+			const std::vector<uint32_t>& Order() const { return m_order; }
+			bool Culled(uint32_t pass) const { return !m_passes[pass].live; }
+			//clears, copies and passes in the order of execution
+			const std::vector<FrameStep>& Steps() const { return m_steps; }
+			//texture whose contents the pass reads as texture, a copy if the pass writes it too
+			uint32_t ReadTexture(uint32_t pass, uint32_t texture) const;
+			//physical texture of a transient texture, None for imported and unused textures
+			uint32_t Physical(uint32_t texture) const { return m_textures[texture].physical; }
+			const std::vector<FrameTextureDesc>& PhysicalTextures() const { return m_physical; }
+
+		private:
+			struct Texture
+			{
+				FrameTextureDesc desc;
+				bool imported;
+				uint32_t physical;
+				//steps of the first and last use, None if unused
+				uint32_t firstUse;
+				uint32_t lastUse;
+			};
+
+			struct WriteAccess
+			{
+				uint32_t texture;
+				WriteMode mode;
+			};
+
+			struct Pass
+			{
+				std::vector<uint32_t> reads;
+				std::vector<WriteAccess> writes;
+				//textures actually read, in the order of reads
+				std::vector<uint32_t> readSources;
+				bool kept = false;
+				bool live = false;
+			};
+
+			//writer of a texture, the chains of writers of textures are in the order passes were added
+			struct Writer
+			{
+				uint32_t pass;
+				WriteMode mode;
+			};
+
+			const WriteAccess* _findWrite(uint32_t pass, uint32_t texture) const;
+			//position of the pass in the chain of writers of the texture
+			size_t _writerIndex(uint32_t pass, uint32_t texture) const;
+			void _cull();
+			void _sort();
+			void _schedule();
+			void _alias();
+			void _use(uint32_t texture);
+
+			std::vector<Texture> m_textures;
+			//number of textures added, Compile appends its copies after them
+			size_t m_declaredTextures = 0;
+			std::vector<Pass> m_passes;
+
+			std::vector<std::vector<Writer>> m_writers;
+			std::vector<uint32_t> m_order;
+			std::vector<FrameStep> m_steps;
+			std::vector<FrameTextureDesc> m_physical;
+		};
+	}
+}
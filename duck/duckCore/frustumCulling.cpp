@@ -0,0 +1,162 @@
+#include "frustumCulling.h"
+#include "simdTarget.h"
+#include <algorithm>
+#include <cmath>
+
+//keeps the vector code evaluating the distances exactly like the scalar one
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+namespace
+{
+	//planes are combined in double precision, the far plane is a difference of two almost equal columns
+	CullingPlane normalized(double a, double b, double c, double d)
+	{
+		const double length = sqrt(a * a + b * b + c * c);
+		return { static_cast<float>(a / length), static_cast<float>(b / length), static_cast<float>(c / length),
+			static_cast<float>(d / length) };
+	}
+
+	float distance(const CullingPlane& p, float x, float y, float z)
+	{
+		return ((p.nx * x + p.ny * y) + p.nz * z) + p.d;
+	}
+}
+
+CullingFrustum gk2::ExtractFrustum(const float (&m)[4][4])
+{
+	//clip space coordinates are dot products of the point with the columns of m,
+	//the volume is -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	auto column = [&m](int j, int i) { return static_cast<double>(m[i][j]); };
+	CullingFrustum f;
+	for (int i = 0; i < 2; ++i)
+	{
+		f.planes[2 * i] = normalized(column(3, 0) + column(i, 0), column(3, 1) + column(i, 1),
+			column(3, 2) + column(i, 2), column(3, 3) + column(i, 3));
+		f.planes[2 * i + 1] = normalized(column(3, 0) - column(i, 0), column(3, 1) - column(i, 1),
+			column(3, 2) - column(i, 2), column(3, 3) - column(i, 3));
+	}
+	f.planes[4] = normalized(column(2, 0), column(2, 1), column(2, 2), column(2, 3));
+	f.planes[5] = normalized(column(3, 0) - column(2, 0), column(3, 1) - column(2, 1),
+		column(3, 2) - column(2, 2), column(3, 3) - column(2, 3));
+	return f;
+}
+
+CullingBatch::CullingBatch()
+	: m_size(0)
+{
+	SetSimdLevel(DetectSimdLevel());
+}
+
+void CullingBatch::SetSimdLevel(SimdLevel level)
+{
+	m_simdLevel = min(level, DetectSimdLevel());
+}
+
+void CullingBatch::Clear()
+{
+	for (AlignedFloats* v : { &m_x, &m_y, &m_z, &m_radius, &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY, &m_maxZ })
+		v->clear();
+	m_size = 0;
+}
+
+uint32_t CullingBatch::Add(const CullingSphere& sphere, const CullingBox& box)
+{
+	m_x.push_back(sphere.x);
+	m_y.push_back(sphere.y);
+	m_z.push_back(sphere.z);
+	m_radius.push_back(sphere.radius);
+	m_minX.push_back(box.minX);
+	m_minY.push_back(box.minY);
+	m_minZ.push_back(box.minZ);
+	m_maxX.push_back(box.maxX);
+	m_maxY.push_back(box.maxY);
+	m_maxZ.push_back(box.maxZ);
+	return static_cast<uint32_t>(m_size++);
+}
+
+void CullingBatch::_cullScalar(const CullingFrustum& frustum, size_t begin, size_t end, vector<uint32_t>& visible) const
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		bool inside = true;
+		for (const CullingPlane& p : frustum.planes)
+		{
+			//the sphere is behind the plane if its center is farther than the radius,
+			//the box if its corner farthest along the normal is
+			const float sphere = distance(p, m_x[i], m_y[i], m_z[i]);
+			const float box = distance(p, p.nx >= 0.0f ? m_maxX[i] : m_minX[i], p.ny >= 0.0f ? m_maxY[i] : m_minY[i],
+				p.nz >= 0.0f ? m_maxZ[i] : m_minZ[i]);
+			inside = inside && sphere >= -m_radius[i] && box >= 0.0f;
+		}
+		if (inside)
+			visible.push_back(static_cast<uint32_t>(i));
+	}
+}
+
+#ifdef DUCK_SIMD_X86
+namespace
+{
+	//culls objects [0, count - count % 8), returns the number of objects processed
+	DUCK_TARGET("avx2")
+	size_t cullAVX2(const CullingFrustum& frustum, size_t count, const float* x, const float* y, const float* z,
+		const float* radius, const float* const (&minimum)[3], const float* const (&maximum)[3], vector<uint32_t>& visible)
+	{
+		//corner of the boxes farthest along each normal, chosen once per plane
+		const float* corners[6][3];
+		__m256 normals[6][4];
+		for (int p = 0; p < 6; ++p)
+		{
+			const CullingPlane& plane = frustum.planes[p];
+			const float n[3] = { plane.nx, plane.ny, plane.nz };
+			for (int c = 0; c < 3; ++c)
+			{
+				corners[p][c] = n[c] >= 0.0f ? maximum[c] : minimum[c];
+				normals[p][c] = _mm256_set1_ps(n[c]);
+			}
+			normals[p][3] = _mm256_set1_ps(plane.d);
+		}
+		const __m256 zero = _mm256_setzero_ps();
+		const size_t end = count / 8 * 8;
+		for (size_t i = 0; i < end; i += 8)
+		{
+			const __m256 cx = _mm256_load_ps(x + i), cy = _mm256_load_ps(y + i), cz = _mm256_load_ps(z + i);
+			const __m256 negRadius = _mm256_sub_ps(zero, _mm256_load_ps(radius + i));
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; ++p)
+			{
+				const __m256* n = normals[p];
+				__m256 sphere = _mm256_add_ps(_mm256_mul_ps(n[0], cx), _mm256_mul_ps(n[1], cy));
+				sphere = _mm256_add_ps(_mm256_add_ps(sphere, _mm256_mul_ps(n[2], cz)), n[3]);
+				__m256 box = _mm256_add_ps(_mm256_mul_ps(n[0], _mm256_load_ps(corners[p][0] + i)),
+					_mm256_mul_ps(n[1], _mm256_load_ps(corners[p][1] + i)));
+				box = _mm256_add_ps(_mm256_add_ps(box, _mm256_mul_ps(n[2], _mm256_load_ps(corners[p][2] + i))), n[3]);
+				inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(sphere, negRadius, _CMP_GE_OQ),
+					_mm256_cmp_ps(box, zero, _CMP_GE_OQ)));
+			}
+			const int mask = _mm256_movemask_ps(inside);
+			for (int lane = 0; lane < 8; ++lane)
+				if (mask & (1 << lane))
+					visible.push_back(static_cast<uint32_t>(i + lane));
+		}
+		return end;
+	}
+}
+#endif
+
+void CullingBatch::Cull(const CullingFrustum& frustum, vector<uint32_t>& visible) const
+{
+	visible.clear();
+	size_t done = 0;
+#ifdef DUCK_SIMD_X86
+	if (m_simdLevel >= SimdLevel::AVX2)
+		done = cullAVX2(frustum, m_size, m_x.data(), m_y.data(), m_z.data(), m_radius.data(),
+			{ m_minX.data(), m_minY.data(), m_minZ.data() }, { m_maxX.data(), m_maxY.data(), m_maxZ.data() }, visible);
+#endif
+	_cullScalar(frustum, done, m_size, visible);
+}
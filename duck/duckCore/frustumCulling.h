@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "gridLayout.h"
+#include "waterKernels.h"
+
+namespace mini
+{
+	namespace gk2
+	{
+		//Plane x * nx + y * ny + z * nz + d = 0 with a unit normal; points with a non-negative distance are in front of it
+		struct CullingPlane
+		{
+			float nx, ny, nz, d;
+		};
+
+		//Six planes bounding the view volume (left, right, bottom, top, near, far) with normals facing inside
+		struct CullingFrustum
+		{
+			CullingPlane planes[6];
+		};
+
+		struct CullingSphere
+		{
+			float x, y, z;
+			float radius;
+		};
+
+		struct CullingBox
+		{
+			float minX, minY, minZ;
+			float maxX, maxY, maxZ;
+		};
+
+		//Extracts the planes of the view volume from a view-projection matrix in row-vector convention
+		//(clip = [x y z 1] * viewProj) with the Direct3D depth range 0 <= z <= w.
+		CullingFrustum ExtractFrustum(const float (&viewProj)[4][4]);
+
+		//Bounding volumes of the draws of a pass, stored as structure of arrays and culled together.
+		//An object is visible when both its sphere and its box intersect the frustum; the sphere test is
+		//cheaper, the box one is tighter for elongated objects. Both are conservative.
+		class CullingBatch
+		{
+		public:
+			CullingBatch();
+
+			//removes all objects, keeping the memory
+			void Clear();
+			//returns the index of the object, indices are consecutive starting from 0 after Clear()
+			uint32_t Add(const CullingSphere& sphere, const CullingBox& box);
+			size_t Size() const { return m_size; }
+
+			//Replaces the contents of visible with the indices of the objects intersecting frustum, in increasing order
+			void Cull(const CullingFrustum& frustum, std::vector<uint32_t>& visible) const;
+
+			void SetSimdLevel(SimdLevel level);
+			SimdLevel GetSimdLevel() const { return m_simdLevel; }
+
+		private:
+			void _cullScalar(const CullingFrustum& frustum, size_t begin, size_t end, std::vector<uint32_t>& visible) const;
+
+			size_t m_size;
+			SimdLevel m_simdLevel;
+			//sphere centers and radii followed by box corners, one array per component
+			AlignedFloats m_x, m_y, m_z, m_radius;
+			AlignedFloats m_minX, m_minY, m_minZ, m_maxX, m_maxY, m_maxZ;
+		};
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <new>
+#include <cstddef>
+
+namespace mini
+{
+	namespace gk2
+	{
+		//Allocator returning memory aligned to Alignment bytes
+		template<typename T, size_t Alignment>
+		struct AlignedAllocator
+		{
+			using value_type = T;
+
+			template<typename U>
+			struct rebind
+			{
+				using other = AlignedAllocator<U, Alignment>;
+			};
+
+			AlignedAllocator() noexcept = default;
+			template<typename U>
+			AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept { }
+
+			T* allocate(size_t n)
+			{
+				return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{ Alignment }));
+			}
+			void deallocate(T* p, size_t) noexcept
+			{
+				::operator delete(p, std::align_val_t{ Alignment });
+			}
+
+			template<typename U>
+			bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+			template<typename U>
+			bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+		};
+
+		//Memory layout shared by all per cell arrays of a square simulation grid.
+		//Every row starts with Padding floats, whose last one is the left border cell, so the first simulated
+		//cell of each row is aligned to Alignment bytes. The row above the first and below the last simulated
+		//row and the cell right after each row form the rest of the one cell border.
+		struct GridLayout
+		{
+			static constexpr size_t Alignment = 64;
+			static constexpr size_t Padding = Alignment / sizeof(float);
+
+			explicit GridLayout(size_t resolution)
+				: resolution(resolution), pitch((Padding + resolution + 1 + Padding - 1) / Padding * Padding)
+			{ }
+
+			size_t BufferSize() const { return (resolution + 2) * pitch; }
+			size_t Index(size_t x, size_t y) const { return (y + 1) * pitch + Padding + x; }
+
+			size_t resolution;
+			//distance (in floats) between the beginnings of consecutive rows
+			size_t pitch;
+		};
+
+		using AlignedFloats = std::vector<float, AlignedAllocator<float, GridLayout::Alignment>>;
+	}
+}
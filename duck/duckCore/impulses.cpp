@@ -0,0 +1,85 @@
+#include "impulses.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+ImpulseQueue::ImpulseQueue(size_t capacity)
+	: m_tail(0), m_head(0), m_dropped(0)
+{
+	size_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+	m_mask = size - 1;
+	m_slots = make_unique<Slot[]>(size);
+	for (size_t i = 0; i < size; ++i)
+		m_slots[i].sequence.store(i, memory_order_relaxed);
+}
+
+bool ImpulseQueue::Push(const Impulse& impulse)
+{
+	size_t position = m_tail.load(memory_order_relaxed);
+	Slot* slot;
+	while (true)
+	{
+		slot = &m_slots[position & m_mask];
+		const size_t sequence = slot->sequence.load(memory_order_acquire);
+		const auto diff = static_cast<ptrdiff_t>(sequence - position);
+		if (diff == 0)
+		{
+			if (m_tail.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			//slot still holds an impulse from the previous lap
+			m_dropped.fetch_add(1, memory_order_relaxed);
+			return false;
+		}
+		else
+			position = m_tail.load(memory_order_relaxed);
+	}
+	slot->impulse = impulse;
+	slot->sequence.store(position + 1, memory_order_release);
+	return true;
+}
+
+size_t ImpulseQueue::Drain(vector<Impulse>& out)
+{
+	size_t count = 0;
+	while (true)
+	{
+		Slot& slot = m_slots[m_head & m_mask];
+		//stops at an empty slot, or at one claimed by a producer which has not finished writing it yet
+		if (slot.sequence.load(memory_order_acquire) != m_head + 1)
+			return count;
+		out.push_back(slot.impulse);
+		slot.sequence.store(m_head + m_mask + 1, memory_order_release);
+		++m_head;
+		++count;
+	}
+}
+
+RainSource::RainSource(size_t resolution, uint32_t seed)
+	: m_resolution(resolution), m_random(seed), m_carry(0.0f)
+{ }
+
+size_t RainSource::Generate(ImpulseQueue& queue, float dt, float rate, float radius, float amplitude)
+{
+	const float expected = max(rate, 0.0f) * dt + m_carry;
+	const auto count = static_cast<size_t>(expected);
+	m_carry = expected - static_cast<float>(count);
+	uniform_real_distribution<float> position(0.0f, static_cast<float>(m_resolution));
+	size_t pushed = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float x = position(m_random);
+		const float y = position(m_random);
+		if (queue.Push({ x, y, radius, amplitude }))
+			++pushed;
+	}
+	return pushed;
+}
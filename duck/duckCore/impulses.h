@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+
+namespace mini
+{
+	namespace gk2
+	{
+		//Disturbance of the water surface: a smooth bump of the given amplitude centered at (x, y).
+		//Position and radius are in grid cells.
+		struct Impulse
+		{
+			float x, y;
+			float radius;
+			float amplitude;
+		};
+
+		//Bounded queue of impulses. Any number of threads can push concurrently without locking,
+		//impulses are taken out by a single consumer (the water simulation).
+		class ImpulseQueue
+		{
+		public:
+			static constexpr size_t DefaultCapacity = 1 << 16;
+
+			//capacity is rounded up to a power of two
+			explicit ImpulseQueue(size_t capacity = DefaultCapacity);
+
+			ImpulseQueue(const ImpulseQueue&) = delete;
+			ImpulseQueue& operator=(const ImpulseQueue&) = delete;
+
+			//returns false and drops the impulse if the queue is full
+			bool Push(const Impulse& impulse);
+			//appends all impulses pushed so far to out and returns their number. Not thread-safe with other Drain calls.
+			size_t Drain(std::vector<Impulse>& out);
+
+			size_t Capacity() const { return m_mask + 1; }
+			uint64_t DroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+		private:
+			//slot is free for the producer at position p when sequence == p, and holds its impulse when sequence == p + 1
+			struct Slot
+			{
+				std::atomic<size_t> sequence;
+				Impulse impulse;
+			};
+
+			std::unique_ptr<Slot[]> m_slots;
+			size_t m_mask;
+			//separate cache lines, so producers don't slow down the consumer
+			alignas(64) std::atomic<size_t> m_tail;
+			alignas(64) size_t m_head;
+			std::atomic<uint64_t> m_dropped;
+		};
+
+		//Generates raindrops falling at random positions of a square grid.
+		class RainSource
+		{
+		public:
+			static constexpr float DefaultRate = 50.0f;
+			static constexpr float DefaultRadius = 2.0f;
+			static constexpr float DefaultAmplitude = 0.005f;
+
+			explicit RainSource(size_t resolution, uint32_t seed = 5489u);
+
+			//Pushes drops falling during dt seconds into queue and returns their number.
+			//rate - drops per second, radius - drop radius in cells
+			size_t Generate(ImpulseQueue& queue, float dt, float rate, float radius, float amplitude);
+
+		private:
+			size_t m_resolution;
+			std::mt19937 m_random;
+			//fraction of a drop left over from the previous call
+			float m_carry;
+		};
+	}
+}
@@ -0,0 +1,278 @@
+#include "nullCommandExecutor.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+const void* const NullCommandExecutor::Unknown = reinterpret_cast<const void*>(~uintptr_t(0));
+
+namespace
+{
+	constexpr uint32_t UnknownTopology = ~0u;
+}
+
+void NullCommandExecutor::Reset()
+{
+	m_stats = {};
+	m_errors.clear();
+	_invalidate();
+}
+
+void NullCommandExecutor::_invalidate()
+{
+	fill(begin(m_shaders), end(m_shaders), Unknown);
+	for (size_t stage = 0; stage < Stages; ++stage)
+	{
+		fill(begin(m_constantBuffers[stage]), end(m_constantBuffers[stage]), Unknown);
+		fill(begin(m_shaderResources[stage]), end(m_shaderResources[stage]), Unknown);
+		fill(begin(m_samplers[stage]), end(m_samplers[stage]), Unknown);
+	}
+	m_inputLayout = Unknown;
+	m_topology = UnknownTopology;
+	m_indexBuffer = Unknown;
+	fill(begin(m_vertexBuffers), end(m_vertexBuffers), VertexBufferBinding{ Unknown, 0, 0 });
+	m_rasterizerState = Unknown;
+	m_viewportCount = commandLimits::ViewportSlots + 1;
+	m_renderTargetCount = commandLimits::RenderTargetSlots + 1;
+	m_depthStencil = Unknown;
+}
+
+void NullCommandExecutor::_clear()
+{
+	fill(begin(m_shaders), end(m_shaders), nullptr);
+	for (size_t stage = 0; stage < Stages; ++stage)
+	{
+		fill(begin(m_constantBuffers[stage]), end(m_constantBuffers[stage]), nullptr);
+		fill(begin(m_shaderResources[stage]), end(m_shaderResources[stage]), nullptr);
+		fill(begin(m_samplers[stage]), end(m_samplers[stage]), nullptr);
+	}
+	m_inputLayout = nullptr;
+	m_topology = 0;
+	m_indexBuffer = nullptr;
+	fill(begin(m_vertexBuffers), end(m_vertexBuffers), VertexBufferBinding{ nullptr, 0, 0 });
+	m_rasterizerState = nullptr;
+	m_viewportCount = 0;
+	m_renderTargetCount = 0;
+	m_depthStencil = nullptr;
+}
+
+void NullCommandExecutor::_error(const Command& c, const char* message)
+{
+	++m_stats.errors;
+	if (m_errors.size() < MaxErrors)
+		m_errors.push_back({ m_stats.commands - 1, c.type, message });
+}
+
+bool NullCommandExecutor::_bind(const void** cached, uint32_t slots, const CommandList& commands, const Command& c)
+{
+	if (c.start > slots || c.count > slots - c.start)
+	{
+		_error(c, "slots out of range");
+		return true;
+	}
+	void* const* objects = commands.Payload<void*>(c);
+	bool changed = false;
+	for (uint32_t i = 0; i < c.count; ++i)
+	{
+		changed |= cached[c.start + i] != objects[i];
+		cached[c.start + i] = objects[i];
+	}
+	return changed;
+}
+
+void NullCommandExecutor::_validateDraw(const Command& c, bool indexed)
+{
+	if (c.count == 0)
+		_error(c, "draw of no vertices");
+	if (!m_shaders[static_cast<size_t>(ShaderStage::VS)])
+		_error(c, "draw without a vertex shader");
+	if (m_topology == 0)
+		_error(c, "draw without a primitive topology");
+	if (indexed && !m_inputLayout)
+		_error(c, "indexed draw without an input layout");
+	if (indexed && !m_indexBuffer)
+		_error(c, "indexed draw without an index buffer");
+	if (m_viewportCount == 0)
+		_error(c, "draw without viewports");
+	if (m_renderTargetCount == 0 && !m_depthStencil)
+		_error(c, "draw without render targets");
+}
+
+void NullCommandExecutor::Execute(const CommandList& commands)
+{
+	for (const Command& c : commands.Commands())
+	{
+		++m_stats.commands;
+		++m_stats.byType[static_cast<size_t>(c.type)];
+		_execute(commands, c);
+	}
+}
+
+void NullCommandExecutor::_execute(const CommandList& commands, const Command& c)
+{
+	const size_t stage = static_cast<size_t>(c.stage);
+	bool changed = true;
+	switch (c.type)
+	{
+	case CommandType::SetShader:
+		if (stage >= Stages)
+		{
+			_error(c, "invalid shader stage");
+			return;
+		}
+		changed = m_shaders[stage] != c.object;
+		m_shaders[stage] = c.object;
+		break;
+	case CommandType::SetConstantBuffers:
+	case CommandType::SetShaderResources:
+	case CommandType::SetSamplers:
+		if (stage >= Stages)
+		{
+			_error(c, "invalid shader stage");
+			return;
+		}
+		if (c.type == CommandType::SetConstantBuffers)
+			changed = _bind(m_constantBuffers[stage], commandLimits::ConstantBufferSlots, commands, c);
+		else if (c.type == CommandType::SetShaderResources)
+			changed = _bind(m_shaderResources[stage], commandLimits::ShaderResourceSlots, commands, c);
+		else
+			changed = _bind(m_samplers[stage], commandLimits::SamplerSlots, commands, c);
+		break;
+	case CommandType::SetInputLayout:
+		changed = m_inputLayout != c.object;
+		m_inputLayout = c.object;
+		break;
+	case CommandType::SetPrimitiveTopology:
+		if (c.args[0] == 0)
+			_error(c, "undefined primitive topology");
+		changed = m_topology != c.args[0];
+		m_topology = c.args[0];
+		break;
+	case CommandType::SetIndexBuffer:
+		changed = m_indexBuffer != c.object;
+		m_indexBuffer = c.object;
+		break;
+	case CommandType::SetVertexBuffers:
+	{
+		if (c.start > commandLimits::VertexBufferSlots || c.count > commandLimits::VertexBufferSlots - c.start)
+		{
+			_error(c, "slots out of range");
+			break;
+		}
+		const auto arrays = commands.VertexBuffers(c);
+		changed = false;
+		for (uint32_t i = 0; i < c.count; ++i)
+		{
+			VertexBufferBinding& cached = m_vertexBuffers[c.start + i];
+			const VertexBufferBinding binding{ arrays.buffers[i], arrays.strides[i], arrays.offsets[i] };
+			if (binding.buffer && binding.stride == 0)
+				_error(c, "vertex buffer of zero stride");
+			changed |= cached.buffer != binding.buffer || cached.stride != binding.stride ||
+				cached.offset != binding.offset;
+			cached = binding;
+		}
+		break;
+	}
+	case CommandType::SetRasterizerState:
+		changed = m_rasterizerState != c.object;
+		m_rasterizerState = c.object;
+		break;
+	case CommandType::SetViewports:
+	{
+		if (c.count > commandLimits::ViewportSlots)
+		{
+			_error(c, "too many viewports");
+			break;
+		}
+		const CommandViewport* viewports = commands.Payload<CommandViewport>(c);
+		for (uint32_t i = 0; i < c.count; ++i)
+			if (!(viewports[i].width > 0.0f && viewports[i].height > 0.0f &&
+				viewports[i].minDepth >= 0.0f && viewports[i].minDepth <= viewports[i].maxDepth &&
+				viewports[i].maxDepth <= 1.0f))
+				_error(c, "invalid viewport");
+		changed = m_viewportCount != c.count ||
+			(c.count > 0 && memcmp(m_viewports, viewports, c.count * sizeof(CommandViewport)) != 0);
+		m_viewportCount = c.count;
+		copy_n(viewports, c.count, m_viewports);
+		break;
+	}
+	case CommandType::SetScissorRects:
+		if (c.count > commandLimits::ViewportSlots)
+			_error(c, "too many scissor rects");
+		break;
+	//blend and depth stencil states are not needed by draws
+	case CommandType::SetBlendState:
+	case CommandType::SetDepthStencilState:
+		break;
+	case CommandType::SetRenderTargets:
+	{
+		if (c.count > commandLimits::RenderTargetSlots)
+		{
+			_error(c, "too many render targets");
+			break;
+		}
+		void* const* targets = commands.Payload<void*>(c);
+		changed = m_renderTargetCount != c.count || m_depthStencil != c.object;
+		for (uint32_t i = 0; i < c.count; ++i)
+			changed |= m_renderTargets[i] != targets[i];
+		m_renderTargetCount = c.count;
+		copy_n(targets, c.count, m_renderTargets);
+		m_depthStencil = c.object;
+		break;
+	}
+	case CommandType::ClearRenderTarget:
+		if (!c.object)
+			_error(c, "clear of a null render target");
+		break;
+	case CommandType::ClearDepthStencil:
+		if (!c.object)
+			_error(c, "clear of a null depth stencil view");
+		if (c.args[0] == 0)
+			_error(c, "depth stencil clear of nothing");
+		break;
+	case CommandType::UpdateBuffer:
+		if (!c.object)
+			_error(c, "update of a null buffer");
+		if (c.count == 0)
+			_error(c, "empty buffer update");
+		m_stats.updatedBytes += c.count;
+		break;
+	case CommandType::CopyResource:
+	{
+		const void* source = *commands.Payload<void*>(c);
+		if (!c.object || !source)
+			_error(c, "copy from or to a null resource");
+		else if (c.object == source)
+			_error(c, "copy of a resource onto itself");
+		break;
+	}
+	case CommandType::Draw:
+	case CommandType::DrawIndexed:
+	case CommandType::DrawIndexedInstanced:
+	{
+		const bool instanced = c.type == CommandType::DrawIndexedInstanced;
+		const uint32_t instances = instanced ? c.args[2] : 1;
+		if (instances == 0)
+			_error(c, "draw of no instances");
+		_validateDraw(c, c.type != CommandType::Draw);
+		++m_stats.draws;
+		m_stats.instances += instances;
+		m_stats.elements += c.count;
+		break;
+	}
+	case CommandType::ClearState:
+		_clear();
+		break;
+	case CommandType::Native:
+		if (c.args[0])
+			_invalidate();
+		break;
+	default:
+		_error(c, "unknown command");
+		break;
+	}
+	if (!changed)
+		++m_stats.redundant;
+}
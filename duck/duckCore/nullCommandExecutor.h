@@ -0,0 +1,105 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "commandList.h"
+
+namespace mini
+{
+	namespace gk2
+	{
+		struct CommandStats
+		{
+			size_t commands = 0;
+			size_t byType[static_cast<size_t>(CommandType::Count)] = {};
+			//draw commands of all kinds, and the instances they draw (1 for non-instanced ones)
+			size_t draws = 0;
+			size_t instances = 0;
+			//vertices or indices read by draws, per instance
+			size_t elements = 0;
+			size_t updatedBytes = 0;
+			//bindings of the objects already bound, which a state cache would drop
+			size_t redundant = 0;
+			size_t errors = 0;
+
+			size_t Count(CommandType type) const { return byType[static_cast<size_t>(type)]; }
+		};
+
+		struct CommandError
+		{
+			//index of the command among all executed since the last Reset
+			size_t command;
+			CommandType type;
+			const char* message;
+		};
+
+		//Executes command lists without any graphics API, so that recording of frames can be profiled and checked
+		//headless. Commands are counted and validated against the state bound by the previous ones, like a context
+		//would bind it: slot ranges have to fit the limits, draws need a vertex shader, primitive topology,
+		//render targets, viewports, an input layout and index buffer for indexed draws, updates and clears need objects.
+		//State bound before the first command, or changed by native callbacks, is unknown and assumed to be valid.
+		class NullCommandExecutor : public ICommandExecutor
+		{
+		public:
+			//at most this many errors are kept, all are counted
+			static constexpr size_t MaxErrors = 64;
+
+			NullCommandExecutor() { Reset(); }
+
+			void Execute(const CommandList& commands) override;
+
+			//forgets bound state, statistics and errors
+			void Reset();
+
+			const CommandStats& Stats() const { return m_stats; }
+			const std::vector<CommandError>& Errors() const { return m_errors; }
+
+		private:
+			static constexpr size_t Stages = static_cast<size_t>(ShaderStage::Count);
+
+			//Stands for an unknown binding, never equal to a valid object or nullptr
+			static const void* const Unknown;
+
+			struct VertexBufferBinding
+			{
+				const void* buffer;
+				uint32_t stride;
+				uint32_t offset;
+			};
+
+			void _execute(const CommandList& commands, const Command& c);
+			void _error(const Command& c, const char* message);
+			//forgets all bound objects
+			void _invalidate();
+			//all bound objects become null
+			void _clear();
+			//copies objects to slots [start, start + count) of cached, returns false if none changed
+			bool _bind(const void** cached, uint32_t slots, const CommandList& commands, const Command& c);
+			void _validateDraw(const Command& c, bool indexed);
+
+			CommandStats m_stats;
+			std::vector<CommandError> m_errors;
+
+			const void* m_shaders[Stages];
+			const void* m_constantBuffers[Stages][commandLimits::ConstantBufferSlots];
+			const void* m_shaderResources[Stages][commandLimits::ShaderResourceSlots];
+			const void* m_samplers[Stages][commandLimits::SamplerSlots];
+
+			const void* m_inputLayout;
+			//~0 stands for an unknown topology, 0 for an undefined one
+			uint32_t m_topology;
+			const void* m_indexBuffer;
+			VertexBufferBinding m_vertexBuffers[commandLimits::VertexBufferSlots];
+
+			const void* m_rasterizerState;
+			//ViewportSlots + 1 stands for unknown viewports
+			uint32_t m_viewportCount;
+			CommandViewport m_viewports[commandLimits::ViewportSlots];
+
+			//RenderTargetSlots + 1 stands for unknown targets
+			uint32_t m_renderTargetCount;
+			const void* m_renderTargets[commandLimits::RenderTargetSlots];
+			const void* m_depthStencil;
+		};
+	}
+}
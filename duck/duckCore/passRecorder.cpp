@@ -0,0 +1,39 @@
+#include "passRecorder.h"
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+void PassRecorder::AddBuffer(void* buffer, CBufferPlan&& plan, bool perObject)
+{
+	m_buffers.push_back({ buffer, move(plan), perObject });
+}
+
+void PassRecorder::Begin(CommandList& commands)
+{
+	m_stats = {};
+	_updateBuffers(commands, false);
+}
+
+void PassRecorder::_beginDraw(CommandList& commands, void* layout)
+{
+	_updateBuffers(commands, true);
+	commands.SetInputLayout(layout);
+}
+
+void PassRecorder::_updateBuffers(CommandList& commands, bool perObject)
+{
+	for (Buffer& b : m_buffers)
+	{
+		if (b.perObject != perObject)
+			continue;
+		if (!b.plan.TakeChanges())
+		{
+			++m_stats.skipped;
+			continue;
+		}
+		++m_stats.mapped;
+		//the plan fills the buffer in place, in the payload of the list
+		b.plan.Execute(commands.UpdateBuffer(b.buffer, static_cast<uint32_t>(b.plan.BufferSize())));
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "commandList.h"
+#include "cbufferPlan.h"
+#include "semanticTable.h"
+
+namespace mini
+{
+	namespace gk2
+	{
+		//constant buffers filled and uploaded, and the ones skipped because none of their variables changed
+		struct CBufferStats
+		{
+			size_t mapped = 0;
+			size_t skipped = 0;
+		};
+
+		//Records the draws of a render pass into command lists: fills the constant buffers of the pass from their plans,
+		//skipping the ones whose variables didn't change, then binds the input layout and buffers of each mesh.
+		//Objects are opaque pointers, so it doesn't depend on the graphics API. Model related semantics of the draws
+		//are kept in a table of the recorder, so recorders of different passes can be used concurrently.
+		class PassRecorder
+		{
+		public:
+			PassRecorder() : m_model(std::make_unique<SemanticTable>()) { }
+
+			//table read by the plans of the buffers, set before each draw
+			SemanticTable& ModelSemantics() { return *m_model; }
+			//Plan has to read model semantics from ModelSemantics(). Buffers changing per object are filled before
+			//every draw, the other ones at the beginning of the pass.
+			void AddBuffer(void* buffer, CBufferPlan&& plan, bool perObject);
+
+			//starts recording the draws of a pass and resets the statistics
+			void Begin(CommandList& commands);
+
+			//records a draw of mesh with the model semantics set
+			template<typename T>
+			void Draw(CommandList& commands, void* layout, const CommandMesh<T>& mesh)
+			{
+				_beginDraw(commands, layout);
+				if (commands.SetMesh(mesh))
+					commands.DrawIndexed(mesh.indexCount, 0, 0);
+			}
+
+			//Records a draw of instanceCount instances of mesh, starting at startInstance, whose per instance data is
+			//read from instances bound to slot. The model semantics are shared by all instances.
+			template<typename T>
+			void DrawInstanced(CommandList& commands, void* layout, const CommandMesh<T>& mesh, uint32_t slot,
+				T* instances, uint32_t stride, uint32_t instanceCount, uint32_t startInstance)
+			{
+				_beginDraw(commands, layout);
+				static constexpr uint32_t offset = 0;
+				commands.SetVertexBuffers(slot, 1, &instances, &stride, &offset);
+				if (instanceCount > 0 && commands.SetMesh(mesh))
+					commands.DrawIndexedInstanced(mesh.indexCount, instanceCount, 0, 0, startInstance);
+			}
+
+			//constant buffer updates recorded and skipped since the last Begin or ResetStats
+			const CBufferStats& Stats() const { return m_stats; }
+			void ResetStats() { m_stats = {}; }
+
+		private:
+			struct Buffer
+			{
+				void* buffer;
+				CBufferPlan plan;
+				bool perObject;
+			};
+
+			void _updateBuffers(CommandList& commands, bool perObject);
+			void _beginDraw(CommandList& commands, void* layout);
+
+			//allocated separately, so that plans keep pointing to it when the recorder is moved
+			std::unique_ptr<SemanticTable> m_model;
+			std::vector<Buffer> m_buffers;
+			CBufferStats m_stats;
+		};
+	}
+}
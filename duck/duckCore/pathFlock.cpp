@@ -0,0 +1,225 @@
+#include "pathFlock.h"
+#include "simdTarget.h"
+#include <algorithm>
+#include <cmath>
+
+//GCC would otherwise fuse the multiplies and adds into FMA instructions where the target allows it,
+//breaking bit-exactness with the scalar code
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+PathFlock::PathFlock(size_t count, PathPoint min, PathPoint max, uint32_t seed)
+	: m_count(count), m_min(min), m_max(max), m_minSpacing(BSplinePath::MinSpacing * std::min(max.x - min.x, max.y - min.y)),
+	m_random(seed), m_segments(0), m_distance(count), m_length(count), m_interval(count), m_tables(count * TableStride),
+	m_control(4 * count)
+{
+	SetSimdLevel(DetectSimdLevel());
+	for (size_t k = 0; k < 4; ++k)
+	{
+		m_cx[k].resize(count);
+		m_cy[k].resize(count);
+	}
+	const PathPoint center{ 0.5f * (min.x + max.x), 0.5f * (min.y + max.y) };
+	uniform_real_distribution<float> start(0.0f, 1.0f);
+	for (size_t i = 0; i < count; ++i)
+	{
+		PathPoint* control = m_control.data() + 4 * i;
+		control[0] = RandomPathPoint(m_random, min, max, center, m_minSpacing);
+		for (size_t k = 1; k < 4; ++k)
+			control[k] = RandomPathPoint(m_random, min, max, control[k - 1], m_minSpacing);
+		_setSegment(i);
+		m_distance[i] = start(m_random) * m_length[i];
+	}
+}
+
+void PathFlock::SetSimdLevel(SimdLevel level)
+{
+	m_simdLevel = std::min(level, DetectSimdLevel());
+}
+
+void PathFlock::_setSegment(size_t i)
+{
+	const PathSegment segment(m_control.data() + 4 * i);
+	for (size_t k = 0; k < 4; ++k)
+	{
+		m_cx[k][i] = segment.X()[k];
+		m_cy[k][i] = segment.Y()[k];
+	}
+	float* table = m_tables.data() + i * TableStride;
+	copy_n(segment.Lengths(), Samples + 1, table);
+	copy_n(segment.Speeds(), Samples + 1, table + Samples + 1);
+	m_length[i] = segment.Length();
+	m_interval[i] = 0;
+	++m_segments;
+}
+
+void PathFlock::_nextSegment(size_t i)
+{
+	PathPoint* control = m_control.data() + 4 * i;
+	copy(control + 1, control + 4, control);
+	control[3] = RandomPathPoint(m_random, m_min, m_max, control[2], m_minSpacing);
+	_setSegment(i);
+}
+
+void PathFlock::_wrap(size_t i)
+{
+	while (m_distance[i] >= m_length[i])
+	{
+		m_distance[i] -= m_length[i];
+		_nextSegment(i);
+	}
+}
+
+void PathFlock::_advanceScalar(size_t begin, size_t end, float distance, PathInstance* instances)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		m_distance[i] += distance;
+		if (m_distance[i] >= m_length[i])
+			_wrap(i);
+		const float s = m_distance[i];
+		const float* lengths = m_tables.data() + i * TableStride;
+		const float* speeds = lengths + Samples + 1;
+		int32_t k = m_interval[i];
+		while (k < static_cast<int32_t>(Samples) - 1 && lengths[k + 1] < s)
+			++k;
+		m_interval[i] = k;
+		const float t = bspline::ArcParameter(lengths, speeds, Samples, static_cast<size_t>(k), s);
+		const float cx[4] = { m_cx[0][i], m_cx[1][i], m_cx[2][i], m_cx[3][i] };
+		const float cy[4] = { m_cy[0][i], m_cy[1][i], m_cy[2][i], m_cy[3][i] };
+		const float dx = bspline::Derivative(cx, t);
+		const float dy = bspline::Derivative(cy, t);
+		const float length = sqrt(dx * dx + dy * dy);
+		PathInstance& instance = instances[i];
+		instance.x = bspline::Evaluate(cx, t);
+		instance.y = bspline::Evaluate(cy, t);
+		instance.dx = length > 0.0f ? dx / length : 1.0f;
+		instance.dy = length > 0.0f ? dy / length : 0.0f;
+	}
+}
+
+#ifdef DUCK_SIMD_X86
+namespace
+{
+	//Advances followers [begin, end), end - begin divisible by 8, with the same operations in the same order
+	//as PathFlock::_advanceScalar. Lanes which finish their segments are handed to wrap first.
+	template<typename Wrap>
+	DUCK_TARGET("avx2")
+	void advanceAVX2(size_t begin, size_t end, float distance, const AlignedFloats (&cx)[4], const AlignedFloats (&cy)[4],
+		float* distances, const float* segmentLengths, int32_t* intervals, const float* tables, PathInstance* instances,
+		Wrap&& wrap)
+	{
+		constexpr size_t Samples = PathFlock::Samples;
+		constexpr int32_t Stride = static_cast<int32_t>(PathFlock::TableStride);
+		const __m256 d = _mm256_set1_ps(distance);
+		const __m256 h = _mm256_set1_ps(1.0f / static_cast<float>(Samples));
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 two = _mm256_set1_ps(2.0f);
+		const __m256 three = _mm256_set1_ps(3.0f);
+		const __m256 minusTwo = _mm256_set1_ps(-2.0f);
+		const __m256i lastInterval = _mm256_set1_epi32(static_cast<int32_t>(Samples) - 1);
+		const __m256i speedOffset = _mm256_set1_epi32(static_cast<int32_t>(Samples) + 1);
+		const __m256i oneInt = _mm256_set1_epi32(1);
+		const __m256i laneOffsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(Stride));
+		for (size_t i = begin; i < end; i += 8)
+		{
+			__m256 s = _mm256_add_ps(_mm256_loadu_ps(distances + i), d);
+			_mm256_storeu_ps(distances + i, s);
+			int wrapped = _mm256_movemask_ps(_mm256_cmp_ps(s, _mm256_loadu_ps(segmentLengths + i), _CMP_GE_OQ));
+			if (wrapped)
+			{
+				for (size_t lane = 0; lane < 8; ++lane)
+					if (wrapped & (1 << lane))
+						wrap(i + lane);
+				s = _mm256_loadu_ps(distances + i);
+			}
+
+			//walk the tables forward to the intervals containing s
+			const __m256i base = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(i) * Stride), laneOffsets);
+			__m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(intervals + i));
+			__m256 next = _mm256_i32gather_ps(tables, _mm256_add_epi32(_mm256_add_epi32(base, k), oneInt), 4);
+			for (;;)
+			{
+				const __m256i step = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(next, s, _CMP_LT_OQ)),
+					_mm256_cmpgt_epi32(lastInterval, k));
+				if (_mm256_testz_si256(step, step))
+					break;
+				k = _mm256_sub_epi32(k, step);
+				next = _mm256_i32gather_ps(tables, _mm256_add_epi32(_mm256_add_epi32(base, k), oneInt), 4);
+			}
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(intervals + i), k);
+
+			//bspline::ArcParameter
+			const __m256i lengthIndex = _mm256_add_epi32(base, k);
+			const __m256 l0 = _mm256_i32gather_ps(tables, lengthIndex, 4);
+			const __m256i speedIndex = _mm256_add_epi32(lengthIndex, speedOffset);
+			const __m256 v0 = _mm256_i32gather_ps(tables, speedIndex, 4);
+			const __m256 v1 = _mm256_i32gather_ps(tables, _mm256_add_epi32(speedIndex, oneInt), 4);
+			const __m256 interval = _mm256_sub_ps(next, l0);
+			const __m256 m0 = _mm256_min_ps(_mm256_div_ps(interval, _mm256_mul_ps(h, v0)), three);
+			const __m256 m1 = _mm256_min_ps(_mm256_div_ps(interval, _mm256_mul_ps(h, v1)), three);
+			const __m256 f = _mm256_div_ps(_mm256_sub_ps(s, l0), interval);
+			const __m256 f2 = _mm256_mul_ps(f, f);
+			const __m256 f3 = _mm256_mul_ps(f2, f);
+			__m256 u = _mm256_add_ps(_mm256_mul_ps(minusTwo, f3), _mm256_mul_ps(three, f2));
+			u = _mm256_add_ps(u, _mm256_mul_ps(m0, _mm256_add_ps(_mm256_sub_ps(f3, _mm256_mul_ps(two, f2)), f)));
+			u = _mm256_add_ps(u, _mm256_mul_ps(m1, _mm256_sub_ps(f3, f2)));
+			const __m256 kf = _mm256_cvtepi32_ps(k);
+			__m256 t = _mm256_mul_ps(_mm256_add_ps(kf, u), h);
+			t = _mm256_blendv_ps(_mm256_mul_ps(kf, h), t, _mm256_cmp_ps(interval, zero, _CMP_GT_OQ));
+
+			//bspline::Evaluate and bspline::Derivative
+			const __m256 cx0 = _mm256_loadu_ps(cx[0].data() + i), cx1 = _mm256_loadu_ps(cx[1].data() + i);
+			const __m256 cx2 = _mm256_loadu_ps(cx[2].data() + i), cx3 = _mm256_loadu_ps(cx[3].data() + i);
+			const __m256 cy0 = _mm256_loadu_ps(cy[0].data() + i), cy1 = _mm256_loadu_ps(cy[1].data() + i);
+			const __m256 cy2 = _mm256_loadu_ps(cy[2].data() + i), cy3 = _mm256_loadu_ps(cy[3].data() + i);
+			const __m256 x = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(
+				_mm256_add_ps(_mm256_mul_ps(cx0, t), cx1), t), cx2), t), cx3);
+			const __m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(
+				_mm256_add_ps(_mm256_mul_ps(cy0, t), cy1), t), cy2), t), cy3);
+			const __m256 dx = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(three, cx0), t),
+				_mm256_mul_ps(two, cx1)), t), cx2);
+			const __m256 dy = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(three, cy0), t),
+				_mm256_mul_ps(two, cy1)), t), cy2);
+			const __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+			const __m256 moving = _mm256_cmp_ps(length, zero, _CMP_GT_OQ);
+			const __m256 ux = _mm256_blendv_ps(one, _mm256_div_ps(dx, length), moving);
+			const __m256 uy = _mm256_blendv_ps(zero, _mm256_div_ps(dy, length), moving);
+
+			//transpose to 8 instances of 4 floats
+			const __m256 xy0 = _mm256_unpacklo_ps(x, y), xy1 = _mm256_unpackhi_ps(x, y);
+			const __m256 uv0 = _mm256_unpacklo_ps(ux, uy), uv1 = _mm256_unpackhi_ps(ux, uy);
+			const __m256 a0 = _mm256_shuffle_ps(xy0, uv0, _MM_SHUFFLE(1, 0, 1, 0));
+			const __m256 a1 = _mm256_shuffle_ps(xy0, uv0, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 a2 = _mm256_shuffle_ps(xy1, uv1, _MM_SHUFFLE(1, 0, 1, 0));
+			const __m256 a3 = _mm256_shuffle_ps(xy1, uv1, _MM_SHUFFLE(3, 2, 3, 2));
+			float* out = &instances[i].x;
+			_mm256_storeu_ps(out, _mm256_permute2f128_ps(a0, a1, 0x20));
+			_mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(a2, a3, 0x20));
+			_mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(a0, a1, 0x31));
+			_mm256_storeu_ps(out + 24, _mm256_permute2f128_ps(a2, a3, 0x31));
+		}
+	}
+}
+#endif
+
+void PathFlock::Advance(float distance, PathInstance* instances)
+{
+	distance = std::max(distance, 0.0f);
+	size_t done = 0;
+#ifdef DUCK_SIMD_X86
+	if (m_simdLevel >= SimdLevel::AVX2)
+	{
+		done = m_count / 8 * 8;
+		advanceAVX2(0, done, distance, m_cx, m_cy, m_distance.data(), m_length.data(), m_interval.data(),
+			m_tables.data(), instances, [this](size_t i) { _wrap(i); });
+	}
+#endif
+	_advanceScalar(done, m_count, distance, instances);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+#include "bsplinePath.h"
+#include "gridLayout.h"
+#include "waterKernels.h"
+
+namespace mini
+{
+	namespace gk2
+	{
+		//Per instance data of a path follower, laid out for a vertex buffer: position and unit direction
+		struct PathInstance
+		{
+			float x, y;
+			float dx, dy;
+		};
+
+		//Many followers, each swimming at constant speed along its own endless B-spline path (see BSplinePath),
+		//advanced together in batches. State is kept in structure of arrays form: polynomial coefficients of the
+		//current segments for contiguous vector loads, and per follower tables of arc lengths and speeds read
+		//with gathers. Starting a new segment is rare and done by scalar code, in follower order, so all
+		//instruction sets produce bit-exact results.
+		class PathFlock
+		{
+		public:
+			static constexpr size_t Samples = PathSegment::Samples;
+			//floats of the tables of a single follower: Samples + 1 arc lengths followed by Samples + 1 speeds
+			static constexpr size_t TableStride = 2 * (Samples + 1);
+
+			//followers start at random points of their first segments
+			PathFlock(size_t count, PathPoint min, PathPoint max, uint32_t seed = 5489u);
+
+			size_t Count() const { return m_count; }
+
+			//Moves every follower by distance and writes their positions and directions to instances
+			//(Count() elements, e.g. a mapped instance buffer). Where the tangent vanishes the direction is (1, 0).
+			void Advance(float distance, PathInstance* instances);
+
+			void SetSimdLevel(SimdLevel level);
+			SimdLevel GetSimdLevel() const { return m_simdLevel; }
+			//number of segments started by all followers, including the first ones
+			uint64_t SegmentCount() const { return m_segments; }
+
+		private:
+			using AlignedInts = std::vector<int32_t, AlignedAllocator<int32_t, GridLayout::Alignment>>;
+
+			//replaces the segment of follower i with the next one of its path
+			void _nextSegment(size_t i);
+			void _setSegment(size_t i);
+			//subtracts the lengths of finished segments from the distance of follower i and starts new ones
+			void _wrap(size_t i);
+			void _advanceScalar(size_t begin, size_t end, float distance, PathInstance* instances);
+
+			size_t m_count;
+			PathPoint m_min, m_max;
+			float m_minSpacing;
+			std::mt19937 m_random;
+			SimdLevel m_simdLevel;
+			uint64_t m_segments;
+			//coefficients of t^3, t^2, t and 1 of the current segments, m_cx[k][i] for follower i
+			AlignedFloats m_cx[4], m_cy[4];
+			//distance travelled along the current segment, its length and the index of the table interval
+			AlignedFloats m_distance, m_length;
+			AlignedInts m_interval;
+			AlignedFloats m_tables;
+			//last four control points of every path
+			std::vector<PathPoint> m_control;
+		};
+	}
+}
@@ -0,0 +1,81 @@
+#include "renderQueue.h"
+#include <cassert>
+#include <cstring>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+uint32_t drawKey::QuantizeDepth(float depth)
+{
+	if (!(depth > 0.0f))
+		return 0;
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits >> (32 - DepthBits);
+}
+
+uint64_t drawKey::Make(const DrawKeyFields& fields)
+{
+	assert(fields.pass < MaxPasses && fields.shaders < MaxShaders && fields.layout < MaxLayouts &&
+		fields.textures < MaxTextures && fields.mesh < MaxMeshes);
+	return uint64_t(fields.pass & (MaxPasses - 1)) << PassShift |
+		uint64_t(fields.shaders & (MaxShaders - 1)) << ShaderShift |
+		uint64_t(fields.layout & (MaxLayouts - 1)) << LayoutShift |
+		uint64_t(fields.textures & (MaxTextures - 1)) << TextureShift |
+		uint64_t(fields.mesh & (MaxMeshes - 1)) << MeshShift |
+		QuantizeDepth(fields.depth);
+}
+
+void RenderQueue::Sort()
+{
+	//11 bit digits, 6 passes at most over 64 bit keys, with histograms still fitting in L1 cache
+	static constexpr int DigitBits = 11;
+	static constexpr int Digits = (64 + DigitBits - 1) / DigitBits;
+	static constexpr uint32_t Buckets = 1u << DigitBits;
+	m_sortPasses = 0;
+	const size_t n = m_items.size();
+	if (n < 2)
+		return;
+	//histograms of all digits are counted in a single pass
+	vector<uint32_t>& counts = m_counts;
+	counts.assign(Digits * Buckets, 0);
+	for (const Item& item : m_items)
+		for (int d = 0; d < Digits; ++d)
+			++counts[d * Buckets + ((item.key >> (DigitBits * d)) & (Buckets - 1))];
+	m_scratch.resize(n);
+	for (int d = 0; d < Digits; ++d)
+	{
+		uint32_t* count = counts.data() + d * Buckets;
+		const int shift = DigitBits * d;
+		//all keys have the same digit, the pass wouldn't move anything
+		if (count[(m_items[0].key >> shift) & (Buckets - 1)] == n)
+			continue;
+		uint32_t offset = 0;
+		for (uint32_t b = 0; b < Buckets; ++b)
+		{
+			const uint32_t c = count[b];
+			count[b] = offset;
+			offset += c;
+		}
+		for (const Item& item : m_items)
+			m_scratch[count[(item.key >> shift) & (Buckets - 1)]++] = item;
+		m_items.swap(m_scratch);
+		++m_sortPasses;
+	}
+}
+
+void RenderQueue::PassRanges(size_t passCount, vector<Range>& ranges) const
+{
+	assert(passCount <= drawKey::MaxPasses);
+	const Item* item = m_items.data();
+	const Item* end = item + m_items.size();
+	ranges.clear();
+	for (size_t pass = 0; pass < passCount; ++pass)
+	{
+		const Item* first = item;
+		while (item != end && drawKey::Pass(item->key) == pass)
+			++item;
+		ranges.emplace_back(first, item);
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace mini
+{
+	namespace gk2
+	{
+		//Values of the state used by a draw, from the most significant for the order of draws
+		struct DrawKeyFields
+		{
+			uint32_t pass;
+			uint32_t shaders;
+			uint32_t layout;
+			uint32_t textures;
+			uint32_t mesh;
+			//distance from the camera, draws of equal state go front to back
+			float depth;
+		};
+
+		//64 bit sort key of a draw. Sorted keys keep the order of passes and group draws of each pass binding the same
+		//shaders, input layouts, textures and meshes, so the fewest state changes are made. Identifiers have to fit
+		//in their fields, depth is kept with 16 bits of precision (negative depths are the same as 0).
+		namespace drawKey
+		{
+			constexpr int PassBits = 6;
+			constexpr int ShaderBits = 10;
+			constexpr int LayoutBits = 8;
+			constexpr int TextureBits = 10;
+			constexpr int MeshBits = 14;
+			constexpr int DepthBits = 16;
+			static_assert(PassBits + ShaderBits + LayoutBits + TextureBits + MeshBits + DepthBits == 64, "fields fill the key");
+
+			constexpr int MeshShift = DepthBits;
+			constexpr int TextureShift = MeshShift + MeshBits;
+			constexpr int LayoutShift = TextureShift + TextureBits;
+			constexpr int ShaderShift = LayoutShift + LayoutBits;
+			constexpr int PassShift = ShaderShift + ShaderBits;
+
+			constexpr uint32_t MaxPasses = 1u << PassBits;
+			constexpr uint32_t MaxShaders = 1u << ShaderBits;
+			constexpr uint32_t MaxLayouts = 1u << LayoutBits;
+			constexpr uint32_t MaxTextures = 1u << TextureBits;
+			constexpr uint32_t MaxMeshes = 1u << MeshBits;
+
+			uint64_t Make(const DrawKeyFields& fields);
+			//16 most significant bits of the float, which order like the values for non-negative ones
+			uint32_t QuantizeDepth(float depth);
+
+			constexpr uint32_t Pass(uint64_t key) { return static_cast<uint32_t>(key >> PassShift); }
+			constexpr uint32_t Shaders(uint64_t key) { return static_cast<uint32_t>(key >> ShaderShift) & (MaxShaders - 1); }
+			constexpr uint32_t Layout(uint64_t key) { return static_cast<uint32_t>(key >> LayoutShift) & (MaxLayouts - 1); }
+			constexpr uint32_t Textures(uint64_t key) { return static_cast<uint32_t>(key >> TextureShift) & (MaxTextures - 1); }
+			constexpr uint32_t Mesh(uint64_t key) { return static_cast<uint32_t>(key >> MeshShift) & (MaxMeshes - 1); }
+		}
+
+		//Draws of a frame, each a sort key and an index identifying the draw for whoever submits it.
+		//Sorting is a least significant digit radix sort of the keys, stable, so draws with equal keys stay
+		//in the order they were pushed. Digits equal in all keys, e.g. of unused fields, are skipped.
+		class RenderQueue
+		{
+		public:
+			struct Item
+			{
+				uint64_t key;
+				uint32_t draw;
+			};
+
+			//draws of a pass, [first, second)
+			using Range = std::pair<const Item*, const Item*>;
+
+			//removes all draws, keeping the memory
+			void Clear() { m_items.clear(); }
+			void Push(uint64_t key, uint32_t draw) { m_items.push_back({ key, draw }); }
+			void Sort();
+
+			size_t Size() const { return m_items.size(); }
+			bool Empty() const { return m_items.empty(); }
+			const std::vector<Item>& Items() const { return m_items; }
+			//Splits the sorted items into the draws of passes 0 to passCount - 1, which are contiguous, since the pass
+			//is the most significant field of the keys. passCount can't exceed drawKey::MaxPasses.
+			void PassRanges(size_t passCount, std::vector<Range>& ranges) const;
+			//number of passes over the items done by the last Sort
+			int SortPasses() const { return m_sortPasses; }
+
+		private:
+			std::vector<Item> m_items;
+			std::vector<Item> m_scratch;
+			std::vector<uint32_t> m_counts;
+			int m_sortPasses = 0;
+		};
+	}
+}
@@ -0,0 +1,327 @@
+#include "semanticTable.h"
+#include "simdTarget.h"
+#include <array>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+namespace
+{
+	using VS = VariableSemantic;
+
+	constexpr VS semanticOffset(VS s, int offset) { return static_cast<VS>(static_cast<int>(s) + offset); }
+	constexpr VS transposed(VS m) { return semanticOffset(m, 1); }
+	constexpr VS inverted(VS m) { return semanticOffset(m, 2); }
+	constexpr VS invertedTransposed(VS m) { return semanticOffset(m, 3); }
+	//bits of a matrix semantic, its transpose, inverse and inverse transpose
+	constexpr uint64_t family(VS m) { return SemanticTable::Bits(m, invertedTransposed(m)); }
+
+	float dot3(const float* a, const float* b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void cross3(const float* a, const float* b, float* out)
+	{
+		out[0] = a[1] * b[2] - a[2] * b[1];
+		out[1] = a[2] * b[0] - a[0] * b[2];
+		out[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	bool isAffine(const Float4x4& a)
+	{
+		return a.m[0][3] == 0.0f && a.m[1][3] == 0.0f && a.m[2][3] == 0.0f && a.m[3][3] == 1.0f;
+	}
+
+	//upper 3x3 part is a rotation scaled uniformly, s2 is the square of the scale
+	bool isSimilarity(const Float4x4& a, float& s2)
+	{
+		static constexpr float Epsilon = 1e-5f;
+		s2 = dot3(a.m[0], a.m[0]);
+		const float tolerance = Epsilon * s2;
+		return s2 != 0.0f &&
+			fabs(dot3(a.m[1], a.m[1]) - s2) <= tolerance && fabs(dot3(a.m[2], a.m[2]) - s2) <= tolerance &&
+			fabs(dot3(a.m[0], a.m[1])) <= tolerance && fabs(dot3(a.m[0], a.m[2])) <= tolerance &&
+			fabs(dot3(a.m[1], a.m[2])) <= tolerance;
+	}
+
+	//inverse of an affine matrix given the inverse of its upper 3x3 part, translation t becomes -t * A^-1
+	void affineInverse(const Float4x4& a, const float (&inv3)[3][3], Float4x4& out)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+				out.m[i][j] = inv3[i][j];
+			out.m[i][3] = 0.0f;
+		}
+		for (int j = 0; j < 3; ++j)
+			out.m[3][j] = -(a.m[3][0] * inv3[0][j] + a.m[3][1] * inv3[1][j] + a.m[3][2] * inv3[2][j]);
+		out.m[3][3] = 1.0f;
+	}
+}
+
+void matrix::Multiply(const Float4x4& a, const Float4x4& b, Float4x4& out)
+{
+#ifdef DUCK_SIMD_X86
+	//row i of the result is a combination of the rows of b, SSE2 is always there on x64
+	const __m128 b0 = _mm_load_ps(b.m[0]), b1 = _mm_load_ps(b.m[1]), b2 = _mm_load_ps(b.m[2]), b3 = _mm_load_ps(b.m[3]);
+	__m128 r[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		r[i] = _mm_mul_ps(_mm_set1_ps(a.m[i][0]), b0);
+		r[i] = _mm_add_ps(r[i], _mm_mul_ps(_mm_set1_ps(a.m[i][1]), b1));
+		r[i] = _mm_add_ps(r[i], _mm_mul_ps(_mm_set1_ps(a.m[i][2]), b2));
+		r[i] = _mm_add_ps(r[i], _mm_mul_ps(_mm_set1_ps(a.m[i][3]), b3));
+	}
+	//stored only after all of a is read, out may alias a or b
+	for (int i = 0; i < 4; ++i)
+		_mm_store_ps(out.m[i], r[i]);
+#else
+	Float4x4 result;
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			result.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+	out = result;
+#endif
+}
+
+void matrix::GeneralInverse(const Float4x4& a, Float4x4& out)
+{
+	const float* m = &a.m[0][0];
+	float inv[16];
+	inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+	inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+	inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+	inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+	inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+	inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+	inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+	inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+	inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+	inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+	inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+	inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+	inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+	inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+	inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+	inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+	const float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+	const float invDet = det != 0.0f ? 1.0f / det : 0.0f;
+	float* o = &out.m[0][0];
+	for (int i = 0; i < 16; ++i)
+		o[i] = inv[i] * invDet;
+}
+
+void matrix::Transpose(const Float4x4& a, Float4x4& out)
+{
+#ifdef DUCK_SIMD_X86
+	__m128 r0 = _mm_load_ps(a.m[0]), r1 = _mm_load_ps(a.m[1]), r2 = _mm_load_ps(a.m[2]), r3 = _mm_load_ps(a.m[3]);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_store_ps(out.m[0], r0);
+	_mm_store_ps(out.m[1], r1);
+	_mm_store_ps(out.m[2], r2);
+	_mm_store_ps(out.m[3], r3);
+#else
+	Float4x4 result;
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			result.m[i][j] = a.m[j][i];
+	out = result;
+#endif
+}
+
+void matrix::Inverse(const Float4x4& a, Float4x4& out)
+{
+	if (!isAffine(a))
+	{
+		GeneralInverse(a, out);
+		return;
+	}
+	float inv3[3][3];
+	float s2;
+	if (isSimilarity(a, s2))
+	{
+		//A = sR, so A^-1 = A^T / s^2
+		const float invS2 = 1.0f / s2;
+		for (int i = 0; i < 3; ++i)
+			for (int j = 0; j < 3; ++j)
+				inv3[i][j] = a.m[j][i] * invS2;
+	}
+	else
+	{
+		//columns of A^-1 are cross products of the rows of A divided by its determinant
+		float c[3][3];
+		cross3(a.m[1], a.m[2], c[0]);
+		cross3(a.m[2], a.m[0], c[1]);
+		cross3(a.m[0], a.m[1], c[2]);
+		const float det = dot3(a.m[0], c[0]);
+		const float invDet = det != 0.0f ? 1.0f / det : 0.0f;
+		for (int i = 0; i < 3; ++i)
+			for (int j = 0; j < 3; ++j)
+				inv3[i][j] = c[j][i] * invDet;
+	}
+	affineInverse(a, inv3, out);
+}
+
+SemanticTable::SemanticTable()
+	: m_present(0), m_read(0)
+{
+	memset(m_data, 0, sizeof(m_data));
+	for (uint64_t& v : m_versions)
+		v = 1;
+}
+
+void SemanticTable::_set(VariableSemantic s, const void* value)
+{
+	float* slot = m_data + _offset(s);
+	const size_t size = Size(s);
+	if (memcmp(slot, value, size) == 0)
+		return;
+	memcpy(slot, value, size);
+	++m_versions[static_cast<size_t>(s)];
+}
+
+void SemanticTable::_setMatrix(VariableSemantic s, const Float4x4& value)
+{
+	//offsets looked up rather than computed, this runs several times for every object
+	static constexpr auto Offsets = [] {
+		array<uint16_t, Count> offsets{};
+		for (size_t i = 0; i < Count; ++i)
+			offsets[i] = static_cast<uint16_t>(_offset(static_cast<VariableSemantic>(i)));
+		return offsets;
+	}();
+	float* slot = m_data + Offsets[static_cast<size_t>(s)];
+#ifdef DUCK_SIMD_X86
+	const __m128 r0 = _mm_load_ps(value.m[0]), r1 = _mm_load_ps(value.m[1]), r2 = _mm_load_ps(value.m[2]),
+		r3 = _mm_load_ps(value.m[3]);
+	const __m128 equal = _mm_and_ps(_mm_and_ps(_mm_cmpeq_ps(r0, _mm_load_ps(slot)), _mm_cmpeq_ps(r1, _mm_load_ps(slot + 4))),
+		_mm_and_ps(_mm_cmpeq_ps(r2, _mm_load_ps(slot + 8)), _mm_cmpeq_ps(r3, _mm_load_ps(slot + 12))));
+	if (_mm_movemask_ps(equal) == 0xf)
+		return;
+	_mm_store_ps(slot, r0);
+	_mm_store_ps(slot + 4, r1);
+	_mm_store_ps(slot + 8, r2);
+	_mm_store_ps(slot + 12, r3);
+#else
+	if (memcmp(slot, &value, sizeof(Float4x4)) == 0)
+		return;
+	memcpy(slot, &value, sizeof(Float4x4));
+#endif
+	++m_versions[static_cast<size_t>(s)];
+}
+
+void SemanticTable::_setMatrices(VariableSemantic m, const Float4x4& value, bool always)
+{
+	const uint64_t read = m_read & family(m);
+	if (always || (read & Bit(m)))
+		_setMatrix(m, value);
+	Float4x4 result;
+	if (read & Bit(transposed(m)))
+	{
+		matrix::Transpose(value, result);
+		_setMatrix(transposed(m), result);
+	}
+	if (!(read & Bits(inverted(m), invertedTransposed(m))))
+		return;
+	Float4x4 inv;
+	matrix::Inverse(value, inv);
+	if (read & Bit(inverted(m)))
+		_setMatrix(inverted(m), inv);
+	if (read & Bit(invertedTransposed(m)))
+	{
+		matrix::Transpose(inv, result);
+		_setMatrix(invertedTransposed(m), result);
+	}
+}
+
+void SemanticTable::_setView(const Float4x4& view)
+{
+	_setMatrix(VS::MatV, view);
+	Float4x4 transpose;
+	if (m_read & Bit(VS::MatVT))
+	{
+		matrix::Transpose(view, transpose);
+		_setMatrix(VS::MatVT, transpose);
+	}
+	if (!(m_read & (Bits(VS::MatVInv, VS::MatVInvT) | Bits(VS::Vec4CamPos, VS::Vec4CamUp))))
+		return;
+	//rows of the inverse view are camera axes and position
+	Float4x4 inv;
+	matrix::Inverse(view, inv);
+	_setMatrix(VS::MatVInv, inv);
+	matrix::Transpose(inv, transpose);
+	_setMatrix(VS::MatVInvT, transpose);
+	_set(VS::Vec4CamRight, inv.m[0]);
+	_set(VS::Vec4CamUp, inv.m[1]);
+	_set(VS::Vec4CamDir, inv.m[2]);
+	_set(VS::Vec4CamPos, inv.m[3]);
+}
+
+void SemanticTable::_updateViewProjection()
+{
+	if (!(m_read & family(VS::MatVP)))
+		return;
+	Float4x4 vp;
+	matrix::Multiply(_matrix(VS::MatV), _matrix(VS::MatP), vp);
+	_setMatrices(VS::MatVP, vp);
+}
+
+void SemanticTable::SetView(const Float4x4& view)
+{
+	_setView(view);
+	_updateViewProjection();
+}
+
+void SemanticTable::SetProjection(const Float4x4& projection)
+{
+	_setMatrices(VS::MatP, projection, true);
+	_updateViewProjection();
+}
+
+void SemanticTable::SetViewAndProjection(const Float4x4& view, const Float4x4& projection)
+{
+	_setView(view);
+	_setMatrices(VS::MatP, projection, true);
+	_updateViewProjection();
+}
+
+void SemanticTable::SetViewport(float width, float height, float fov, float nearPlane, float farPlane)
+{
+	const float dims[2] = { width, height };
+	_set(VS::Vec2ViewportDims, dims);
+	_setFloat(VS::FloatFOV, fov);
+	_setFloat(VS::FloatNearPlane, nearPlane);
+	_setFloat(VS::FloatFarPlane, farPlane);
+}
+
+void SemanticTable::SetModel(const Float4x4& model, const SemanticTable& frame)
+{
+	const uint64_t read = m_read & Bits(VS::MatM, VS::MatMVPInvT);
+	if (read == 0)
+		return;
+	if (read & family(VS::MatM))
+		_setMatrices(VS::MatM, model);
+	if (!(read & (family(VS::MatMV) | family(VS::MatMVP))))
+		return;
+	Float4x4 mv;
+	matrix::Multiply(model, frame._matrix(VS::MatV), mv);
+	if (read & family(VS::MatMV))
+		_setMatrices(VS::MatMV, mv);
+	if (read & family(VS::MatMVP))
+	{
+		Float4x4 mvp;
+		matrix::Multiply(mv, frame._matrix(VS::MatP), mvp);
+		_setMatrices(VS::MatMVP, mvp);
+	}
+}
+
+void SemanticTable::AdvanceClock(float dt, float fps)
+{
+	_setFloat(VS::FloatDT, dt);
+	_setFloat(VS::FloatT, *Data(VS::FloatT) + dt);
+	_setFloat(VS::FloatFPS, fps);
+	_setFloat(VS::FloatTotalFrames, *Data(VS::FloatTotalFrames) + 1.0f);
+}
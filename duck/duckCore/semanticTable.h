@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "cbVariableSemantics.h"
+
+namespace mini
+{
+	namespace gk2
+	{
+		//Row-major 4x4 matrix in the row-vector convention (p' = p * M), laid out like DirectX::XMFLOAT4X4
+		struct alignas(16) Float4x4
+		{
+			float m[4][4];
+		};
+
+		namespace matrix
+		{
+			void Multiply(const Float4x4& a, const Float4x4& b, Float4x4& out);
+			void Transpose(const Float4x4& a, Float4x4& out);
+			//Uses cheaper formulas for affine matrices, and for affine matrices whose upper 3x3 part
+			//is a rotation scaled uniformly (rigid transforms, uniformly scaled models)
+			void Inverse(const Float4x4& a, Float4x4& out);
+			//inverse of any invertible matrix, through the adjugate
+			void GeneralInverse(const Float4x4& a, Float4x4& out);
+		}
+
+		//Values of all variable semantics in a fixed size, cache aligned table indexed by the semantic.
+		//Matrices are stored contiguously, followed by vectors and floats. Only semantics read by some
+		//constant buffer (see MarkRead) are computed, V and P are always kept as others derive from them.
+		//Every slot has a version counter, incremented only when its value changes.
+		class SemanticTable
+		{
+		public:
+			static constexpr size_t Count = static_cast<size_t>(VariableSemantic::FloatTotalFrames) + 1;
+			static_assert(Count <= 64, "semantic masks are 64 bit");
+
+			static constexpr uint64_t Bit(VariableSemantic s) { return uint64_t(1) << static_cast<int>(s); }
+			//bits of semantics first to last inclusive
+			static constexpr uint64_t Bits(VariableSemantic first, VariableSemantic last)
+			{
+				return (Bit(last) << 1) - Bit(first);
+			}
+			static constexpr bool IsMatrix(VariableSemantic s)
+			{
+				return (s >= VariableSemantic::MatV && s <= VariableSemantic::MatVInvT) ||
+					(s >= VariableSemantic::MatVP && s <= VariableSemantic::MatPInvT) ||
+					(s >= VariableSemantic::MatM && s <= VariableSemantic::MatMVPInvT);
+			}
+			//size of the value in bytes
+			static constexpr size_t Size(VariableSemantic s)
+			{
+				if (IsMatrix(s))
+					return sizeof(Float4x4);
+				if (s >= VariableSemantic::Vec4CamPos && s <= VariableSemantic::Vec4CamUp)
+					return 4 * sizeof(float);
+				return s == VariableSemantic::Vec2ViewportDims ? 2 * sizeof(float) : sizeof(float);
+			}
+
+			SemanticTable();
+
+			//registers a semantic variable, the presence mask tells which semantics the application uses
+			void Add(VariableSemantic s) { m_present |= Bit(s); }
+			bool Has(VariableSemantic s) const { return (m_present & Bit(s)) != 0; }
+			uint64_t PresentMask() const { return m_present; }
+			//marks a semantic as read by a constant buffer, logically const like looking the value up
+			void MarkRead(VariableSemantic s) const { m_read |= Bit(s); }
+			uint64_t ReadMask() const { return m_read; }
+
+			const float* Data(VariableSemantic s) const { return m_data + _offset(s); }
+			const uint64_t& Version(VariableSemantic s) const { return m_versions[static_cast<size_t>(s)]; }
+
+			void SetView(const Float4x4& view);
+			void SetProjection(const Float4x4& projection);
+			void SetViewAndProjection(const Float4x4& view, const Float4x4& projection);
+			void SetViewport(float width, float height, float fov, float nearPlane, float farPlane);
+			//updates the model related semantics, using the current view and projection
+			void SetModel(const Float4x4& model) { SetModel(model, *this); }
+			//Updates the model related semantics of this table using the view and projection of frame, which is only
+			//read. Tables holding just the model semantics of different passes can be updated concurrently this way.
+			void SetModel(const Float4x4& model, const SemanticTable& frame);
+			//sets the frame time and fps, advances the total time and the frame count
+			void AdvanceClock(float dt, float fps);
+
+		private:
+			static constexpr size_t MatrixFloats = 16;
+			static constexpr size_t MatrixCount = 24;
+			static constexpr size_t VectorsOffset = MatrixCount * MatrixFloats;
+			static constexpr size_t ViewportOffset = VectorsOffset + 4 * 4;
+			static constexpr size_t FloatsOffset = ViewportOffset + 4;
+			//rounded up to whole cache lines
+			static constexpr size_t DataSize = (FloatsOffset + 7 + 15) / 16 * 16;
+
+			static constexpr size_t _offset(VariableSemantic s)
+			{
+				const size_t i = static_cast<size_t>(s);
+				if (s <= VariableSemantic::MatVInvT)
+					return i * MatrixFloats;
+				if (s <= VariableSemantic::Vec4CamUp)
+					return VectorsOffset + (i - static_cast<size_t>(VariableSemantic::Vec4CamPos)) * 4;
+				if (s <= VariableSemantic::MatPInvT)
+					return (i - 4) * MatrixFloats;
+				if (s == VariableSemantic::Vec2ViewportDims)
+					return ViewportOffset;
+				if (s <= VariableSemantic::FloatFarPlane)
+					return FloatsOffset + (i - static_cast<size_t>(VariableSemantic::FloatFOV));
+				if (s <= VariableSemantic::MatMVPInvT)
+					return (i - 8) * MatrixFloats;
+				return FloatsOffset + 3 + (i - static_cast<size_t>(VariableSemantic::FloatDT));
+			}
+
+			const Float4x4& _matrix(VariableSemantic s) const { return *reinterpret_cast<const Float4x4*>(Data(s)); }
+			//copies the value to its slot, bumping the version if it differs
+			void _set(VariableSemantic s, const void* value);
+			void _setFloat(VariableSemantic s, float value) { _set(s, &value); }
+			void _setMatrix(VariableSemantic s, const Float4x4& value);
+			//Sets matrix m, its transpose, inverse and inverse transpose (the ones that are read).
+			//m itself is stored also when it isn't read if always is true.
+			void _setMatrices(VariableSemantic m, const Float4x4& value, bool always = false);
+			void _setView(const Float4x4& view);
+			void _updateViewProjection();
+
+			alignas(64) float m_data[DataSize];
+			uint64_t m_versions[Count];
+			uint64_t m_present;
+			mutable uint64_t m_read;
+		};
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+//DUCK_SIMD_X86 is defined when building for x86, where kernels for several instruction sets are compiled
+//and one of them is picked at run time (see DetectSimdLevel). DUCK_TARGET(isa) enables an instruction set
+//for a single function; MSVC allows intrinsics of any instruction set without it.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DUCK_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define DUCK_TARGET(isa)
+#else
+#define DUCK_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
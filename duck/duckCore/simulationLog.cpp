@@ -0,0 +1,195 @@
+#include "simulationLog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace simulation_log;
+
+namespace
+{
+	template<typename T>
+	void write(ofstream& file, const T& value)
+	{
+		static_assert(is_trivially_copyable_v<T>);
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	void writeArray(ofstream& file, const T* values, size_t count)
+	{
+		static_assert(is_trivially_copyable_v<T>);
+		file.write(reinterpret_cast<const char*>(values), static_cast<streamsize>(count * sizeof(T)));
+	}
+
+	template<typename T>
+	void readArray(ifstream& file, T* values, size_t count)
+	{
+		static_assert(is_trivially_copyable_v<T>);
+		if (!file.read(reinterpret_cast<char*>(values), static_cast<streamsize>(count * sizeof(T))))
+			throw runtime_error("Simulation log is truncated");
+	}
+
+	template<typename T>
+	T read(ifstream& file)
+	{
+		T value;
+		readArray(file, &value, 1);
+		return value;
+	}
+}
+
+Header simulation_log::Describe(const WaterSurface& surface)
+{
+	return { static_cast<uint32_t>(surface.Resolution()), surface.Size(), surface.WaveSpeed(), surface.TimeStep(),
+		surface.MaxDamping(), surface.DampingRange(), surface.ActivityThreshold(), surface.Obstacles() };
+}
+
+WaterSurface simulation_log::CreateSurface(const Header& header)
+{
+	WaterSurface surface(header.resolution, header.size, header.waveSpeed, header.timeStep);
+	surface.SetActivityThreshold(header.activityThreshold);
+	surface.SetDamping(header.maxDamping, header.dampingRange);
+	if (!header.obstacles.empty())
+		surface.SetObstacles(header.obstacles);
+	return surface;
+}
+
+uint64_t gk2::HeightChecksum(const WaterSurface& surface)
+{
+	uint64_t hash = 14695981039346656037ull;
+	const size_t n = surface.Resolution();
+	for (size_t y = 0; y < n; ++y)
+	{
+		auto bytes = reinterpret_cast<const unsigned char*>(surface.Heights() + y * surface.RowPitch());
+		for (size_t i = 0; i < n * sizeof(float); ++i)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+SimulationRecorder::SimulationRecorder(const filesystem::path& path, const WaterSurface& surface)
+	: m_file(path, ios::binary | ios::trunc), m_steps(0)
+{
+	if (!m_file)
+		throw runtime_error("Unable to create simulation log " + path.string());
+	const Header header = Describe(surface);
+	writeArray(m_file, Magic, size(Magic));
+	write(m_file, Version);
+	write(m_file, header.resolution);
+	write(m_file, header.size);
+	write(m_file, header.waveSpeed);
+	write(m_file, header.timeStep);
+	write(m_file, header.maxDamping);
+	write(m_file, header.dampingRange);
+	write(m_file, header.activityThreshold);
+	write(m_file, static_cast<uint64_t>(header.obstacles.size()));
+	writeArray(m_file, header.obstacles.data(), header.obstacles.size());
+}
+
+void SimulationRecorder::RecordDuck(float x, float y)
+{
+	write(m_file, EventTag::Duck);
+	write(m_file, x);
+	write(m_file, y);
+}
+
+void SimulationRecorder::RecordStep(float timeStep, const vector<Impulse>& impulses)
+{
+	write(m_file, EventTag::Step);
+	write(m_file, timeStep);
+	write(m_file, static_cast<uint32_t>(impulses.size()));
+	writeArray(m_file, impulses.data(), impulses.size());
+	++m_steps;
+}
+
+SimulationReplay::SimulationReplay(const filesystem::path& path)
+	: m_file(path, ios::binary)
+{
+	if (!m_file)
+		throw runtime_error("Unable to open simulation log " + path.string());
+	char magic[size(Magic)];
+	readArray(m_file, magic, size(magic));
+	if (memcmp(magic, Magic, sizeof(magic)) != 0)
+		throw runtime_error(path.string() + " is not a simulation log");
+	if (read<uint32_t>(m_file) != Version)
+		throw runtime_error("Unsupported simulation log version");
+	m_header.resolution = read<uint32_t>(m_file);
+	m_header.size = read<float>(m_file);
+	m_header.waveSpeed = read<float>(m_file);
+	m_header.timeStep = read<float>(m_file);
+	m_header.maxDamping = read<float>(m_file);
+	m_header.dampingRange = read<float>(m_file);
+	m_header.activityThreshold = read<float>(m_file);
+	const auto obstacles = read<uint64_t>(m_file);
+	if (obstacles != 0 && obstacles != static_cast<uint64_t>(m_header.resolution) * m_header.resolution)
+		throw runtime_error("Invalid obstacle mask in simulation log");
+	m_header.obstacles.resize(obstacles);
+	readArray(m_file, m_header.obstacles.data(), m_header.obstacles.size());
+	m_eventsStart = m_file.tellg();
+}
+
+SimulationReplay::Result SimulationReplay::Run(WaterSurface& surface, uint64_t checksumInterval,
+	const CheckpointCallback& onCheckpoint, const DuckCallback& onDuck)
+{
+	if (surface.Resolution() != m_header.resolution)
+		throw runtime_error("Surface resolution doesn't match the simulation log");
+	m_file.clear();
+	m_file.seekg(m_eventsStart);
+	using clock = chrono::steady_clock;
+	Result result{};
+	vector<Impulse> impulses;
+	double intervalSeconds = 0.0, intervalMax = 0.0;
+	uint64_t intervalSteps = 0;
+	EventTag tag;
+	while (m_file.read(reinterpret_cast<char*>(&tag), sizeof(tag)))
+	{
+		switch (tag)
+		{
+		case EventTag::Duck:
+		{
+			const auto x = read<float>(m_file);
+			const auto y = read<float>(m_file);
+			++result.duckEvents;
+			if (onDuck)
+				onDuck(x, y);
+			break;
+		}
+		case EventTag::Step:
+		{
+			if (read<float>(m_file) != surface.TimeStep())
+				throw runtime_error("Time step doesn't match the simulation log");
+			impulses.resize(read<uint32_t>(m_file));
+			readArray(m_file, impulses.data(), impulses.size());
+			const auto start = clock::now();
+			surface.ApplyImpulses(impulses);
+			surface.Step();
+			const double seconds = chrono::duration<double>(clock::now() - start).count();
+			++result.steps;
+			result.impulses += impulses.size();
+			result.totalStepSeconds += seconds;
+			result.maxStepSeconds = max(result.maxStepSeconds, seconds);
+			intervalSeconds += seconds;
+			intervalMax = max(intervalMax, seconds);
+			++intervalSteps;
+			if (checksumInterval != 0 && result.steps % checksumInterval == 0)
+			{
+				if (onCheckpoint)
+					onCheckpoint({ result.steps, HeightChecksum(surface), intervalMax,
+						intervalSeconds / static_cast<double>(intervalSteps) });
+				intervalSeconds = intervalMax = 0.0;
+				intervalSteps = 0;
+			}
+			break;
+		}
+		default:
+			throw runtime_error("Invalid event in simulation log");
+		}
+	}
+	result.finalChecksum = HeightChecksum(surface);
+	return result;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <cstdint>
+#include "waterSurface.h"
+
+namespace mini
+{
+	namespace gk2
+	{
+		//Binary log of the input of a water simulation: surface configuration followed by a sequence of events.
+		//Values are stored in the native (little-endian) byte order.
+		//	header: magic "DWLG", version, resolution, size, wave speed, time step, max damping, damping range,
+		//	        activity threshold, obstacle mask size followed by the mask
+		//	events: one byte tag followed by the data of the event
+		//	        Step - time step and the impulses applied at its start (count followed by the impulses)
+		//	        Duck - duck position in grid cells
+		namespace simulation_log
+		{
+			constexpr char Magic[4] = { 'D', 'W', 'L', 'G' };
+			constexpr uint32_t Version = 1;
+
+			enum class EventTag : uint8_t
+			{
+				Step = 1,
+				Duck = 2
+			};
+
+			struct Header
+			{
+				uint32_t resolution;
+				float size;
+				float waveSpeed;
+				float timeStep;
+				float maxDamping;
+				float dampingRange;
+				float activityThreshold;
+				std::vector<uint8_t> obstacles;
+			};
+
+			Header Describe(const WaterSurface& surface);
+			//creates a surface with the configuration stored in the header
+			WaterSurface CreateSurface(const Header& header);
+		}
+
+		//64-bit FNV-1a hash of the bit patterns of the current heights
+		uint64_t HeightChecksum(const WaterSurface& surface);
+
+		//Records the input of a live simulation. All calls have to come from the thread stepping the surface.
+		class SimulationRecorder
+		{
+		public:
+			//writes the header describing the current configuration of surface, throws std::runtime_error on failure
+			SimulationRecorder(const std::filesystem::path& path, const WaterSurface& surface);
+
+			void RecordDuck(float x, float y);
+			//records a step with the impulses the surface applied at its start (WaterSurface::StepImpulses)
+			void RecordStep(float timeStep, const std::vector<Impulse>& impulses);
+			void Flush() { m_file.flush(); }
+
+			uint64_t StepCount() const { return m_steps; }
+
+		private:
+			std::ofstream m_file;
+			uint64_t m_steps;
+		};
+
+		//Replays a recorded log on a headless surface as fast as possible.
+		class SimulationReplay
+		{
+		public:
+			struct Checkpoint
+			{
+				uint64_t step;
+				uint64_t checksum;
+				//time of the slowest and the average time of the steps since the previous checkpoint, in seconds
+				double maxStepSeconds;
+				double meanStepSeconds;
+			};
+
+			struct Result
+			{
+				uint64_t steps;
+				uint64_t impulses;
+				uint64_t duckEvents;
+				double totalStepSeconds;
+				double maxStepSeconds;
+				uint64_t finalChecksum;
+			};
+
+			using CheckpointCallback = std::function<void(const Checkpoint&)>;
+			using DuckCallback = std::function<void(float x, float y)>;
+
+			//reads the header, throws std::runtime_error if the file can't be read or isn't a valid log
+			explicit SimulationReplay(const std::filesystem::path& path);
+
+			const simulation_log::Header& Header() const { return m_header; }
+
+			//Replays all events on surface (e.g. from simulation_log::CreateSurface(Header())), calling onCheckpoint
+			//every checksumInterval steps (0 disables checkpoints). Only the steps themselves are timed.
+			Result Run(WaterSurface& surface, uint64_t checksumInterval, const CheckpointCallback& onCheckpoint = {},
+				const DuckCallback& onDuck = {});
+
+		private:
+			std::ifstream m_file;
+			simulation_log::Header m_header;
+			std::streampos m_eventsStart;
+		};
+	}
+}
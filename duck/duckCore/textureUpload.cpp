@@ -0,0 +1,96 @@
+#include "textureUpload.h"
+#include <cassert>
+#include <cstring>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+TextureStream::TextureStream(unique_ptr<ITextureUploadBackend> backend, size_t width, size_t height,
+	size_t texelSize, UploadMode mode, size_t ringSize)
+	: m_backend(move(backend)), m_width(width), m_height(height), m_texelSize(texelSize), m_mode(mode),
+	m_ringSize(mode == UploadMode::StagingRing ? ringSize : 0), m_nextSlot(0), m_stats{}
+{
+	assert(m_backend);
+	assert(mode != UploadMode::StagingRing || ringSize > 0);
+}
+
+void TextureStream::_copyRect(const TextureRect& rect, const unsigned char* src, size_t srcRowPitch,
+	const MappedTexture& dst)
+{
+	const size_t rowSize = rect.width * m_texelSize;
+	const unsigned char* s = src + rect.y * srcRowPitch + rect.x * m_texelSize;
+	unsigned char* d = dst.data + rect.y * dst.rowPitch + rect.x * m_texelSize;
+	for (size_t y = 0; y < rect.height; ++y, s += srcRowPitch, d += dst.rowPitch)
+		memcpy(d, s, rowSize);
+	m_stats.bytes += rowSize * rect.height;
+}
+
+void TextureStream::Upload(const void* src, size_t srcRowPitch, const vector<TextureRect>& rects)
+{
+	if (rects.empty())
+		return;
+	auto bytes = static_cast<const unsigned char*>(src);
+	++m_stats.uploads;
+	switch (m_mode)
+	{
+	case UploadMode::UpdateSubresource:
+		for (const auto& rect : rects)
+		{
+			assert(rect.x + rect.width <= m_width && rect.y + rect.height <= m_height);
+			m_backend->UpdateRegion(rect, bytes + rect.y * srcRowPitch + rect.x * m_texelSize, srcRowPitch);
+			m_stats.bytes += rect.width * rect.height * m_texelSize;
+		}
+		m_stats.regions += rects.size();
+		break;
+	case UploadMode::WriteDiscard:
+	{
+		const MappedTexture dst = m_backend->MapDiscard();
+		_copyRect({ 0, 0, m_width, m_height }, bytes, srcRowPitch, dst);
+		m_backend->UnmapDiscard();
+		++m_stats.maps;
+		++m_stats.regions;
+		break;
+	}
+	case UploadMode::StagingRing:
+	{
+		const size_t slot = m_nextSlot;
+		m_nextSlot = (m_nextSlot + 1) % m_ringSize;
+		const MappedTexture dst = m_backend->MapStaging(slot);
+		for (const auto& rect : rects)
+		{
+			assert(rect.x + rect.width <= m_width && rect.y + rect.height <= m_height);
+			_copyRect(rect, bytes, srcRowPitch, dst);
+		}
+		m_backend->UnmapStaging(slot);
+		for (const auto& rect : rects)
+			m_backend->CopyStaging(slot, rect);
+		++m_stats.maps;
+		m_stats.regions += rects.size();
+		m_stats.gpuCopies += rects.size();
+		break;
+	}
+	}
+}
+
+NullTextureUploadBackend::NullTextureUploadBackend(size_t width, size_t height, size_t texelSize, size_t ringSize)
+	: m_texelSize(texelSize), m_rowPitch(width * texelSize), m_texture(m_rowPitch * height),
+	m_staging(ringSize, vector<unsigned char>(m_rowPitch * height))
+{ }
+
+void NullTextureUploadBackend::_copyRows(const TextureRect& rect, const unsigned char* src, size_t srcRowPitch)
+{
+	unsigned char* dst = m_texture.data() + rect.y * m_rowPitch + rect.x * m_texelSize;
+	for (size_t y = 0; y < rect.height; ++y, src += srcRowPitch, dst += m_rowPitch)
+		memcpy(dst, src, rect.width * m_texelSize);
+}
+
+void NullTextureUploadBackend::UpdateRegion(const TextureRect& rect, const void* src, size_t srcRowPitch)
+{
+	_copyRows(rect, static_cast<const unsigned char*>(src), srcRowPitch);
+}
+
+void NullTextureUploadBackend::CopyStaging(size_t slot, const TextureRect& rect)
+{
+	_copyRows(rect, m_staging[slot].data() + rect.y * m_rowPitch + rect.x * m_texelSize, m_rowPitch);
+}
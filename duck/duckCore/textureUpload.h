@@ -0,0 +1,128 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace mini
+{
+	namespace gk2
+	{
+		//rectangle of texels
+		struct TextureRect
+		{
+			size_t x, y;
+			size_t width, height;
+		};
+
+		enum class UploadMode
+		{
+			//each changed rectangle is copied straight from CPU memory by the driver
+			UpdateSubresource,
+			//the whole texture is rewritten through Map with WRITE_DISCARD whenever anything changed,
+			//since discarding leaves the rest of the texture undefined
+			WriteDiscard,
+			//changed rectangles are written into the next staging buffer of a ring and copied into the texture
+			//on the GPU, so the CPU never waits for a buffer the GPU may still be reading from
+			StagingRing
+		};
+
+		struct MappedTexture
+		{
+			unsigned char* data;
+			//distance in bytes between the beginnings of consecutive rows
+			size_t rowPitch;
+		};
+
+		//Graphics API operations needed to stream data into a single texture.
+		class ITextureUploadBackend
+		{
+		public:
+			virtual ~ITextureUploadBackend() = default;
+
+			//copies rect from CPU memory, src points to the first texel of the rect
+			virtual void UpdateRegion(const TextureRect& rect, const void* src, size_t srcRowPitch) = 0;
+			//maps the texture itself for writing, its previous contents are lost
+			virtual MappedTexture MapDiscard() = 0;
+			virtual void UnmapDiscard() = 0;
+			//maps staging buffer slot for writing, its previous contents are kept
+			virtual MappedTexture MapStaging(size_t slot) = 0;
+			virtual void UnmapStaging(size_t slot) = 0;
+			//copies rect from staging buffer slot into the texture
+			virtual void CopyStaging(size_t slot, const TextureRect& rect) = 0;
+		};
+
+		struct UploadStats
+		{
+			uint64_t uploads;
+			//rectangles (or whole textures in WriteDiscard mode) written
+			uint64_t regions;
+			//bytes written by the CPU
+			uint64_t bytes;
+			uint64_t maps;
+			//copies performed on the GPU (staging buffer to texture)
+			uint64_t gpuCopies;
+		};
+
+		//Streams CPU-generated data into a texture, touching only the changed rectangles where the mode allows it.
+		//Rows are copied straight from the source into the destination, without intermediate buffers.
+		class TextureStream
+		{
+		public:
+			static constexpr size_t DefaultRingSize = 3;
+
+			//texelSize - size of a single texel in bytes
+			//ringSize - number of staging buffers, used only in StagingRing mode
+			TextureStream(std::unique_ptr<ITextureUploadBackend> backend, size_t width, size_t height, size_t texelSize,
+				UploadMode mode, size_t ringSize = DefaultRingSize);
+
+			//src points to the first texel of the source image, rows are srcRowPitch bytes apart.
+			//rects - rectangles changed since the previous upload, nothing is done if there are none
+			void Upload(const void* src, size_t srcRowPitch, const std::vector<TextureRect>& rects);
+
+			const ITextureUploadBackend& Backend() const { return *m_backend; }
+			UploadMode Mode() const { return m_mode; }
+			size_t RingSize() const { return m_ringSize; }
+			const UploadStats& Stats() const { return m_stats; }
+			void ResetStats() { m_stats = {}; }
+
+		private:
+			void _copyRect(const TextureRect& rect, const unsigned char* src, size_t srcRowPitch,
+				const MappedTexture& dst);
+
+			std::unique_ptr<ITextureUploadBackend> m_backend;
+			size_t m_width, m_height;
+			size_t m_texelSize;
+			UploadMode m_mode;
+			size_t m_ringSize;
+			size_t m_nextSlot;
+			UploadStats m_stats;
+		};
+
+		//Backend keeping the texture and staging buffers in system memory, for measuring the upload path
+		//without a graphics device.
+		class NullTextureUploadBackend : public ITextureUploadBackend
+		{
+		public:
+			NullTextureUploadBackend(size_t width, size_t height, size_t texelSize, size_t ringSize);
+
+			void UpdateRegion(const TextureRect& rect, const void* src, size_t srcRowPitch) override;
+			MappedTexture MapDiscard() override { return { m_texture.data(), m_rowPitch }; }
+			void UnmapDiscard() override { }
+			MappedTexture MapStaging(size_t slot) override { return { m_staging[slot].data(), m_rowPitch }; }
+			void UnmapStaging(size_t) override { }
+			void CopyStaging(size_t slot, const TextureRect& rect) override;
+
+			const unsigned char* Texture() const { return m_texture.data(); }
+			size_t RowPitch() const { return m_rowPitch; }
+
+		private:
+			void _copyRows(const TextureRect& rect, const unsigned char* src, size_t srcRowPitch);
+
+			size_t m_texelSize;
+			size_t m_rowPitch;
+			std::vector<unsigned char> m_texture;
+			std::vector<std::vector<unsigned char>> m_staging;
+		};
+	}
+}
@@ -0,0 +1,269 @@
+#include "waterKernels.h"
+#include "simdTarget.h"
+#include <cmath>
+
+//GCC would otherwise fuse the multiplies and adds into FMA instructions where the target allows it,
+//breaking bit-exactness with the scalar kernel
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+using namespace mini;
+using namespace gk2;
+
+namespace
+{
+	void rowScalar(const float* up, const float* center, const float* down, const float* damping, float* next,
+		size_t count, float a, float b)
+	{
+		const float* left = center - 1;
+		const float* right = center + 1;
+		for (size_t x = 0; x < count; ++x)
+			next[x] = damping[x] * (a * (up[x] + down[x] + left[x] + right[x]) + b * center[x] - next[x]);
+	}
+
+	//v is in [-1, 1], so the biased value is positive and truncation rounds it to the nearest integer
+	uint32_t packSnorm(float v)
+	{
+		return static_cast<uint32_t>(static_cast<int32_t>(v * 127.0f + 127.5f) - 127) & 0xFF;
+	}
+
+	void normalsScalar(const float* up, const float* center, const float* down, uint32_t* normals, size_t count,
+		float scale)
+	{
+		const float* left = center - 1;
+		const float* right = center + 1;
+		for (size_t x = 0; x < count; ++x)
+		{
+			const float dx = (right[x] - left[x]) * scale;
+			const float dy = (down[x] - up[x]) * scale;
+			const float invLength = 1.0f / std::sqrt(dx * dx + dy * dy + 1.0f);
+			normals[x] = packSnorm(-dx * invLength) | packSnorm(invLength) << 8 | packSnorm(-dy * invLength) << 16;
+		}
+	}
+
+#ifdef DUCK_SIMD_X86
+	DUCK_TARGET("sse4.1")
+	void rowSSE41(const float* up, const float* center, const float* down, const float* damping, float* next,
+		size_t count, float a, float b)
+	{
+		const __m128 va = _mm_set1_ps(a);
+		const __m128 vb = _mm_set1_ps(b);
+		size_t x = 0;
+		for (; x + 4 <= count; x += 4)
+		{
+			__m128 sum = _mm_add_ps(_mm_loadu_ps(up + x), _mm_loadu_ps(down + x));
+			sum = _mm_add_ps(sum, _mm_loadu_ps(center + x - 1));
+			sum = _mm_add_ps(sum, _mm_loadu_ps(center + x + 1));
+			__m128 z = _mm_add_ps(_mm_mul_ps(va, sum), _mm_mul_ps(vb, _mm_loadu_ps(center + x)));
+			z = _mm_sub_ps(z, _mm_loadu_ps(next + x));
+			_mm_storeu_ps(next + x, _mm_mul_ps(_mm_loadu_ps(damping + x), z));
+		}
+		rowScalar(up + x, center + x, down + x, damping + x, next + x, count - x, a, b);
+	}
+
+	DUCK_TARGET("avx2")
+	void rowAVX2(const float* up, const float* center, const float* down, const float* damping, float* next,
+		size_t count, float a, float b)
+	{
+		const __m256 va = _mm256_set1_ps(a);
+		const __m256 vb = _mm256_set1_ps(b);
+		size_t x = 0;
+		for (; x + 8 <= count; x += 8)
+		{
+			__m256 sum = _mm256_add_ps(_mm256_loadu_ps(up + x), _mm256_loadu_ps(down + x));
+			sum = _mm256_add_ps(sum, _mm256_loadu_ps(center + x - 1));
+			sum = _mm256_add_ps(sum, _mm256_loadu_ps(center + x + 1));
+			__m256 z = _mm256_add_ps(_mm256_mul_ps(va, sum), _mm256_mul_ps(vb, _mm256_loadu_ps(center + x)));
+			z = _mm256_sub_ps(z, _mm256_loadu_ps(next + x));
+			_mm256_storeu_ps(next + x, _mm256_mul_ps(_mm256_loadu_ps(damping + x), z));
+		}
+		rowSSE41(up + x, center + x, down + x, damping + x, next + x, count - x, a, b);
+	}
+
+	DUCK_TARGET("avx512f")
+	void rowAVX512(const float* up, const float* center, const float* down, const float* damping, float* next,
+		size_t count, float a, float b)
+	{
+		const __m512 va = _mm512_set1_ps(a);
+		const __m512 vb = _mm512_set1_ps(b);
+		size_t x = 0;
+		for (; x + 16 <= count; x += 16)
+		{
+			__m512 sum = _mm512_add_ps(_mm512_loadu_ps(up + x), _mm512_loadu_ps(down + x));
+			sum = _mm512_add_ps(sum, _mm512_loadu_ps(center + x - 1));
+			sum = _mm512_add_ps(sum, _mm512_loadu_ps(center + x + 1));
+			__m512 z = _mm512_add_ps(_mm512_mul_ps(va, sum), _mm512_mul_ps(vb, _mm512_loadu_ps(center + x)));
+			z = _mm512_sub_ps(z, _mm512_loadu_ps(next + x));
+			_mm512_storeu_ps(next + x, _mm512_mul_ps(_mm512_loadu_ps(damping + x), z));
+		}
+		rowAVX2(up + x, center + x, down + x, damping + x, next + x, count - x, a, b);
+	}
+
+	DUCK_TARGET("sse4.1")
+	__m128i packSnormSSE41(__m128 v)
+	{
+		const __m128i biased = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(127.0f)), _mm_set1_ps(127.5f)));
+		return _mm_and_si128(_mm_sub_epi32(biased, _mm_set1_epi32(127)), _mm_set1_epi32(0xFF));
+	}
+
+	DUCK_TARGET("sse4.1")
+	void normalsSSE41(const float* up, const float* center, const float* down, uint32_t* normals, size_t count,
+		float scale)
+	{
+		const __m128 vscale = _mm_set1_ps(scale);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		size_t x = 0;
+		for (; x + 4 <= count; x += 4)
+		{
+			const __m128 dx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(center + x + 1), _mm_loadu_ps(center + x - 1)), vscale);
+			const __m128 dy = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(down + x), _mm_loadu_ps(up + x)), vscale);
+			const __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), one);
+			const __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(length2));
+			__m128i n = packSnormSSE41(_mm_mul_ps(_mm_xor_ps(dx, sign), invLength));
+			n = _mm_or_si128(n, _mm_slli_epi32(packSnormSSE41(invLength), 8));
+			n = _mm_or_si128(n, _mm_slli_epi32(packSnormSSE41(_mm_mul_ps(_mm_xor_ps(dy, sign), invLength)), 16));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(normals + x), n);
+		}
+		normalsScalar(up + x, center + x, down + x, normals + x, count - x, scale);
+	}
+
+	DUCK_TARGET("avx2")
+	__m256i packSnormAVX2(__m256 v)
+	{
+		const __m256i biased = _mm256_cvttps_epi32(
+			_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(127.0f)), _mm256_set1_ps(127.5f)));
+		return _mm256_and_si256(_mm256_sub_epi32(biased, _mm256_set1_epi32(127)), _mm256_set1_epi32(0xFF));
+	}
+
+	DUCK_TARGET("avx2")
+	void normalsAVX2(const float* up, const float* center, const float* down, uint32_t* normals, size_t count,
+		float scale)
+	{
+		const __m256 vscale = _mm256_set1_ps(scale);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 sign = _mm256_set1_ps(-0.0f);
+		size_t x = 0;
+		for (; x + 8 <= count; x += 8)
+		{
+			const __m256 dx = _mm256_mul_ps(
+				_mm256_sub_ps(_mm256_loadu_ps(center + x + 1), _mm256_loadu_ps(center + x - 1)), vscale);
+			const __m256 dy = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(down + x), _mm256_loadu_ps(up + x)), vscale);
+			const __m256 length2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), one);
+			const __m256 invLength = _mm256_div_ps(one, _mm256_sqrt_ps(length2));
+			__m256i n = packSnormAVX2(_mm256_mul_ps(_mm256_xor_ps(dx, sign), invLength));
+			n = _mm256_or_si256(n, _mm256_slli_epi32(packSnormAVX2(invLength), 8));
+			n = _mm256_or_si256(n, _mm256_slli_epi32(packSnormAVX2(_mm256_mul_ps(_mm256_xor_ps(dy, sign), invLength)), 16));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(normals + x), n);
+		}
+		normalsSSE41(up + x, center + x, down + x, normals + x, count - x, scale);
+	}
+
+#ifdef _MSC_VER
+	//checks if the OS saves the given register state (XCR0 bits) on context switches
+	bool osSupportsAvx(unsigned long long mask)
+	{
+		int info[4];
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		return osxsave && (_xgetbv(0) & mask) == mask;
+	}
+#endif
+
+	SimdLevel detect()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		const int maxLeaf = info[0];
+		__cpuid(info, 1);
+		const bool sse41 = (info[2] & (1 << 19)) != 0;
+		bool avx2 = false, avx512 = false;
+		if (maxLeaf >= 7)
+		{
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0 && osSupportsAvx(0x6);
+			avx512 = (info[1] & (1 << 16)) != 0 && osSupportsAvx(0xE6);
+		}
+#else
+		//__builtin_cpu_supports also checks for OS support of the extended registers
+		__builtin_cpu_init();
+		const bool sse41 = __builtin_cpu_supports("sse4.1");
+		const bool avx2 = __builtin_cpu_supports("avx2");
+		const bool avx512 = __builtin_cpu_supports("avx512f");
+#endif
+		if (avx512)
+			return SimdLevel::AVX512;
+		if (avx2)
+			return SimdLevel::AVX2;
+		if (sse41)
+			return SimdLevel::SSE41;
+		return SimdLevel::Scalar;
+	}
+#endif
+}
+
+SimdLevel gk2::DetectSimdLevel()
+{
+#ifdef DUCK_SIMD_X86
+	static const SimdLevel level = detect();
+	return level;
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+WaterRowKernel gk2::GetWaterRowKernel(SimdLevel level)
+{
+	const SimdLevel supported = DetectSimdLevel();
+	if (level > supported)
+		level = supported;
+	switch (level)
+	{
+#ifdef DUCK_SIMD_X86
+	case SimdLevel::AVX512:
+		return rowAVX512;
+	case SimdLevel::AVX2:
+		return rowAVX2;
+	case SimdLevel::SSE41:
+		return rowSSE41;
+#endif
+	default:
+		return rowScalar;
+	}
+}
+
+WaterNormalKernel gk2::GetWaterNormalKernel(SimdLevel level)
+{
+	const SimdLevel supported = DetectSimdLevel();
+	if (level > supported)
+		level = supported;
+	switch (level)
+	{
+#ifdef DUCK_SIMD_X86
+	case SimdLevel::AVX512:
+	case SimdLevel::AVX2:
+		return normalsAVX2;
+	case SimdLevel::SSE41:
+		return normalsSSE41;
+#endif
+	default:
+		return normalsScalar;
+	}
+}
+
+const char* gk2::SimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::SSE41:
+		return "SSE4.1";
+	case SimdLevel::AVX2:
+		return "AVX2";
+	case SimdLevel::AVX512:
+		return "AVX-512";
+	default:
+		return "Scalar";
+	}
+}
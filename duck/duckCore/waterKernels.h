@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace mini
+{
+	namespace gk2
+	{
+		enum class SimdLevel
+		{
+			Scalar,
+			SSE41,
+			AVX2,
+			AVX512
+		};
+
+		//Computes one row segment of the wave equation step, fused with damping:
+		//next[x] = damping[x] * (a * (up[x] + down[x] + center[x-1] + center[x+1]) + b * center[x] - next[x])
+		//center[-1] and center[count] must be readable. next holds heights from the previous step on input.
+		//All kernels evaluate the expression in the same order without fused multiply-add, so their results
+		//are bit-exact with the scalar one.
+		using WaterRowKernel = void(*)(const float* up, const float* center, const float* down,
+			const float* damping, float* next, size_t count, float a, float b);
+
+		//Computes one row segment of surface normals from central differences of the heights:
+		//(-dx, 1, -dy) normalized, where dx = (center[x+1] - center[x-1]) * scale and dy = (down[x] - up[x]) * scale,
+		//packed as R8G8B8A8_SNORM with w = 0. center[-1] and center[count] must be readable.
+		//Like the row kernels, all versions are bit-exact with the scalar one.
+		using WaterNormalKernel = void(*)(const float* up, const float* center, const float* down,
+			uint32_t* normals, size_t count, float scale);
+
+		//highest instruction set supported by both the CPU and the build
+		SimdLevel DetectSimdLevel();
+		//returns the kernel for the given level, or for the highest supported level below it
+		WaterRowKernel GetWaterRowKernel(SimdLevel level);
+		//returns the normal kernel for the given level, or for the highest level below it it has a version for
+		WaterNormalKernel GetWaterNormalKernel(SimdLevel level);
+		const char* SimdLevelName(SimdLevel level);
+	}
+}
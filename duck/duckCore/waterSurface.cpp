@@ -0,0 +1,365 @@
+#include "waterSurface.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+
+WaterSurface::WaterSurface(size_t resolution, float size, float waveSpeed, float timeStep)
+	: m_resolution(resolution), m_layout(resolution), m_pitch(m_layout.pitch), m_size(size), m_waveSpeed(waveSpeed), m_stepCount(0),
+	m_damping(resolution), m_current(0),
+	m_activityThreshold(DefaultActivityThreshold), m_blocks((resolution + BlockSize - 1) / BlockSize),
+	m_steppedBlocks(0), m_impulseQueue(nullptr)
+{
+	assert(resolution > 1);
+	const float h = size / static_cast<float>(resolution - 1);
+	m_timeStep = timeStep > 0.0f ? timeStep : 1.0f / static_cast<float>(resolution);
+	m_A = waveSpeed * waveSpeed * m_timeStep * m_timeStep / (h * h);
+	//scheme is stable only when A <= 0.5
+	assert(m_A <= 0.5f);
+	m_B = 2.0f - 4.0f * m_A;
+	m_heights[0].assign(m_layout.BufferSize(), 0.0f);
+	m_heights[1].assign(m_layout.BufferSize(), 0.0f);
+	SetDamping(DefaultMaxDamping, DefaultDampingRange);
+	SetSimdLevel(DetectSimdLevel());
+	m_activeBlocks.assign(m_blocks * m_blocks, 0);
+	m_dirtyBlocks.assign(m_blocks * m_blocks, 1);
+	m_changedBlocks.assign(m_blocks * m_blocks, 1);
+	m_normalBlocks.assign(m_blocks * m_blocks, 0);
+	m_blockAmplitudes.assign(m_blocks * m_blocks, 0.0f);
+	m_runs.reserve(m_blocks * m_blocks);
+}
+
+void WaterSurface::SetHeight(size_t x, size_t y, float h)
+{
+	assert(x < m_resolution && y < m_resolution);
+	*_cell(m_heights[0], x, y) = h;
+	*_cell(m_heights[1], x, y) = h;
+	_wakeBlock(x, y);
+}
+
+void WaterSurface::ApplyImpulses(const vector<Impulse>& impulses)
+{
+	//sorting (block, index) pairs is much cheaper than sorting the impulses with a computed key
+	m_impulseOrder.clear();
+	const float last = static_cast<float>(m_resolution - 1);
+	for (size_t i = 0; i < impulses.size(); ++i)
+	{
+		//impulses come from any thread, ones which aren't finite are dropped rather than cast to indices
+		const Impulse& impulse = impulses[i];
+		if (!isfinite(impulse.x) || !isfinite(impulse.y) || !isfinite(impulse.radius) || !isfinite(impulse.amplitude))
+			continue;
+		const auto x = static_cast<size_t>(min(max(impulse.x, 0.0f), last));
+		const auto y = static_cast<size_t>(min(max(impulse.y, 0.0f), last));
+		const size_t block = (y / BlockSize) * m_blocks + x / BlockSize;
+		m_impulseOrder.push_back(static_cast<uint64_t>(block) << 32 | i);
+	}
+	sort(m_impulseOrder.begin(), m_impulseOrder.end());
+	for (uint64_t entry : m_impulseOrder)
+		_applyImpulse(impulses[entry & 0xFFFFFFFF]);
+}
+
+void WaterSurface::_applyImpulse(const Impulse& impulse)
+{
+	//bump of shape (1 - d^2/r^2)^2, at least one cell wide
+	const float radius = max(impulse.radius, 0.5f);
+	const float last = static_cast<float>(m_resolution - 1);
+	const float fx0 = max(ceil(impulse.x - radius), 0.0f), fx1 = min(floor(impulse.x + radius), last);
+	const float fy0 = max(ceil(impulse.y - radius), 0.0f), fy1 = min(floor(impulse.y + radius), last);
+	if (fx0 > fx1 || fy0 > fy1)
+		return;
+	const auto x0 = static_cast<size_t>(fx0), x1 = static_cast<size_t>(fx1);
+	const auto y0 = static_cast<size_t>(fy0), y1 = static_cast<size_t>(fy1);
+	const float invRadius2 = 1.0f / (radius * radius);
+	AlignedFloats& heights = m_heights[m_current];
+	for (size_t y = y0; y <= y1; ++y)
+	{
+		const float dy = static_cast<float>(y) - impulse.y;
+		float* row = _cell(heights, 0, y);
+		for (size_t x = x0; x <= x1; ++x)
+		{
+			const float dx = static_cast<float>(x) - impulse.x;
+			const float t = 1.0f - (dx * dx + dy * dy) * invRadius2;
+			if (t > 0.0f)
+				row[x] += impulse.amplitude * t * t;
+		}
+	}
+	for (size_t by = y0 / BlockSize; by <= y1 / BlockSize; ++by)
+		for (size_t bx = x0 / BlockSize; bx <= x1 / BlockSize; ++bx)
+			_wakeBlock(bx * BlockSize, by * BlockSize);
+}
+
+void WaterSurface::SetDamping(float maxDamping, float dampingRange)
+{
+	m_maxDamping = maxDamping;
+	m_dampingRange = dampingRange;
+	const float h = m_size / static_cast<float>(m_resolution - 1);
+	m_damping.Generate(maxDamping, dampingRange, h, m_obstacles.empty() ? nullptr : &m_obstacles);
+}
+
+void WaterSurface::SetObstacles(vector<uint8_t> obstacles)
+{
+	assert(obstacles.empty() || obstacles.size() == m_resolution * m_resolution);
+	m_obstacles = move(obstacles);
+	SetDamping(m_maxDamping, m_dampingRange);
+	//cells which became solid have to be flattened by the next step
+	fill(m_activeBlocks.begin(), m_activeBlocks.end(), uint8_t{ 1 });
+}
+
+void WaterSurface::SetSimdLevel(SimdLevel level)
+{
+	m_simdLevel = min(level, DetectSimdLevel());
+	m_kernel = GetWaterRowKernel(m_simdLevel);
+	m_normalKernel = GetWaterNormalKernel(m_simdLevel);
+}
+
+void WaterSurface::SetActivityThreshold(float threshold)
+{
+	m_activityThreshold = threshold;
+	//blocks put to sleep under the old threshold are flat, so they can stay asleep
+}
+
+void WaterSurface::TakeDirtyRects(vector<DirtyRect>& rects)
+{
+	//m_openRects holds indices of the rectangles reaching the bottom of the previous block row (sorted by x),
+	//followed by the ones reaching the bottom of the current row
+	m_openRects.clear();
+	for (size_t by = 0; by < m_blocks; ++by)
+	{
+		const size_t previous = m_openRects.size();
+		size_t candidate = 0;
+		const size_t y = by * BlockSize;
+		const size_t height = min(BlockSize, m_resolution - y);
+		for (size_t bx = 0; bx < m_blocks;)
+		{
+			if (!m_dirtyBlocks[by * m_blocks + bx])
+			{
+				++bx;
+				continue;
+			}
+			const size_t first = bx;
+			for (; bx < m_blocks && m_dirtyBlocks[by * m_blocks + bx]; ++bx)
+				m_dirtyBlocks[by * m_blocks + bx] = 0;
+			const size_t x = first * BlockSize;
+			const size_t width = min(bx * BlockSize, m_resolution) - x;
+			while (candidate < previous && rects[m_openRects[candidate]].x < x)
+				++candidate;
+			if (candidate < previous && rects[m_openRects[candidate]].x == x
+				&& rects[m_openRects[candidate]].width == width)
+			{
+				rects[m_openRects[candidate]].height += height;
+				m_openRects.push_back(m_openRects[candidate++]);
+			}
+			else
+			{
+				m_openRects.push_back(rects.size());
+				rects.push_back({ x, y, width, height });
+			}
+		}
+		m_openRects.erase(m_openRects.begin(), m_openRects.begin() + previous);
+	}
+}
+
+void WaterSurface::EnableNormals(bool enable)
+{
+	if (enable == NormalsEnabled())
+		return;
+	if (!enable)
+	{
+		m_normals = {};
+		fill(m_normalBlocks.begin(), m_normalBlocks.end(), uint8_t{ 0 });
+		return;
+	}
+	m_normals.resize(m_resolution * m_resolution);
+	fill(m_changedBlocks.begin(), m_changedBlocks.end(), uint8_t{ 1 });
+	UpdateNormals();
+}
+
+void WaterSurface::UpdateNormals()
+{
+	if (!NormalsEnabled())
+		return;
+	_collectNormalBlocks();
+	for (size_t by = 0; by < m_blocks; ++by)
+		for (size_t bx = 0; bx < m_blocks; ++bx)
+			if (m_normalBlocks[by * m_blocks + bx])
+				_computeBlockNormals(bx, by);
+}
+
+void WaterSurface::_collectNormalBlocks()
+{
+	//central differences at the edge of a block read heights of the neighbouring blocks
+	const uint8_t* changed = m_changedBlocks.data();
+	for (size_t by = 0; by < m_blocks; ++by)
+		for (size_t bx = 0; bx < m_blocks; ++bx)
+		{
+			const size_t b = by * m_blocks + bx;
+			m_normalBlocks[b] = changed[b] || (bx > 0 && changed[b - 1]) || (bx + 1 < m_blocks && changed[b + 1])
+				|| (by > 0 && changed[b - m_blocks]) || (by + 1 < m_blocks && changed[b + m_blocks]);
+		}
+	fill(m_changedBlocks.begin(), m_changedBlocks.end(), uint8_t{ 0 });
+}
+
+void WaterSurface::_computeNormals(size_t x0, size_t x1, size_t y)
+{
+	const float* c = _cell(m_heights[m_current], x0, y);
+	const float scale = static_cast<float>(m_resolution - 1) / (2.0f * m_size);
+	m_normalKernel(c - m_pitch, c, c + m_pitch, m_normals.data() + y * m_resolution + x0, x1 - x0, scale);
+}
+
+void WaterSurface::_computeBlockNormals(size_t bx, size_t by)
+{
+	const size_t x0 = bx * BlockSize, x1 = min(x0 + BlockSize, m_resolution);
+	const size_t y0 = by * BlockSize, y1 = min(y0 + BlockSize, m_resolution);
+	for (size_t y = y0; y < y1; ++y)
+		_computeNormals(x0, x1, y);
+}
+
+float WaterSurface::_blockAmplitude(size_t bx, size_t by) const
+{
+	const size_t x0 = bx * BlockSize, x1 = min(x0 + BlockSize, m_resolution);
+	const size_t y0 = by * BlockSize, y1 = min(y0 + BlockSize, m_resolution);
+	float amplitude = 0.0f;
+	for (size_t y = y0; y < y1; ++y)
+	{
+		const float* a = _cell(m_heights[0], x0, y);
+		const float* b = _cell(m_heights[1], x0, y);
+		for (size_t x = 0; x < x1 - x0; ++x)
+			amplitude = max(amplitude, max(fabs(a[x]), fabs(b[x])));
+	}
+	return amplitude;
+}
+
+void WaterSurface::_clearBlock(size_t bx, size_t by)
+{
+	const size_t x0 = bx * BlockSize, x1 = min(x0 + BlockSize, m_resolution);
+	const size_t y0 = by * BlockSize, y1 = min(y0 + BlockSize, m_resolution);
+	for (size_t y = y0; y < y1; ++y)
+	{
+		fill_n(_cell(m_heights[0], x0, y), x1 - x0, 0.0f);
+		fill_n(_cell(m_heights[1], x0, y), x1 - x0, 0.0f);
+	}
+}
+
+void WaterSurface::_collectRuns()
+{
+	m_runs.clear();
+	const bool all = m_activityThreshold < 0.0f;
+	const uint8_t* active = m_activeBlocks.data();
+	for (size_t by = 0; by < m_blocks; ++by)
+	{
+		for (size_t bx = 0; bx < m_blocks;)
+		{
+			const size_t b = by * m_blocks + bx;
+			//a sleeping block has to be stepped when waves can enter it from one of its neighbours
+			const bool step = all || active[b] || (bx > 0 && active[b - 1]) || (bx + 1 < m_blocks && active[b + 1])
+				|| (by > 0 && active[b - m_blocks]) || (by + 1 < m_blocks && active[b + m_blocks]);
+			if (!step)
+			{
+				++bx;
+				continue;
+			}
+			if (!m_runs.empty() && m_runs.back().y == by && m_runs.back().x1 == bx
+				&& bx - m_runs.back().x0 < MaxRunBlocks)
+				m_runs.back().x1 = ++bx;
+			else
+			{
+				m_runs.push_back({ by, bx, bx + 1 });
+				++bx;
+			}
+		}
+	}
+}
+
+void WaterSurface::_stepRun(const BlockRun& run)
+{
+	const size_t x0 = run.x0 * BlockSize, x1 = min(run.x1 * BlockSize, m_resolution);
+	const size_t y0 = run.y * BlockSize, y1 = min(y0 + BlockSize, m_resolution);
+	const uint8_t* normalBlocks = m_normalBlocks.data() + run.y * m_blocks;
+	const AlignedFloats& current = m_heights[m_current];
+	AlignedFloats& next = m_heights[m_current ^ 1];
+	for (size_t y = y0; y < y1; ++y)
+	{
+		const float* c = _cell(current, x0, y);
+		//next buffer holds heights from the previous step and gets overwritten in place
+		m_kernel(c - m_pitch, c, c + m_pitch, m_damping.Data(x0, y), _cell(next, x0, y),
+			x1 - x0, m_A, m_B);
+		//normals reuse the three rows the kernel has just read, while they are still in cache
+		for (size_t bx = run.x0; bx < run.x1; ++bx)
+			if (normalBlocks[bx])
+				_computeNormals(bx * BlockSize, min((bx + 1) * BlockSize, m_resolution), y);
+	}
+	for (size_t bx = run.x0; bx < run.x1; ++bx)
+		m_blockAmplitudes[run.y * m_blocks + bx] = _blockAmplitude(bx, run.y);
+}
+
+void WaterSurface::_step(utils::thread_pool* pool)
+{
+	m_impulseBatch.clear();
+	if (m_impulseQueue && m_impulseQueue->Drain(m_impulseBatch) != 0)
+		ApplyImpulses(m_impulseBatch);
+	_collectRuns();
+	const bool normals = NormalsEnabled();
+	if (normals)
+	{
+		_collectNormalBlocks();
+		//stepped blocks get marked as changed after the step anyway, marking them now tells which blocks
+		//the sweep will not reach (e.g. next to a block which has just fallen asleep)
+		for (const BlockRun& run : m_runs)
+			for (size_t bx = run.x0; bx < run.x1; ++bx)
+				m_changedBlocks[run.y * m_blocks + bx] = 1;
+		for (size_t b = 0; b < m_normalBlocks.size(); ++b)
+			if (m_normalBlocks[b] && !m_changedBlocks[b])
+			{
+				_computeBlockNormals(b % m_blocks, b / m_blocks);
+				m_dirtyBlocks[b] = 1;
+			}
+	}
+	auto stepRuns = [this](size_t first, size_t last) {
+		for (size_t i = first; i < last; ++i)
+			_stepRun(m_runs[i]);
+	};
+	if (pool)
+		pool->parallel_for(0, m_runs.size(), 1, stepRuns);
+	else
+		stepRuns(0, m_runs.size());
+	_swapBuffers();
+
+	//blocks are put to sleep only after the whole step, since their cells were read by the neighbours
+	m_steppedBlocks = 0;
+	for (const BlockRun& run : m_runs)
+	{
+		for (size_t bx = run.x0; bx < run.x1; ++bx)
+		{
+			const size_t b = run.y * m_blocks + bx;
+			m_dirtyBlocks[b] = 1;
+			m_changedBlocks[b] = 1;
+			m_activeBlocks[b] = m_blockAmplitudes[b] > m_activityThreshold;
+			if (!m_activeBlocks[b])
+				_clearBlock(bx, run.y);
+		}
+		m_steppedBlocks += run.x1 - run.x0;
+	}
+}
+
+void WaterSurface::Step()
+{
+	_step(nullptr);
+}
+
+void WaterSurface::Step(utils::thread_pool& pool)
+{
+	_step(&pool);
+}
+
+void WaterSurface::Reset()
+{
+	fill(m_heights[0].begin(), m_heights[0].end(), 0.0f);
+	fill(m_heights[1].begin(), m_heights[1].end(), 0.0f);
+	fill(m_activeBlocks.begin(), m_activeBlocks.end(), uint8_t{ 0 });
+	fill(m_dirtyBlocks.begin(), m_dirtyBlocks.end(), uint8_t{ 1 });
+	fill(m_changedBlocks.begin(), m_changedBlocks.end(), uint8_t{ 1 });
+	m_stepCount = 0;
+}
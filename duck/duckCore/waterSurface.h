@@ -0,0 +1,200 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "waterKernels.h"
+#include "textureUpload.h"
+#include "impulses.h"
+#include "dampingField.h"
+#include "thread_pool.h"
+
+namespace mini
+{
+	namespace gk2
+	{
+		//Heightfield water surface advanced with a discrete wave equation.
+		//Heights are kept in two buffers (current and previous step) with a one cell border of zeros
+		//around the simulated area, so the stencil never has to check grid bounds. Buffers use GridLayout,
+		//so simulated rows start at aligned addresses.
+		//Has no graphics API dependencies.
+		class WaterSurface
+		{
+		public:
+			static constexpr float DefaultSize = 2.0f;
+			static constexpr float DefaultWaveSpeed = 1.0f;
+			static constexpr float DefaultMaxDamping = 0.95f;
+			static constexpr float DefaultDampingRange = 0.2f;
+			//side of the square blocks used to track which parts of the surface are moving
+			static constexpr size_t BlockSize = 32;
+			//horizontal runs of active blocks are stepped together, up to this many blocks at once,
+			//which keeps the rows read by a run within L1 cache
+			static constexpr size_t MaxRunBlocks = 32;
+			static constexpr float DefaultActivityThreshold = 1e-5f;
+
+			//rectangle of cells (in grid coordinates) whose heights changed
+			using DirtyRect = TextureRect;
+
+			//resolution - number of simulated cells along each side of the grid
+			//size - length of the side of the simulated area
+			//timeStep - simulation time step, if 0, 1/resolution is used
+			explicit WaterSurface(size_t resolution, float size = DefaultSize, float waveSpeed = DefaultWaveSpeed,
+				float timeStep = 0.0f);
+
+			WaterSurface(WaterSurface&& other) = default;
+			WaterSurface(const WaterSurface& other) = default;
+			WaterSurface& operator=(WaterSurface&& other) = default;
+			WaterSurface& operator=(const WaterSurface& other) = default;
+
+			size_t Resolution() const { return m_resolution; }
+			//distance (in floats) between the beginnings of consecutive rows of the height buffer
+			size_t RowPitch() const { return m_pitch; }
+			float Size() const { return m_size; }
+			float WaveSpeed() const { return m_waveSpeed; }
+			float TimeStep() const { return m_timeStep; }
+			uint64_t StepCount() const { return m_stepCount; }
+
+			//pointer to the first simulated cell of the current height buffer. Rows are RowPitch() floats apart.
+			const float* Heights() const { return _cell(m_heights[m_current], 0, 0); }
+
+			float Height(size_t x, size_t y) const { return *_cell(m_heights[m_current], x, y); }
+			//sets height of the cell in both buffers, so the cell starts at rest
+			void SetHeight(size_t x, size_t y, float h);
+			//adds h to the current height of the cell
+			void Disturb(size_t x, size_t y, float h)
+			{
+				*_cell(m_heights[m_current], x, y) += h;
+				_wakeBlock(x, y);
+			}
+
+			//Normals are packed as R8G8B8A8_SNORM (x, up, y, 0) with x and y along the grid axes, resolution
+			//values per row. They are computed while stepping, from the heights the step reads, so after Step()
+			//they describe the heights from before that step. Only blocks around changed heights are recomputed.
+			void EnableNormals(bool enable);
+			bool NormalsEnabled() const { return !m_normals.empty(); }
+			const uint32_t* Normals() const { return m_normals.data(); }
+			//brings the normals up to date with the current heights without stepping
+			void UpdateNormals();
+
+			//Impulses pushed into queue are applied at the start of every step. queue must outlive the surface
+			//or be detached by passing nullptr.
+			void SetImpulseQueue(ImpulseQueue* queue) { m_impulseQueue = queue; }
+			//impulses taken from the queue and applied by the last step
+			const std::vector<Impulse>& StepImpulses() const { return m_impulseBatch; }
+			//Adds impulses to the current heights, sorted by block first so each block is visited once.
+			//Cost depends only on the number and size of the impulses, not on the grid size. Impulses with values
+			//which aren't finite are skipped.
+			void ApplyImpulses(const std::vector<Impulse>& impulses);
+
+			//regenerates per cell damping factors, which damp the waves more strongly near the walls
+			void SetDamping(float maxDamping, float dampingRange);
+			float Damping(size_t x, size_t y) const { return m_damping.At(x, y); }
+			float MaxDamping() const { return m_maxDamping; }
+			float DampingRange() const { return m_dampingRange; }
+			//Sets the mask of solid cells (resolution x resolution, non-zero for solid), which waves reflect off,
+			//and regenerates the damping. An empty mask removes all obstacles.
+			void SetObstacles(std::vector<uint8_t> obstacles);
+			const std::vector<uint8_t>& Obstacles() const { return m_obstacles; }
+
+			//selects the instruction set used by Step(). Defaults to the best one supported by the CPU.
+			void SetSimdLevel(SimdLevel level);
+			SimdLevel GetSimdLevel() const { return m_simdLevel; }
+
+			//Blocks whose heights in both buffers stay within threshold of zero are flattened and put to sleep.
+			//Sleeping blocks are skipped by Step() until a neighbouring block is active, since waves travel
+			//at most one cell per step. A negative threshold disables sleeping, so every block is stepped.
+			void SetActivityThreshold(float threshold);
+			float ActivityThreshold() const { return m_activityThreshold; }
+			size_t BlockCount() const { return m_blocks * m_blocks; }
+			//number of blocks stepped by the last call to Step()
+			size_t SteppedBlockCount() const { return m_steppedBlocks; }
+
+			//Appends rectangles covering every cell whose height or normal changed since the previous call
+			//(by steps, Disturb, SetHeight or Reset) to rects and clears the changed flags. Rectangles do not overlap.
+			void TakeDirtyRects(std::vector<DirtyRect>& rects);
+
+			void Step();
+			//Advances the simulation in parallel. Runs of active blocks are split between threads;
+			//they read their halo from the shared current buffer and write only their own cells,
+			//so the result does not depend on the number of threads.
+			void Step(utils::thread_pool& pool);
+			void Reset();
+
+		private:
+			//horizontal run of blocks [x0, x1) in block row y
+			struct BlockRun
+			{
+				size_t y, x0, x1;
+			};
+
+			void _step(utils::thread_pool* pool);
+			void _collectRuns();
+			void _stepRun(const BlockRun& run);
+			//marks blocks whose normals depend on heights changed since they were last computed
+			void _collectNormalBlocks();
+			void _computeNormals(size_t x0, size_t x1, size_t y);
+			void _computeBlockNormals(size_t bx, size_t by);
+			//largest absolute height of a block in either buffer
+			float _blockAmplitude(size_t bx, size_t by) const;
+			void _clearBlock(size_t bx, size_t by);
+			void _wakeBlock(size_t x, size_t y)
+			{
+				const size_t block = (y / BlockSize) * m_blocks + x / BlockSize;
+				m_activeBlocks[block] = 1;
+				m_dirtyBlocks[block] = 1;
+				m_changedBlocks[block] = 1;
+			}
+			void _applyImpulse(const Impulse& impulse);
+			void _swapBuffers()
+			{
+				m_current ^= 1;
+				++m_stepCount;
+			}
+
+			float* _cell(AlignedFloats& buffer, size_t x, size_t y)
+			{
+				return buffer.data() + m_layout.Index(x, y);
+			}
+			const float* _cell(const AlignedFloats& buffer, size_t x, size_t y) const
+			{
+				return buffer.data() + m_layout.Index(x, y);
+			}
+
+			size_t m_resolution;
+			GridLayout m_layout;
+			size_t m_pitch;
+			float m_size;
+			float m_waveSpeed;
+			float m_timeStep;
+			//wave equation coefficients: z' = d * (A * (sum of neighbours) + B * z - zPrev)
+			float m_A, m_B;
+			uint64_t m_stepCount;
+			AlignedFloats m_heights[2];
+			DampingField m_damping;
+			float m_maxDamping, m_dampingRange;
+			std::vector<uint8_t> m_obstacles;
+			unsigned m_current;
+			SimdLevel m_simdLevel;
+			WaterRowKernel m_kernel;
+			WaterNormalKernel m_normalKernel;
+
+			float m_activityThreshold;
+			//number of blocks along each side of the grid
+			size_t m_blocks;
+			size_t m_steppedBlocks;
+			//per block flags: block may hold non-zero heights / block changed since TakeDirtyRects
+			std::vector<uint8_t> m_activeBlocks;
+			std::vector<uint8_t> m_dirtyBlocks;
+			//per block flags: heights changed since normals were computed / normals need recomputing
+			std::vector<uint8_t> m_changedBlocks;
+			std::vector<uint8_t> m_normalBlocks;
+			std::vector<float> m_blockAmplitudes;
+			std::vector<BlockRun> m_runs;
+			std::vector<size_t> m_openRects;
+			std::vector<uint32_t> m_normals;
+			ImpulseQueue* m_impulseQueue;
+			std::vector<Impulse> m_impulseBatch;
+			//block index in the upper and impulse index in the lower half
+			std::vector<uint64_t> m_impulseOrder;
+		};
+	}
+}
@@ -0,0 +1,118 @@
+#include "tests.h"
+#include "frustumCulling.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace tests;
+
+namespace
+{
+	//the view volume of the identity matrix: -1 <= x <= 1, -1 <= y <= 1, 0 <= z <= 1
+	constexpr float Identity[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+
+	//perspective projection of a camera at the origin looking along z, fov 90 degrees, near 0.5, far 50
+	constexpr float Perspective[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 50.0f / 49.5f, 1 },
+		{ 0, 0, -0.5f * 50.0f / 49.5f, 0 } };
+
+	void add(CullingBatch& batch, float x, float y, float z, float radius, float extent)
+	{
+		batch.Add({ x, y, z, radius }, { x - extent, y - extent, z - extent, x + extent, y + extent, z + extent });
+	}
+
+	//true if the point is inside the view volume, away from its boundary by a small margin
+	bool inside(const float (&m)[4][4], float x, float y, float z)
+	{
+		float clip[4];
+		for (int j = 0; j < 4; ++j)
+			clip[j] = x * m[0][j] + y * m[1][j] + z * m[2][j] + m[3][j];
+		const float w = clip[3] * 0.999f;
+		return fabs(clip[0]) <= w && fabs(clip[1]) <= w && clip[2] >= 0.001f * clip[3] && clip[2] <= w;
+	}
+}
+
+void tests::CullingBatches()
+{
+	const CullingFrustum frustum = ExtractFrustum(Identity);
+	for (const CullingPlane& p : frustum.planes)
+		DUCK_CHECK(fabs(sqrt(p.nx * p.nx + p.ny * p.ny + p.nz * p.nz) - 1.0f) <= 1e-6f);
+
+	CullingBatch batch;
+	DUCK_CHECK(batch.GetSimdLevel() <= DetectSimdLevel());
+	add(batch, 0.0f, 0.0f, 0.5f, 0.5f, 0.25f);
+	//outside beyond the right, near and far planes
+	add(batch, 5.0f, 0.0f, 0.5f, 0.5f, 0.25f);
+	add(batch, 0.0f, 0.0f, -2.0f, 0.5f, 0.25f);
+	add(batch, 0.0f, -0.5f, 3.0f, 0.5f, 0.25f);
+	//straddling the top plane
+	add(batch, 0.0f, 1.2f, 0.5f, 0.5f, 0.3f);
+	//the sphere reaches into the volume, the box doesn't
+	batch.Add({ 1.3f, 0.0f, 0.5f, 0.5f }, { 1.1f, -0.2f, 0.3f, 1.5f, 0.2f, 0.7f });
+	//the box reaches into the volume, the sphere doesn't
+	batch.Add({ 2.0f, 0.0f, 0.5f, 0.2f }, { 0.5f, -0.2f, 0.3f, 2.2f, 0.2f, 0.7f });
+	DUCK_CHECK(batch.Size() == 7);
+
+	vector<uint32_t> visible;
+	batch.Cull(frustum, visible);
+	DUCK_CHECK((visible == vector<uint32_t>{ 0, 4 }));
+
+	batch.Clear();
+	DUCK_CHECK(batch.Size() == 0);
+	batch.Cull(frustum, visible);
+	DUCK_CHECK(visible.empty());
+	DUCK_CHECK(batch.Add({ 0.0f, 0.0f, 0.5f, 0.1f }, { -0.1f, -0.1f, 0.4f, 0.1f, 0.1f, 0.6f }) == 0);
+	batch.Cull(frustum, visible);
+	DUCK_CHECK((visible == vector<uint32_t>{ 0 }));
+}
+
+void tests::CullingBatchLevels()
+{
+	static constexpr SimdLevel Levels[] = { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512 };
+	const CullingFrustum frustum = ExtractFrustum(Perspective);
+	mt19937 random(5489u);
+	uniform_real_distribution<float> position(-30.0f, 30.0f), depth(-5.0f, 60.0f), size(0.1f, 3.0f);
+	//every count up to a few vectors, so that all tails of the vector code are covered, and a larger batch
+	vector<size_t> counts;
+	for (size_t count = 0; count <= 40; ++count)
+		counts.push_back(count);
+	counts.push_back(10000);
+	for (size_t count : counts)
+	{
+		CullingBatch batch;
+		vector<CullingSphere> spheres;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float x = position(random), y = position(random), z = depth(random), extent = size(random);
+			add(batch, x, y, z, extent * sqrt(3.0f), extent);
+			spheres.push_back({ x, y, z, extent });
+		}
+		vector<uint32_t> reference, visible;
+		for (SimdLevel level : Levels)
+		{
+			if (level > DetectSimdLevel())
+				continue;
+			batch.SetSimdLevel(level);
+			DUCK_CHECK(batch.GetSimdLevel() == level);
+			batch.Cull(frustum, visible);
+			if (level == SimdLevel::Scalar)
+				reference = visible;
+			//every level keeps exactly the objects the scalar code keeps
+			DUCK_CHECK(visible == reference);
+		}
+		//objects whose center is inside the view volume are never culled
+		bool conservative = true;
+		size_t next = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const bool kept = next < reference.size() && reference[next] == i;
+			next += kept;
+			conservative = conservative && (kept || !inside(Perspective, spheres[i].x, spheres[i].y, spheres[i].z));
+		}
+		//all indices were matched in a single pass, so they are increasing
+		DUCK_CHECK(next == reference.size());
+		DUCK_CHECK(conservative);
+	}
+}
@@ -0,0 +1,236 @@
+#include "tests.h"
+#include "frameGraph.h"
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace tests;
+
+namespace
+{
+	//values of DXGI_FORMAT
+	constexpr uint32_t FormatRGBA8 = 28;
+	constexpr uint32_t FormatRGBA16F = 10;
+
+	constexpr FrameTextureDesc Window{ 1280, 720, FormatRGBA8 };
+	constexpr FrameTextureDesc Target{ 640, 360, FormatRGBA16F };
+
+	//position of the step in the steps of the graph, FrameGraph::None if there is no such step
+	uint32_t stepOf(const FrameGraph& graph, FrameStepType type, uint32_t index)
+	{
+		const vector<FrameStep>& steps = graph.Steps();
+		for (size_t i = 0; i < steps.size(); ++i)
+			if (steps[i].type == type && steps[i].index == index)
+				return static_cast<uint32_t>(i);
+		return FrameGraph::None;
+	}
+
+	size_t stepCount(const FrameGraph& graph, FrameStepType type)
+	{
+		size_t count = 0;
+		for (const FrameStep& step : graph.Steps())
+			count += step.type == type;
+		return count;
+	}
+}
+
+void tests::FrameGraphCulling()
+{
+	FrameGraph graph;
+	const uint32_t window = graph.ImportTexture(Window);
+	const uint32_t unread = graph.AddTexture(Target);
+	const uint32_t lit = graph.AddTexture(Target);
+	const uint32_t debug = graph.AddTexture(Target);
+	//writes a texture read only by a culled pass
+	const uint32_t unreadWriter = graph.AddPass();
+	graph.Write(unreadWriter, unread, WriteMode::Overwrite);
+	const uint32_t lighting = graph.AddPass();
+	graph.Write(lighting, lit, WriteMode::Overwrite);
+	const uint32_t present = graph.AddPass();
+	graph.Read(present, lit);
+	graph.Write(present, window);
+	const uint32_t kept = graph.AddPass();
+	graph.Write(kept, debug);
+	graph.KeepPass(kept);
+	//writes nothing, so nothing needs it
+	const uint32_t reader = graph.AddPass();
+	graph.Read(reader, unread);
+	graph.Compile();
+
+	DUCK_CHECK(graph.Culled(unreadWriter));
+	DUCK_CHECK(graph.Culled(reader));
+	DUCK_CHECK(!graph.Culled(lighting));
+	DUCK_CHECK(!graph.Culled(present));
+	DUCK_CHECK(!graph.Culled(kept));
+	DUCK_CHECK((graph.Order() == vector<uint32_t>{ lighting, present, kept }));
+	DUCK_CHECK(stepCount(graph, FrameStepType::Pass) == 3);
+	DUCK_CHECK(graph.Physical(unread) == FrameGraph::None);
+	DUCK_CHECK(graph.Physical(window) == FrameGraph::None);
+	DUCK_CHECK(graph.Physical(lit) != FrameGraph::None);
+}
+
+void tests::FrameGraphOrder()
+{
+	FrameGraph graph;
+	const uint32_t window = graph.ImportTexture(Window);
+	const uint32_t lit = graph.AddTexture(Target);
+	const uint32_t decorated = graph.AddTexture(Target);
+	//readers are added before the passes they depend on
+	const uint32_t present = graph.AddPass();
+	graph.Read(present, decorated);
+	graph.Write(present, window);
+	const uint32_t overlay = graph.AddPass();
+	graph.Write(overlay, window);
+	const uint32_t lighting = graph.AddPass();
+	graph.Write(lighting, lit, WriteMode::Overwrite);
+	//writers of a texture run in the order they were added
+	const uint32_t base = graph.AddPass();
+	graph.Read(base, lit);
+	graph.Write(base, decorated, WriteMode::Overwrite);
+	const uint32_t decals = graph.AddPass();
+	graph.Write(decals, decorated);
+	graph.Compile();
+
+	DUCK_CHECK((graph.Order() == vector<uint32_t>{ lighting, base, decals, present, overlay }));
+	uint32_t previous = 0;
+	for (uint32_t pass : graph.Order())
+	{
+		const uint32_t step = stepOf(graph, FrameStepType::Pass, pass);
+		DUCK_CHECK(step != FrameGraph::None);
+		DUCK_CHECK(pass == graph.Order().front() || step > previous);
+		previous = step;
+	}
+}
+
+void tests::FrameGraphClearsAndCopies()
+{
+	FrameGraph graph;
+	const uint32_t window = graph.ImportTexture(Window);
+	const uint32_t albedo = graph.AddTexture(Target);
+	const uint32_t normal = graph.AddTexture(Target);
+	const uint32_t depth = graph.AddTexture(Target);
+	const uint32_t gbuffer = graph.AddPass();
+	graph.Write(gbuffer, albedo);
+	graph.Write(gbuffer, normal, WriteMode::Overwrite);
+	graph.Write(gbuffer, depth, WriteMode::Clear);
+	const uint32_t decals = graph.AddPass();
+	graph.Read(decals, albedo);
+	graph.Read(decals, depth);
+	graph.Write(decals, albedo);
+	const uint32_t lighting = graph.AddPass();
+	graph.Read(lighting, albedo);
+	graph.Read(lighting, normal);
+	graph.Write(lighting, window, WriteMode::Clear);
+	const uint32_t ui = graph.AddPass();
+	graph.Write(ui, window);
+	graph.Compile();
+
+	//transient textures loaded by their first pass and written with WriteMode::Clear are cleared before it,
+	//overwritten ones are not, imported textures only for WriteMode::Clear
+	DUCK_CHECK(stepOf(graph, FrameStepType::Clear, albedo) < stepOf(graph, FrameStepType::Pass, gbuffer));
+	DUCK_CHECK(stepOf(graph, FrameStepType::Clear, depth) < stepOf(graph, FrameStepType::Pass, gbuffer));
+	DUCK_CHECK(stepOf(graph, FrameStepType::Clear, normal) == FrameGraph::None);
+	const uint32_t windowClear = stepOf(graph, FrameStepType::Clear, window);
+	DUCK_CHECK(windowClear > stepOf(graph, FrameStepType::Pass, decals));
+	DUCK_CHECK(windowClear < stepOf(graph, FrameStepType::Pass, lighting));
+	DUCK_CHECK(stepOf(graph, FrameStepType::Pass, ui) > stepOf(graph, FrameStepType::Pass, lighting));
+	DUCK_CHECK(stepCount(graph, FrameStepType::Clear) == 3);
+
+	//decals read a copy of the albedo they write
+	const uint32_t copy = graph.ReadTexture(decals, albedo);
+	DUCK_CHECK(copy != albedo);
+	DUCK_CHECK(copy >= 4 && copy < graph.TextureCount());
+	DUCK_CHECK(graph.Desc(copy) == graph.Desc(albedo));
+	DUCK_CHECK(!graph.Imported(copy));
+	DUCK_CHECK(graph.ReadTexture(decals, depth) == depth);
+	DUCK_CHECK(graph.ReadTexture(lighting, albedo) == albedo);
+	DUCK_CHECK(stepCount(graph, FrameStepType::Copy) == 1);
+	const uint32_t copyStep = stepOf(graph, FrameStepType::Copy, copy);
+	DUCK_CHECK(copyStep != FrameGraph::None);
+	DUCK_CHECK(copyStep > stepOf(graph, FrameStepType::Pass, gbuffer));
+	DUCK_CHECK(copyStep < stepOf(graph, FrameStepType::Pass, decals));
+	DUCK_CHECK(copyStep == FrameGraph::None || graph.Steps()[copyStep].source == albedo);
+
+	//compiling again replaces the results, copies aren't added twice
+	const size_t textures = graph.TextureCount(), steps = graph.Steps().size();
+	graph.Compile();
+	DUCK_CHECK(graph.TextureCount() == textures);
+	DUCK_CHECK(graph.Steps().size() == steps);
+}
+
+void tests::FrameGraphAliasing()
+{
+	FrameGraph graph;
+	const uint32_t window = graph.ImportTexture(Window);
+	const uint32_t first = graph.AddTexture(Target);
+	const uint32_t second = graph.AddTexture(Target);
+	const uint32_t third = graph.AddTexture(Target);
+	const FrameTextureDesc half{ 320, 180, FormatRGBA16F };
+	const uint32_t small = graph.AddTexture(half);
+	//a chain of passes, each reading the output of the one before
+	const uint32_t a = graph.AddPass();
+	graph.Write(a, first, WriteMode::Overwrite);
+	const uint32_t b = graph.AddPass();
+	graph.Read(b, first);
+	graph.Write(b, second, WriteMode::Overwrite);
+	const uint32_t c = graph.AddPass();
+	graph.Read(c, second);
+	graph.Write(c, third, WriteMode::Overwrite);
+	graph.Write(c, small, WriteMode::Overwrite);
+	const uint32_t present = graph.AddPass();
+	graph.Read(present, third);
+	graph.Read(present, small);
+	graph.Write(present, window, WriteMode::Overwrite);
+	graph.Compile();
+
+	//the first texture is dead when the third one is written, the second one overlaps both
+	DUCK_CHECK(graph.Physical(first) == graph.Physical(third));
+	DUCK_CHECK(graph.Physical(second) != graph.Physical(first));
+	//textures of different descriptions never share memory
+	DUCK_CHECK(graph.Physical(small) != graph.Physical(first));
+	DUCK_CHECK(graph.Physical(small) != graph.Physical(second));
+	DUCK_CHECK(graph.Physical(window) == FrameGraph::None);
+	const vector<FrameTextureDesc>& physical = graph.PhysicalTextures();
+	DUCK_CHECK(physical.size() == 3);
+	for (uint32_t texture : { first, second, third, small })
+		DUCK_CHECK(graph.Physical(texture) < physical.size() && physical[graph.Physical(texture)] == graph.Desc(texture));
+	DUCK_CHECK(stepCount(graph, FrameStepType::Clear) == 0);
+}
+
+void tests::FrameGraphCycles()
+{
+	FrameGraph graph;
+	const uint32_t window = graph.ImportTexture(Window);
+	const uint32_t a = graph.AddTexture(Target);
+	const uint32_t b = graph.AddTexture(Target);
+	//a pass reading the output of a pass reading its own
+	const uint32_t first = graph.AddPass();
+	graph.Read(first, b);
+	graph.Write(first, a);
+	const uint32_t second = graph.AddPass();
+	graph.Read(second, a);
+	graph.Write(second, b);
+	graph.Write(second, window);
+	bool thrown = false;
+	try
+	{
+		graph.Compile();
+	}
+	catch (const logic_error&)
+	{
+		thrown = true;
+	}
+	DUCK_CHECK(thrown);
+
+	//the graph can be filled again after a rejected compilation
+	graph.Clear();
+	DUCK_CHECK(graph.PassCount() == 0);
+	DUCK_CHECK(graph.TextureCount() == 0);
+	const uint32_t target = graph.ImportTexture(Window);
+	const uint32_t pass = graph.AddPass();
+	graph.Write(pass, target);
+	graph.Compile();
+	DUCK_CHECK((graph.Order() == vector<uint32_t>{ pass }));
+}
@@ -0,0 +1,67 @@
+#include "tests.h"
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace tests;
+
+static constexpr Test Tests[] = {
+	{ "frameGraphCulling", FrameGraphCulling },
+	{ "frameGraphOrder", FrameGraphOrder },
+	{ "frameGraphClearsAndCopies", FrameGraphClearsAndCopies },
+	{ "frameGraphAliasing", FrameGraphAliasing },
+	{ "frameGraphCycles", FrameGraphCycles },
+	{ "pathSegments", PathSegments },
+	{ "bsplinePaths", BSplinePaths },
+	{ "cullingBatches", CullingBatches },
+	{ "cullingBatchLevels", CullingBatchLevels },
+};
+
+static int failedChecks = 0;
+
+void tests::Fail(const char* file, int line, const char* expression)
+{
+	fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+	++failedChecks;
+}
+
+//Runs tests whose names were passed as arguments, or all of them if there are no arguments.
+//Exits with 1 if any of them failed.
+int main(int argc, char* argv[])
+{
+	int failedTests = 0, run = 0;
+	for (const Test& t : Tests)
+	{
+		bool selected = argc == 1;
+		for (int i = 1; i < argc && !selected; ++i)
+			selected = strcmp(argv[i], t.name) == 0;
+		if (!selected)
+			continue;
+		const int before = failedChecks;
+		try
+		{
+			t.run();
+		}
+		catch (const exception& e)
+		{
+			fprintf(stderr, "%s: unexpected exception: %s\n", t.name, e.what());
+			++failedChecks;
+		}
+		const bool passed = failedChecks == before;
+		printf("%-28s %s\n", t.name, passed ? "passed" : "FAILED");
+		failedTests += !passed;
+		++run;
+	}
+	if (run == 0)
+	{
+		printf("Usage: DuckTests [test...]\nAvailable tests:\n");
+		for (const Test& t : Tests)
+			printf("  %s\n", t.name);
+		return 1;
+	}
+	printf("%d of %d tests passed\n", run - failedTests, run);
+	return failedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+#include "tests.h"
+#include "bsplinePath.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace mini;
+using namespace gk2;
+using namespace tests;
+
+namespace
+{
+	bool approx(float a, float b, float tolerance) { return fabs(a - b) <= tolerance; }
+
+	//point of the segment from the B-spline basis functions, independent of the polynomial form
+	PathPoint basisPoint(const PathPoint (&p)[4], float t)
+	{
+		const float s = 1.0f - t;
+		const float w[4] = { s * s * s / 6.0f, (3.0f * t * t * t - 6.0f * t * t + 4.0f) / 6.0f,
+			(-3.0f * t * t * t + 3.0f * t * t + 3.0f * t + 1.0f) / 6.0f, t * t * t / 6.0f };
+		return { w[0] * p[0].x + w[1] * p[1].x + w[2] * p[2].x + w[3] * p[3].x,
+			w[0] * p[0].y + w[1] * p[1].y + w[2] * p[2].y + w[3] * p[3].y };
+	}
+
+	//arc length of the segment from 0 to t, summed over a fine polyline
+	double arcLength(const PathSegment& segment, float t)
+	{
+		static constexpr int Pieces = 4096;
+		double length = 0.0;
+		PathPoint prev = segment.Position(0.0f);
+		for (int i = 1; i <= Pieces; ++i)
+		{
+			const PathPoint p = segment.Position(t * static_cast<float>(i) / Pieces);
+			length += hypot(static_cast<double>(p.x - prev.x), static_cast<double>(p.y - prev.y));
+			prev = p;
+		}
+		return length;
+	}
+}
+
+void tests::PathSegments()
+{
+	//evenly spaced control points on a line give a segment of uniform speed from the second to the third
+	const PathPoint line[4] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 2.0f, 0.0f }, { 3.0f, 0.0f } };
+	const PathSegment straight(line);
+	DUCK_CHECK(approx(straight.Position(0.0f).x, 1.0f, 1e-6f));
+	DUCK_CHECK(approx(straight.Position(1.0f).x, 2.0f, 1e-6f));
+	DUCK_CHECK(approx(straight.Length(), 1.0f, 1e-5f));
+	size_t hint = 0;
+	DUCK_CHECK(approx(straight.Parameter(0.25f, hint), 0.25f, 1e-5f));
+	DUCK_CHECK(approx(straight.Parameter(0.75f, hint), 0.75f, 1e-5f));
+	//distances are clamped to the segment
+	DUCK_CHECK(straight.Parameter(-1.0f, hint) == 0.0f);
+	DUCK_CHECK(approx(straight.Parameter(2.0f, hint), 1.0f, 1e-6f));
+	DUCK_CHECK(approx(straight.Derivative(0.5f).x, 1.0f, 1e-5f) && approx(straight.Derivative(0.5f).y, 0.0f, 1e-6f));
+
+	const PathPoint control[4] = { { 0.0f, 0.0f }, { 1.0f, 2.0f }, { 3.0f, -1.0f }, { 4.0f, 1.0f } };
+	const PathSegment curve(control);
+	for (float t = 0.0f; t <= 1.0f; t += 0.125f)
+	{
+		const PathPoint p = curve.Position(t), expected = basisPoint(control, t);
+		DUCK_CHECK(approx(p.x, expected.x, 1e-5f) && approx(p.y, expected.y, 1e-5f));
+		//derivative against a central difference
+		const float h = 1e-3f;
+		const PathPoint d = curve.Derivative(t), a = basisPoint(control, t - h), b = basisPoint(control, t + h);
+		DUCK_CHECK(approx(d.x, (b.x - a.x) / (2.0f * h), 1e-2f) && approx(d.y, (b.y - a.y) / (2.0f * h), 1e-2f));
+	}
+	DUCK_CHECK(curve.Lengths()[0] == 0.0f);
+	for (size_t i = 0; i < PathSegment::Samples; ++i)
+		DUCK_CHECK(curve.Lengths()[i + 1] > curve.Lengths()[i]);
+	const double length = arcLength(curve, 1.0f);
+	DUCK_CHECK(fabs(curve.Length() - length) <= 1e-3 * length);
+
+	//the parameter of a distance is found at that distance along the curve, and grows with it
+	hint = 0;
+	float previous = 0.0f;
+	for (int i = 0; i <= 64; ++i)
+	{
+		const float s = curve.Length() * static_cast<float>(i) / 64.0f;
+		const float t = curve.Parameter(s, hint);
+		DUCK_CHECK(t >= previous);
+		DUCK_CHECK(fabs(arcLength(curve, t) - s) <= 2e-3 * length);
+		previous = t;
+	}
+	DUCK_CHECK(approx(previous, 1.0f, 1e-5f));
+}
+
+void tests::BSplinePaths()
+{
+	static constexpr PathPoint Min{ -1.0f, -0.5f }, Max{ 1.0f, 0.5f };
+	static constexpr float Step = 0.01f;
+	static constexpr int Steps = 20000;
+	BSplinePath path(Min, Max), same(Min, Max), other(Min, Max, 1234u);
+	PathPoint prev = path.Position();
+	uint64_t segment = path.SegmentIndex();
+	bool inside = true, unit = true, monotonic = true, deterministic = true, differs = false;
+	int forward = 0, constant = 0;
+	float maxChord = 0.0f;
+	for (int i = 0; i < Steps; ++i)
+	{
+		const PathPoint direction = path.Direction();
+		unit = unit && approx(hypot(direction.x, direction.y), 1.0f, 1e-4f);
+		path.Advance(Step);
+		same.Advance(Step);
+		other.Advance(Step);
+		const PathPoint p = path.Position();
+		inside = inside && p.x >= Min.x && p.x <= Max.x && p.y >= Min.y && p.y <= Max.y;
+		const float dx = p.x - prev.x, dy = p.y - prev.y, chord = hypot(dx, dy);
+		forward += dx * direction.x + dy * direction.y > 0.0f;
+		constant += fabs(chord - Step) <= 0.01f * Step;
+		maxChord = max(maxChord, chord);
+		monotonic = monotonic && path.SegmentIndex() >= segment;
+		segment = path.SegmentIndex();
+		deterministic = deterministic && same.Position().x == p.x && same.Position().y == p.y;
+		differs = differs || other.Position().x != p.x || other.Position().y != p.y;
+		prev = p;
+	}
+	DUCK_CHECK(inside);
+	DUCK_CHECK(unit);
+	//the duck swims along its direction at a constant speed, except for turning around at cusps of the path,
+	//where the distance is mapped to the parameter least precisely and chords are much shorter than arcs
+	DUCK_CHECK(forward >= Steps * 99 / 100);
+	DUCK_CHECK(constant >= Steps * 98 / 100);
+	DUCK_CHECK(maxChord <= 1.02f * Step);
+	DUCK_CHECK(monotonic);
+	DUCK_CHECK(path.SegmentIndex() > 0);
+	DUCK_CHECK(deterministic);
+	DUCK_CHECK(differs);
+}
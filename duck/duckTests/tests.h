@@ -0,0 +1,32 @@
+#pragma once
+
+namespace mini
+{
+	namespace gk2
+	{
+		namespace tests
+		{
+			struct Test
+			{
+				const char* name;
+				void (*run)();
+			};
+
+			//records a failed check, the test goes on with the next one
+			void Fail(const char* file, int line, const char* expression);
+
+			void FrameGraphCulling();
+			void FrameGraphOrder();
+			void FrameGraphClearsAndCopies();
+			void FrameGraphAliasing();
+			void FrameGraphCycles();
+			void PathSegments();
+			void BSplinePaths();
+			void CullingBatches();
+			void CullingBatchLevels();
+		}
+	}
+}
+
+#define DUCK_CHECK(expression) \
+	((expression) ? static_cast<void>(0) : ::mini::gk2::tests::Fail(__FILE__, __LINE__, #expression))
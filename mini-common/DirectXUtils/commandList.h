@@ -0,0 +1,402 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+namespace mini
+{
+	enum class ShaderStage : uint8_t { VS, HS, DS, GS, PS, Count };
+
+	//Commands of a command list. Fields of Command used by each type are listed next to it,
+	//arrays and data of a command are kept in the payload of the list.
+	enum class CommandType : uint8_t
+	{
+		//stage, object - shader
+		SetShader,
+		//stage, start, count, payload - count objects
+		SetConstantBuffers,
+		SetShaderResources,
+		SetSamplers,
+		//object - input layout
+		SetInputLayout,
+		//args[0] - primitive topology
+		SetPrimitiveTopology,
+		//object - buffer, args[0] - index format, args[1] - offset
+		SetIndexBuffer,
+		//start, count, payload - count buffers, followed by count strides and count offsets
+		SetVertexBuffers,
+		//object - rasterizer state
+		SetRasterizerState,
+		//object - blend state, args[0] - sample mask, args[1] - 1 if the payload holds 4 floats of the blend factor
+		SetBlendState,
+		//object - depth stencil state, args[0] - stencil reference
+		SetDepthStencilState,
+		//count, payload - count CommandViewports
+		SetViewports,
+		//count, payload - count CommandRects
+		SetScissorRects,
+		//count, payload - count render target views, object - depth stencil view
+		SetRenderTargets,
+		//object - render target view, payload - 4 floats of the color
+		ClearRenderTarget,
+		//object - depth stencil view, args[0] - clear flags, args[1] - bits of the depth, args[2] - stencil
+		ClearDepthStencil,
+		//object - buffer, count - size in bytes, payload - new contents of the beginning of the buffer,
+		//the rest of the buffer becomes undefined (like when mapped with WRITE_DISCARD)
+		UpdateBuffer,
+		//object - destination, payload - source
+		CopyResource,
+		//count - vertices, args[0] - start vertex
+		Draw,
+		//count - indices, args[0] - start index, args[1] - base vertex
+		DrawIndexed,
+		//count - indices, args[0] - start index, args[1] - base vertex, args[2] - instances, args[3] - start instance
+		DrawIndexedInstanced,
+		//unbinds everything
+		ClearState,
+		//object - user pointer, payload - NativeCallback, args[0] - 1 if the callback may change bound state
+		Native,
+		Count
+	};
+
+	//Limits of slots, the same as the ones of Direct3D 11
+	namespace commandLimits
+	{
+		constexpr uint32_t ConstantBufferSlots = 14;
+		constexpr uint32_t ShaderResourceSlots = 128;
+		constexpr uint32_t SamplerSlots = 16;
+		constexpr uint32_t VertexBufferSlots = 32;
+		constexpr uint32_t RenderTargetSlots = 8;
+		constexpr uint32_t ViewportSlots = 16;
+	}
+
+	//laid out like D3D11_VIEWPORT
+	struct CommandViewport
+	{
+		float x, y;
+		float width, height;
+		float minDepth, maxDepth;
+	};
+
+	//laid out like D3D11_RECT
+	struct CommandRect
+	{
+		int32_t left, top, right, bottom;
+	};
+
+	//Buffers of an indexed mesh drawn from offset 0, bound together by CommandList::SetMesh.
+	//T is the type of the vertex buffers, e.g. ID3D11Buffer.
+	template<typename T>
+	struct CommandMesh
+	{
+		uint32_t topology;
+		void* indexBuffer;
+		uint32_t indexFormat;
+		uint32_t indexCount;
+		uint32_t vertexBufferCount;
+		T* const* vertexBuffers;
+		const uint32_t* strides;
+		const uint32_t* offsets;
+	};
+
+	//Called by executors with the native context of the graphics API, for the Direct3D 11 executor
+	//a pointer to the const dx_ptr<ID3D11DeviceContext>. Null executors don't call them.
+	using NativeCallback = void (*)(const void* user, void* context);
+
+	struct Command
+	{
+		CommandType type;
+		ShaderStage stage;
+		uint32_t start;
+		uint32_t count;
+		//offset of the data of the command in the payload of the list
+		uint32_t payload;
+		void* object;
+		uint32_t args[4];
+	};
+
+	//Commands of a frame (or its part) recorded without any graphics API, replayed later by an executor.
+	//Objects of the API are opaque pointers, which have to stay alive until the list is executed.
+	//Recording only appends to two vectors, whose memory is kept by Clear, so a list reused every frame doesn't allocate.
+	class CommandList
+	{
+	public:
+		//removes all commands, keeping the memory
+		void Clear()
+		{
+			m_commands.clear();
+			m_payload.clear();
+		}
+
+		bool Empty() const { return m_commands.empty(); }
+		size_t Size() const { return m_commands.size(); }
+		const std::vector<Command>& Commands() const { return m_commands; }
+		size_t PayloadSize() const { return m_payload.size(); }
+
+		template<typename T>
+		const T* Payload(const Command& command) const
+		{
+			return reinterpret_cast<const T*>(m_payload.data() + command.payload);
+		}
+
+		struct VertexBufferArrays
+		{
+			void* const* buffers;
+			const uint32_t* strides;
+			const uint32_t* offsets;
+		};
+
+		//arrays of a SetVertexBuffers command
+		VertexBufferArrays VertexBuffers(const Command& command) const
+		{
+			assert(command.type == CommandType::SetVertexBuffers);
+			const unsigned char* data = Payload<unsigned char>(command);
+			const size_t stridesOffset = _padded(command.count * sizeof(void*));
+			return { reinterpret_cast<void* const*>(data), reinterpret_cast<const uint32_t*>(data + stridesOffset),
+				reinterpret_cast<const uint32_t*>(data + stridesOffset + _padded(command.count * sizeof(uint32_t))) };
+		}
+
+		void SetShader(ShaderStage stage, void* shader)
+		{
+			_push(CommandType::SetShader, stage).object = shader;
+		}
+
+		template<typename T>
+		void SetConstantBuffers(ShaderStage stage, uint32_t start, uint32_t count, T* const* buffers)
+		{
+			_pushObjects(CommandType::SetConstantBuffers, stage, start, count, buffers);
+		}
+
+		template<typename T>
+		void SetShaderResources(ShaderStage stage, uint32_t start, uint32_t count, T* const* views)
+		{
+			_pushObjects(CommandType::SetShaderResources, stage, start, count, views);
+		}
+
+		template<typename T>
+		void SetSamplers(ShaderStage stage, uint32_t start, uint32_t count, T* const* samplers)
+		{
+			_pushObjects(CommandType::SetSamplers, stage, start, count, samplers);
+		}
+
+		void SetInputLayout(void* layout)
+		{
+			_push(CommandType::SetInputLayout).object = layout;
+		}
+
+		void SetPrimitiveTopology(uint32_t topology)
+		{
+			_push(CommandType::SetPrimitiveTopology).args[0] = topology;
+		}
+
+		void SetIndexBuffer(void* buffer, uint32_t format, uint32_t offset)
+		{
+			Command& c = _push(CommandType::SetIndexBuffer);
+			c.object = buffer;
+			c.args[0] = format;
+			c.args[1] = offset;
+		}
+
+		template<typename T>
+		void SetVertexBuffers(uint32_t start, uint32_t count, T* const* buffers, const uint32_t* strides,
+			const uint32_t* offsets)
+		{
+			_pushObjects(CommandType::SetVertexBuffers, ShaderStage::VS, start, count, buffers);
+			_append(strides, count * sizeof(uint32_t));
+			_append(offsets, count * sizeof(uint32_t));
+		}
+
+		//binds the topology, index and vertex buffers of mesh to slots from 0, returns false and records nothing
+		//if the mesh has no buffers
+		template<typename T>
+		bool SetMesh(const CommandMesh<T>& mesh)
+		{
+			if (!mesh.indexBuffer || mesh.vertexBufferCount == 0)
+				return false;
+			SetPrimitiveTopology(mesh.topology);
+			SetIndexBuffer(mesh.indexBuffer, mesh.indexFormat, 0);
+			SetVertexBuffers(0, mesh.vertexBufferCount, mesh.vertexBuffers, mesh.strides, mesh.offsets);
+			return true;
+		}
+
+		void SetRasterizerState(void* state)
+		{
+			_push(CommandType::SetRasterizerState).object = state;
+		}
+
+		//factor - 4 floats, or null for the default one
+		void SetBlendState(void* state, const float* factor, uint32_t sampleMask)
+		{
+			Command& c = _push(CommandType::SetBlendState);
+			c.object = state;
+			c.args[0] = sampleMask;
+			c.args[1] = factor != nullptr;
+			if (factor)
+				_append(factor, 4 * sizeof(float));
+		}
+
+		void SetDepthStencilState(void* state, uint32_t stencilRef)
+		{
+			Command& c = _push(CommandType::SetDepthStencilState);
+			c.object = state;
+			c.args[0] = stencilRef;
+		}
+
+		//T has to be laid out like CommandViewport, e.g. D3D11_VIEWPORT
+		template<typename T>
+		void SetViewports(uint32_t count, const T* viewports)
+		{
+			static_assert(sizeof(T) == sizeof(CommandViewport), "viewports are laid out like CommandViewport");
+			_push(CommandType::SetViewports).count = count;
+			_append(viewports, count * sizeof(T));
+		}
+
+		//T has to be laid out like CommandRect, e.g. D3D11_RECT
+		template<typename T>
+		void SetScissorRects(uint32_t count, const T* rects)
+		{
+			static_assert(sizeof(T) == sizeof(CommandRect), "rects are laid out like CommandRect");
+			_push(CommandType::SetScissorRects).count = count;
+			_append(rects, count * sizeof(T));
+		}
+
+		template<typename T>
+		void SetRenderTargets(uint32_t count, T* const* targets, void* depthStencil)
+		{
+			_pushObjects(CommandType::SetRenderTargets, ShaderStage::PS, 0, count, targets);
+			m_commands.back().object = depthStencil;
+		}
+
+		void ClearRenderTarget(void* target, const float (&color)[4])
+		{
+			_push(CommandType::ClearRenderTarget).object = target;
+			_append(color, sizeof(color));
+		}
+
+		void ClearDepthStencil(void* depthStencil, uint32_t flags, float depth, uint8_t stencil)
+		{
+			Command& c = _push(CommandType::ClearDepthStencil);
+			c.object = depthStencil;
+			c.args[0] = flags;
+			memcpy(&c.args[1], &depth, sizeof(depth));
+			c.args[2] = stencil;
+		}
+
+		//Discards the contents of the buffer and writes its first size bytes. Returns where they have to be written,
+		//valid until the next command is recorded.
+		void* UpdateBuffer(void* buffer, uint32_t size)
+		{
+			Command& c = _push(CommandType::UpdateBuffer);
+			c.object = buffer;
+			c.count = size;
+			return _reserve(size);
+		}
+
+		void UpdateBuffer(void* buffer, const void* data, uint32_t size)
+		{
+			memcpy(UpdateBuffer(buffer, size), data, size);
+		}
+
+		void CopyResource(void* destination, void* source)
+		{
+			_push(CommandType::CopyResource).object = destination;
+			_append(&source, sizeof(source));
+		}
+
+		void Draw(uint32_t vertexCount, uint32_t startVertex)
+		{
+			Command& c = _push(CommandType::Draw);
+			c.count = vertexCount;
+			c.args[0] = startVertex;
+		}
+
+		void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+		{
+			Command& c = _push(CommandType::DrawIndexed);
+			c.count = indexCount;
+			c.args[0] = startIndex;
+			c.args[1] = static_cast<uint32_t>(baseVertex);
+		}
+
+		void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
+			uint32_t startInstance)
+		{
+			Command& c = _push(CommandType::DrawIndexedInstanced);
+			c.count = indexCount;
+			c.args[0] = startIndex;
+			c.args[1] = static_cast<uint32_t>(baseVertex);
+			c.args[2] = instanceCount;
+			c.args[3] = startInstance;
+		}
+
+		void ClearState()
+		{
+			_push(CommandType::ClearState);
+		}
+
+		//Calls back with the native context when executed, for work that can't be recorded.
+		//changesState - false if the callback leaves bound state as it was, e.g. only copies resources
+		void Native(NativeCallback callback, const void* user, bool changesState = true)
+		{
+			Command& c = _push(CommandType::Native);
+			c.object = const_cast<void*>(user);
+			c.args[0] = changesState;
+			_append(&callback, sizeof(callback));
+		}
+
+	private:
+		//data of commands starts at multiples of 16 bytes, so that buffer contents can be written in place with SSE
+		static constexpr size_t PayloadAlignment = 16;
+
+		static constexpr size_t _padded(size_t size)
+		{
+			return (size + PayloadAlignment - 1) / PayloadAlignment * PayloadAlignment;
+		}
+
+		Command& _push(CommandType type, ShaderStage stage = ShaderStage::VS)
+		{
+			m_commands.push_back({ type, stage, 0, 0, static_cast<uint32_t>(m_payload.size()), nullptr, { 0, 0, 0, 0 } });
+			return m_commands.back();
+		}
+
+		void* _reserve(size_t size)
+		{
+			const size_t offset = m_payload.size();
+			assert(offset % PayloadAlignment == 0);
+			m_payload.resize(offset + _padded(size));
+			return m_payload.data() + offset;
+		}
+
+		void _append(const void* data, size_t size)
+		{
+			if (size > 0)
+				memcpy(_reserve(size), data, size);
+		}
+
+		template<typename T>
+		void _pushObjects(CommandType type, ShaderStage stage, uint32_t start, uint32_t count, T* const* objects)
+		{
+			Command& c = _push(type, stage);
+			c.start = start;
+			c.count = count;
+			void** dst = static_cast<void**>(_reserve(count * sizeof(void*)));
+			for (uint32_t i = 0; i < count; ++i)
+				dst[i] = objects[i];
+		}
+
+		std::vector<Command> m_commands;
+		std::vector<unsigned char> m_payload;
+	};
+
+	//Replays command lists on a graphics API, or only inspects them
+	class ICommandExecutor
+	{
+	public:
+		virtual ~ICommandExecutor() = default;
+
+		virtual void Execute(const CommandList& commands) = 0;
+	};
+}
@@ -0,0 +1,174 @@
+#include "dxCommandExecutor.h"
+#include "exceptions.h"
+#include <cstring>
+
+using namespace std;
+using namespace mini;
+using namespace directx;
+
+static_assert(commandLimits::ConstantBufferSlots == D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT &&
+	commandLimits::ShaderResourceSlots == D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT &&
+	commandLimits::SamplerSlots == D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT &&
+	commandLimits::VertexBufferSlots == D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT &&
+	commandLimits::RenderTargetSlots == D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT &&
+	commandLimits::ViewportSlots == D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE,
+	"command limits are the ones of Direct3D 11");
+static_assert(sizeof(CommandViewport) == sizeof(D3D11_VIEWPORT) && sizeof(CommandRect) == sizeof(D3D11_RECT),
+	"viewports and rects are laid out like the Direct3D ones");
+
+namespace
+{
+	template<typename T>
+	T* object(const Command& c) { return static_cast<T*>(c.object); }
+
+	template<typename T>
+	T* const* objects(const CommandList& commands, const Command& c)
+	{
+		return reinterpret_cast<T* const*>(commands.Payload<void*>(c));
+	}
+}
+
+void DxCommandExecutor::Execute(const CommandList& commands)
+{
+	for (const Command& c : commands.Commands())
+		_execute(commands, c);
+}
+
+void DxCommandExecutor::_execute(const CommandList& commands, const Command& c)
+{
+	const auto& context = m_state.Context();
+	switch (c.type)
+	{
+	case CommandType::SetShader:
+		switch (c.stage)
+		{
+		case ShaderStage::VS: m_state.VSSetShader(object<ID3D11VertexShader>(c)); break;
+		case ShaderStage::HS: m_state.HSSetShader(object<ID3D11HullShader>(c)); break;
+		case ShaderStage::DS: m_state.DSSetShader(object<ID3D11DomainShader>(c)); break;
+		case ShaderStage::GS: m_state.GSSetShader(object<ID3D11GeometryShader>(c)); break;
+		case ShaderStage::PS: m_state.PSSetShader(object<ID3D11PixelShader>(c)); break;
+		default: break;
+		}
+		break;
+	case CommandType::SetConstantBuffers:
+	{
+		auto buffers = objects<ID3D11Buffer>(commands, c);
+		switch (c.stage)
+		{
+		case ShaderStage::VS: m_state.VSSetConstantBuffers(c.start, c.count, buffers); break;
+		case ShaderStage::HS: m_state.HSSetConstantBuffers(c.start, c.count, buffers); break;
+		case ShaderStage::DS: m_state.DSSetConstantBuffers(c.start, c.count, buffers); break;
+		case ShaderStage::GS: m_state.GSSetConstantBuffers(c.start, c.count, buffers); break;
+		case ShaderStage::PS: m_state.PSSetConstantBuffers(c.start, c.count, buffers); break;
+		default: break;
+		}
+		break;
+	}
+	case CommandType::SetShaderResources:
+	{
+		auto views = objects<ID3D11ShaderResourceView>(commands, c);
+		switch (c.stage)
+		{
+		case ShaderStage::VS: m_state.VSSetShaderResources(c.start, c.count, views); break;
+		case ShaderStage::HS: m_state.HSSetShaderResources(c.start, c.count, views); break;
+		case ShaderStage::DS: m_state.DSSetShaderResources(c.start, c.count, views); break;
+		case ShaderStage::GS: m_state.GSSetShaderResources(c.start, c.count, views); break;
+		case ShaderStage::PS: m_state.PSSetShaderResources(c.start, c.count, views); break;
+		default: break;
+		}
+		break;
+	}
+	case CommandType::SetSamplers:
+	{
+		auto samplers = objects<ID3D11SamplerState>(commands, c);
+		switch (c.stage)
+		{
+		case ShaderStage::VS: m_state.VSSetSamplers(c.start, c.count, samplers); break;
+		case ShaderStage::HS: m_state.HSSetSamplers(c.start, c.count, samplers); break;
+		case ShaderStage::DS: m_state.DSSetSamplers(c.start, c.count, samplers); break;
+		case ShaderStage::GS: m_state.GSSetSamplers(c.start, c.count, samplers); break;
+		case ShaderStage::PS: m_state.PSSetSamplers(c.start, c.count, samplers); break;
+		default: break;
+		}
+		break;
+	}
+	case CommandType::SetInputLayout:
+		m_state.IASetInputLayout(object<ID3D11InputLayout>(c));
+		break;
+	case CommandType::SetPrimitiveTopology:
+		m_state.IASetPrimitiveTopology(static_cast<D3D11_PRIMITIVE_TOPOLOGY>(c.args[0]));
+		break;
+	case CommandType::SetIndexBuffer:
+		m_state.IASetIndexBuffer(object<ID3D11Buffer>(c), static_cast<DXGI_FORMAT>(c.args[0]), c.args[1]);
+		break;
+	case CommandType::SetVertexBuffers:
+	{
+		const auto arrays = commands.VertexBuffers(c);
+		m_state.IASetVertexBuffers(c.start, c.count, reinterpret_cast<ID3D11Buffer* const*>(arrays.buffers),
+			arrays.strides, arrays.offsets);
+		break;
+	}
+	case CommandType::SetRasterizerState:
+		m_state.RSSetState(object<ID3D11RasterizerState>(c));
+		break;
+	case CommandType::SetBlendState:
+		context->OMSetBlendState(object<ID3D11BlendState>(c), c.args[1] ? commands.Payload<float>(c) : nullptr, c.args[0]);
+		break;
+	case CommandType::SetDepthStencilState:
+		context->OMSetDepthStencilState(object<ID3D11DepthStencilState>(c), c.args[0]);
+		break;
+	case CommandType::SetViewports:
+		m_state.RSSetViewports(c.count, commands.Payload<D3D11_VIEWPORT>(c));
+		break;
+	case CommandType::SetScissorRects:
+		context->RSSetScissorRects(c.count, commands.Payload<D3D11_RECT>(c));
+		break;
+	case CommandType::SetRenderTargets:
+		m_state.OMSetRenderTargets(c.count, objects<ID3D11RenderTargetView>(commands, c),
+			object<ID3D11DepthStencilView>(c));
+		break;
+	case CommandType::ClearRenderTarget:
+		context->ClearRenderTargetView(object<ID3D11RenderTargetView>(c), commands.Payload<float>(c));
+		break;
+	case CommandType::ClearDepthStencil:
+	{
+		float depth;
+		memcpy(&depth, &c.args[1], sizeof(depth));
+		context->ClearDepthStencilView(object<ID3D11DepthStencilView>(c), c.args[0], depth, static_cast<UINT8>(c.args[2]));
+		break;
+	}
+	case CommandType::UpdateBuffer:
+	{
+		D3D11_MAPPED_SUBRESOURCE resource;
+		auto hr = context->Map(object<ID3D11Buffer>(c), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
+		if (FAILED(hr))
+			throw utils::winapi_error{ hr };
+		memcpy(resource.pData, commands.Payload<unsigned char>(c), c.count);
+		context->Unmap(object<ID3D11Buffer>(c), 0);
+		break;
+	}
+	case CommandType::CopyResource:
+		context->CopyResource(object<ID3D11Resource>(c), *objects<ID3D11Resource>(commands, c));
+		break;
+	case CommandType::Draw:
+		context->Draw(c.count, c.args[0]);
+		break;
+	case CommandType::DrawIndexed:
+		context->DrawIndexed(c.count, c.args[0], static_cast<INT>(c.args[1]));
+		break;
+	case CommandType::DrawIndexedInstanced:
+		context->DrawIndexedInstanced(c.count, c.args[2], c.args[0], static_cast<INT>(c.args[1]), c.args[3]);
+		break;
+	case CommandType::ClearState:
+		context->ClearState();
+		m_state.Invalidate();
+		break;
+	case CommandType::Native:
+		(*commands.Payload<NativeCallback>(c))(c.object, const_cast<dx_ptr<ID3D11DeviceContext>*>(&context));
+		if (c.args[0])
+			m_state.Invalidate();
+		break;
+	default:
+		break;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "commandList.h"
+#include "stateCache.h"
+
+namespace mini
+{
+	//Replays command lists on a Direct3D 11 device context. Bindings go through the state cache, which drops
+	//the redundant ones, buffer updates map the buffers with WRITE_DISCARD. Native callbacks get a pointer to
+	//the const dx_ptr<ID3D11DeviceContext> of the executor.
+	class DxCommandExecutor : public ICommandExecutor
+	{
+	public:
+		explicit DxCommandExecutor(const directx::dx_ptr<ID3D11DeviceContext>& context)
+			: m_state(context) { }
+
+		//cache of the state bound by executed commands, has to be invalidated when the context is used directly
+		StateCache& State() { return m_state; }
+		const StateCache& State() const { return m_state; }
+
+		void Execute(const CommandList& commands) override;
+
+	private:
+		void _execute(const CommandList& commands, const Command& c);
+
+		StateCache m_state;
+	};
+}
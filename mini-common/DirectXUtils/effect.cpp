@@ -8,6 +8,12 @@ void DynamicEffect::Begin(const dx_ptr<ID3D11DeviceContext>& context) const
 		compPtr->Begin(context);
 }
 
+void DynamicEffect::Begin(CommandList& commands) const
+{
+	for (auto& compPtr : m_components)
+		compPtr->Begin(commands);
+}
+
 //Effect::Effect(dx_ptr<ID3D11VertexShader>&& vs, dx_ptr<ID3D11HullShader>&& hs, dx_ptr<ID3D11DomainShader>&& ds, dx_ptr<ID3D11GeometryShader>&& gs, dx_ptr<ID3D11PixelShader>&& ps)
 //	: m_vs(move(vs)), m_hs(move(hs)), m_ds(move(ds)), m_gs(move(gs)), m_ps(move(ps))
 //{ }
@@ -7,6 +7,7 @@
 #include "constantBuffer.h"
 #include <iterator>
 #include "dxstructures.h"
+#include "commandList.h"
 
 namespace mini
 {
@@ -26,6 +27,14 @@ namespace mini
 		EffectComponent& operator=(EffectComponent&& other) = default;
 
 		virtual void Begin(const dx_ptr<ID3D11DeviceContext>& context) const = 0;
+		//Records binding of the state into the command list. By default the component is begun on the context
+		//of the executor from a native callback, after which the bound state isn't known to the executor.
+		virtual void Begin(CommandList& commands) const
+		{
+			commands.Native([](const void* component, void* context) {
+				static_cast<const EffectComponent*>(component)->Begin(*static_cast<const dx_ptr<ID3D11DeviceContext>*>(context));
+			}, this);
+		}
 	};
 
 	class BasicEffect : public EffectComponent
@@ -50,6 +59,12 @@ namespace mini
 			context->PSSetShader(m_ps.get(), nullptr, 0);
 		}
 
+		void Begin(CommandList& commands) const override
+		{
+			commands.SetShader(ShaderStage::VS, m_vs.get());
+			commands.SetShader(ShaderStage::PS, m_ps.get());
+		}
+
 		void SetVertexShader(dx_ptr<ID3D11VertexShader>&& vs) { m_vs = move(vs); }
 		void SetPixelShader(dx_ptr<ID3D11PixelShader>&& ps) { m_ps = move(ps); }
 
@@ -79,6 +94,12 @@ namespace mini
 			context->DSSetShader(m_ds.get(), nullptr, 0);
 		}
 
+		void Begin(CommandList& commands) const override
+		{
+			commands.SetShader(ShaderStage::HS, m_hs.get());
+			commands.SetShader(ShaderStage::DS, m_ds.get());
+		}
+
 		void SetHullShader(dx_ptr<ID3D11HullShader>&& hs) { m_hs = move(hs); }
 		void SetDomainShader(dx_ptr<ID3D11DomainShader>&& ds) { m_ds = move(ds); }
 
@@ -106,6 +127,11 @@ namespace mini
 			context->GSSetShader(m_gs.get(), nullptr, 0);
 		}
 
+		void Begin(CommandList& commands) const override
+		{
+			commands.SetShader(ShaderStage::GS, m_gs.get());
+		}
+
 		void SetGeometryShader(dx_ptr<ID3D11GeometryShader>&& gs) { m_gs = move(gs); }
 
 		dx_ptr<ID3D11GeometryShader> m_gs;
@@ -236,6 +262,8 @@ namespace mini
 
 #define CONTEXT_SET_F_NAME(SHADER_TYPE, RESOURCE_TYPE) SHADER_TYPE ## Set ## RESOURCE_TYPE ## s
 
+#define COMMAND_SET_F_NAME(RESOURCE_TYPE) Set ## RESOURCE_TYPE ## s
+
 #define GET_RESOURCES_VECTOR_F_NAME(SHADER_TYPE, RESOURCE_TYPE) get ## SHADER_TYPE ## RESOURCE_TYPE ## Vector
 
 #define DEFINE_RESOURCE_SET_CLASS(SHADER_TYPE, RESOURCE_TYPE) \
@@ -261,6 +289,9 @@ namespace mini
 		void Begin(const dx_ptr<ID3D11DeviceContext>& context) const override {\
 			context-> CONTEXT_SET_F_NAME(SHADER_TYPE, RESOURCE_TYPE) (0, static_cast<unsigned>(m_buffers.size()), m_buffers.data());\
 		}\
+		void Begin(CommandList& commands) const override {\
+			commands. COMMAND_SET_F_NAME(RESOURCE_TYPE) (ShaderStage::SHADER_TYPE, 0, static_cast<unsigned>(m_buffers.size()), m_buffers.data());\
+		}\
 		dx_ptr_vector<value_type>& GET_RESOURCES_VECTOR_F_NAME(SHADER_TYPE, RESOURCE_TYPE) ()\
 		{ return m_buffers; }\
 		const dx_ptr_vector<value_type>& GET_RESOURCES_VECTOR_F_NAME(SHADER_TYPE, RESOURCE_TYPE) () const\
@@ -333,6 +364,14 @@ namespace mini
 			context->OMSetRenderTargets(static_cast<UINT>(m_buffers.size()), m_buffers.data(), m_depthBuffer.get());
 		}
 
+		void Begin(CommandList& commands) const override
+		{
+			if (m_clearOnBegin)
+				ClearRenderTargets(commands);
+			commands.SetViewports(1, &m_viewport);
+			commands.SetRenderTargets(static_cast<UINT>(m_buffers.size()), m_buffers.data(), m_depthBuffer.get());
+		}
+
 		void SetRenderTarget(unsigned slot, dx_ptr<ID3D11RenderTargetView>&& renderTarget)
 		{
 			SetResource(slot, std::move(renderTarget));
@@ -369,6 +408,19 @@ namespace mini
 			ClearDepthStencil(context);
 		}
 
+		void ClearDepthStencil(CommandList& commands, UINT clearFlags = D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL) const
+		{
+			if (m_depthBuffer)
+				commands.ClearDepthStencil(m_depthBuffer.get(), clearFlags, 1.0f, 0);
+		}
+
+		void ClearRenderTargets(CommandList& commands, const float (&color)[4] = { 0.0f, 0.0f, 0.0f, 0.0f }) const
+		{
+			for (auto rtv : m_buffers)
+				commands.ClearRenderTarget(rtv, color);
+			ClearDepthStencil(commands);
+		}
+
 		ID3D11RenderTargetView* getRenderTarget(unsigned slot) const { return m_buffers[slot]; }
 		ID3D11DepthStencilView* getDepthStencilBuffer() const { return m_depthBuffer.get(); }
 		const directx::viewport& getViewport() const { return m_viewport; }
@@ -393,6 +445,11 @@ namespace mini
 			context->IASetInputLayout(m_layout.get());
 		}
 
+		void Begin(CommandList& commands) const override
+		{
+			commands.SetInputLayout(m_layout.get());
+		}
+
 		void SetInputLayout(dx_ptr<ID3D11InputLayout>&& layout) { m_layout = std::move(layout); }
 
 	private:
@@ -413,6 +470,11 @@ namespace mini
 			context->RSSetState(m_state.get());
 		}
 
+		void Begin(CommandList& commands) const override
+		{
+			commands.SetRasterizerState(m_state.get());
+		}
+
 		void SetState(dx_ptr<ID3D11RasterizerState>&& state) { m_state = std::move(state); }
 
 	private:
@@ -443,6 +505,7 @@ namespace mini
 		}
 
 		void Begin(const dx_ptr<ID3D11DeviceContext>& context) const override;
+		void Begin(CommandList& commands) const override;
 
 		//this field is public since any content of the vector is a valid one
 		//and replicating an iterface for modifying the contents of the vector
@@ -469,6 +532,11 @@ namespace mini
 			_Begin<COMPONENTS_T...>(context);
 		}
 
+		void Begin(CommandList& commands) const override
+		{
+			_Begin<COMPONENTS_T...>(commands);
+		}
+
 	private:
 
 		template<typename T>
@@ -484,17 +552,17 @@ namespace mini
 			_Assign<T2, ARGS...>(std::move(component2), std::move(otherComponents)...);
 		}
 
-		template<typename T>
-		void _Begin(const dx_ptr<ID3D11DeviceContext>& context) const
+		template<typename T, typename Target>
+		void _Begin(Target& target) const
 		{
-			T::Begin(context);
+			T::Begin(target);
 		}
 
-		template<typename T, typename T2, typename... ARGS>
-		void _Begin(const dx_ptr<ID3D11DeviceContext>& context) const
+		template<typename T, typename T2, typename... ARGS, typename Target>
+		void _Begin(Target& target) const
 		{
-			T::Begin(context);
-			_Begin<T2, ARGS...>(context);
+			T::Begin(target);
+			_Begin<T2, ARGS...>(target);
 		}
 	};
 	
@@ -0,0 +1,178 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mini::utils
+{
+	//Runs registered simulation systems with a fixed time step, independently of the frame rate.
+	//Frame time is accumulated and consumed in whole steps, at most max_substeps per frame; the time
+	//which does not fit is dropped, so a long frame slows the simulation down instead of destabilizing it.
+	//With run_ahead enabled steps are executed on a worker thread while the frame is rendered. Each call
+	//to advance() then waits for the steps scheduled by the previous call, synchronizes the systems
+	//and schedules the next steps, so rendering uses state one frame behind the simulation.
+	class fixed_step_scheduler
+	{
+	public:
+		//called once per step with the fixed time step
+		using step_function = std::function<void(float)>;
+		//called on the thread calling advance(), after a batch of at least one step has finished and
+		//before the next one starts, e.g. to upload simulation results to the GPU
+		using sync_function = std::function<void()>;
+
+		static constexpr unsigned default_max_substeps = 8;
+
+		explicit fixed_step_scheduler(float step, unsigned max_substeps = default_max_substeps, bool run_ahead = false)
+			: m_step{ step }, m_max_substeps{ std::max(1U, max_substeps) }, m_accumulator{ 0.0f },
+			m_step_count{ 0 }, m_dropped_time{ 0.0f }, m_pending_steps{ 0 }, m_busy{ false }, m_stop{ false },
+			m_last_batch{ 0 }
+		{
+			if (run_ahead)
+				m_worker = std::thread{ [this] { worker_loop(); } };
+		}
+
+		fixed_step_scheduler(const fixed_step_scheduler&) = delete;
+		fixed_step_scheduler& operator=(const fixed_step_scheduler&) = delete;
+
+		~fixed_step_scheduler()
+		{
+			if (!m_worker.joinable())
+				return;
+			{
+				std::lock_guard lock{ m_mutex };
+				m_stop = true;
+			}
+			m_wake.notify_all();
+			m_worker.join();
+		}
+
+		//Systems are stepped in the order they were added. Must not be called while steps are running,
+		//i.e. add systems before the first advance() or right after wait().
+		void add_system(step_function step, sync_function sync = {})
+		{
+			m_systems.push_back({ std::move(step), std::move(sync) });
+		}
+
+		//Accumulates frame_time seconds and runs (or schedules) the steps that fit.
+		//Returns the number of steps run or scheduled.
+		unsigned advance(float frame_time)
+		{
+			if (m_worker.joinable())
+			{
+				wait();
+				if (m_last_batch > 0)
+					sync_systems();
+			}
+			m_accumulator += std::max(frame_time, 0.0f);
+			const float max_time = m_step * static_cast<float>(m_max_substeps);
+			if (m_accumulator >= max_time + m_step)
+			{
+				m_dropped_time += m_accumulator - max_time;
+				m_accumulator = max_time;
+			}
+			unsigned steps = 0;
+			for (; m_accumulator >= m_step && steps < m_max_substeps; ++steps)
+				m_accumulator -= m_step;
+			m_last_batch = steps;
+			m_step_count += steps;
+			if (steps == 0)
+				return 0;
+			if (!m_worker.joinable())
+			{
+				run_steps(steps);
+				sync_systems();
+				return steps;
+			}
+			{
+				std::lock_guard lock{ m_mutex };
+				m_pending_steps = steps;
+				m_busy = true;
+			}
+			m_wake.notify_all();
+			return steps;
+		}
+
+		//Waits until the steps scheduled on the worker thread are done. Does nothing without run_ahead.
+		void wait()
+		{
+			std::unique_lock lock{ m_mutex };
+			m_done.wait(lock, [this] { return !m_busy; });
+		}
+
+		//Fraction of a step accumulated but not simulated yet, for interpolating between the last two states.
+		[[nodiscard]] float alpha() const noexcept { return m_accumulator / m_step; }
+		[[nodiscard]] float step() const noexcept { return m_step; }
+		[[nodiscard]] unsigned max_substeps() const noexcept { return m_max_substeps; }
+		[[nodiscard]] bool runs_ahead() const noexcept { return m_worker.joinable(); }
+		//number of steps run or scheduled so far
+		[[nodiscard]] uint64_t step_count() const noexcept { return m_step_count; }
+		//frame time discarded because of the substep limit, in seconds
+		[[nodiscard]] float dropped_time() const noexcept { return m_dropped_time; }
+
+	private:
+		struct system
+		{
+			step_function step;
+			sync_function sync;
+		};
+
+		void run_steps(unsigned steps)
+		{
+			for (unsigned i = 0; i < steps; ++i)
+				for (auto& s : m_systems)
+					s.step(m_step);
+		}
+
+		void sync_systems()
+		{
+			for (auto& s : m_systems)
+				if (s.sync)
+					s.sync();
+		}
+
+		void worker_loop()
+		{
+			while (true)
+			{
+				unsigned steps;
+				{
+					std::unique_lock lock{ m_mutex };
+					m_wake.wait(lock, [this] { return m_stop || m_pending_steps != 0; });
+					if (m_stop)
+						return;
+					steps = m_pending_steps;
+					m_pending_steps = 0;
+				}
+				run_steps(steps);
+				{
+					std::lock_guard lock{ m_mutex };
+					m_busy = false;
+				}
+				m_done.notify_all();
+			}
+		}
+
+		float m_step;
+		unsigned m_max_substeps;
+		float m_accumulator;
+		uint64_t m_step_count;
+		float m_dropped_time;
+		std::vector<system> m_systems;
+
+		std::thread m_worker;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		//steps handed to the worker and not yet started
+		unsigned m_pending_steps;
+		//worker has steps to run or is running them
+		bool m_busy;
+		bool m_stop;
+		//number of steps in the batch scheduled by the last advance()
+		unsigned m_last_batch;
+	};
+}
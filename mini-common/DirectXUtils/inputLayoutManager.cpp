@@ -48,6 +48,17 @@ size_t InputLayoutManager::registerVertexAttributesID(const VertexAttributes& at
 	return it->second;
 }
 
+size_t InputLayoutManager::registerInstanceAttributesID(size_t vertexAttributesID, const VertexAttributes& instanceAttributes)
+{
+	auto attribsIt = find_if(m_knownVertexAttributes.begin(), m_knownVertexAttributes.end(),
+		[vertexAttributesID](auto& p) { return p.second == vertexAttributesID; });
+	if (attribsIt == m_knownVertexAttributes.end())
+		throw utils::custom_error{ L"Unregistered vertex attribute set!" };
+	std::vector<D3D11_INPUT_ELEMENT_DESC> attribs(attribsIt->first.begin(), attribsIt->first.end());
+	attribs.insert(attribs.end(), instanceAttributes.begin(), instanceAttributes.end());
+	return registerVertexAttributesID(VertexAttributes(move(attribs)));
+}
+
 const dx_ptr<ID3D11InputLayout>& InputLayoutManager::getLayout(size_t vertexAttributesID, size_t signatureID)
 {
 	auto idPair = make_pair(vertexAttributesID, signatureID);
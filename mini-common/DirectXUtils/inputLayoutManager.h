@@ -47,6 +47,10 @@ namespace mini
 			return it->second;
 		}
 
+		//Registers the attributes of vertexAttributesID extended with per instance elements (e.g. of an instance buffer
+		//bound to a slot unused by the mesh). Returns the ID of the combined set, usable with getLayout.
+		size_t registerInstanceAttributesID(size_t vertexAttributesID, const VertexAttributes& instanceAttributes);
+
 		const dx_ptr<ID3D11InputLayout>& getLayout(size_t vertexAttributesID, size_t signatureID);
 
 	private:
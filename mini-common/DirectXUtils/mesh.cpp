@@ -3,14 +3,50 @@
 using namespace std;
 using namespace mini;
 
-void Mesh::Render(const dx_ptr<ID3D11DeviceContext>& context) const
+bool Mesh::_setBuffers(const dx_ptr<ID3D11DeviceContext>& context) const
 {
 	if (!m_indexBuffer || m_vertexBuffers.empty())
-		return;
+		return false;
 	context->IASetPrimitiveTopology(m_primitiveType);
 	context->IASetIndexBuffer(m_indexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
 	context->IASetVertexBuffers(0, m_buffersCount, m_vertexBuffers.data(), m_strides.data(), m_offsets.data());
-	context->DrawIndexed(m_indexCount, 0, 0);
+	return true;
+}
+
+CommandMesh<ID3D11Buffer> Mesh::Bindings() const
+{
+	return { static_cast<uint32_t>(m_primitiveType), m_indexBuffer.get(), DXGI_FORMAT_R16_UINT, m_indexCount,
+		m_vertexBuffers.empty() ? 0 : m_buffersCount, m_vertexBuffers.data(), m_strides.data(), m_offsets.data() };
+}
+
+bool Mesh::_setBuffers(CommandList& commands) const
+{
+	return commands.SetMesh(Bindings());
+}
+
+void Mesh::Render(const dx_ptr<ID3D11DeviceContext>& context) const
+{
+	if (_setBuffers(context))
+		context->DrawIndexed(m_indexCount, 0, 0);
+}
+
+void Mesh::RenderInstanced(const dx_ptr<ID3D11DeviceContext>& context, unsigned int instanceCount,
+	unsigned int startInstance) const
+{
+	if (instanceCount > 0 && _setBuffers(context))
+		context->DrawIndexedInstanced(m_indexCount, instanceCount, 0, 0, startInstance);
+}
+
+void Mesh::Render(CommandList& commands) const
+{
+	if (_setBuffers(commands))
+		commands.DrawIndexed(m_indexCount, 0, 0);
+}
+
+void Mesh::RenderInstanced(CommandList& commands, unsigned int instanceCount, unsigned int startInstance) const
+{
+	if (instanceCount > 0 && _setBuffers(commands))
+		commands.DrawIndexedInstanced(m_indexCount, instanceCount, 0, 0, startInstance);
 }
 
 Mesh::Mesh()
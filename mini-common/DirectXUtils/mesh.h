@@ -5,6 +5,7 @@
 #include <DirectXMath.h>
 #include <D3D11.h>
 #include "dxArray.h"
+#include "commandList.h"
 
 namespace mini
 {
@@ -38,8 +39,20 @@ namespace mini
 		Mesh& operator=(const Mesh& right) = delete;
 		Mesh& operator=(Mesh&& right);
 		void Render(const dx_ptr<ID3D11DeviceContext>& context) const;
+		//draws instanceCount instances with a single call, per instance buffers have to be bound to slots
+		//not used by the mesh, e.g. the last one. startInstance is added to the instance index before reading them.
+		void RenderInstanced(const dx_ptr<ID3D11DeviceContext>& context, unsigned int instanceCount,
+			unsigned int startInstance = 0) const;
+		//same as above, recorded into the command list
+		void Render(CommandList& commands) const;
+		void RenderInstanced(CommandList& commands, unsigned int instanceCount, unsigned int startInstance = 0) const;
+		//buffers bound by the draws of the mesh recorded into command lists
+		CommandMesh<ID3D11Buffer> Bindings() const;
 
 	private:
+		//returns false if there is nothing to draw
+		bool _setBuffers(const dx_ptr<ID3D11DeviceContext>& context) const;
+		bool _setBuffers(CommandList& commands) const;
 
 		dx_ptr<ID3D11Buffer> m_indexBuffer;
 		dx_ptr_vector<ID3D11Buffer> m_vertexBuffers;
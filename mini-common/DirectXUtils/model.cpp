@@ -1,30 +1,26 @@
 #include "model.h"
+#include <algorithm>
 
 using namespace std;
 using namespace DirectX;
 using namespace mini;
 
 Model::NodeIterator::NodeIterator()
-	: m_model(nullptr)
+	: m_model(nullptr), m_position(0)
 {
 }
 
 Model::NodeIterator::NodeIterator(const Model& m)
-	: m_model(&m)
+	: m_model(&m), m_position(0)
 {
-	if (m.m_nodes.size() != 0)
-	{
-		pushToLeaf(0);
-		if (node().meshIndex == -1)
-			++*this;
-	}
+	m.updateWorldTransforms();
 }
 
 bool Model::NodeIterator::operator==(const NodeIterator& other) const
 {
-	if (m_nodeStack.empty() && other.m_nodeStack.empty())
+	if (atEnd() && other.atEnd())
 		return true;
-	return m_model == other.m_model && m_nodeStack.top().first == other.m_nodeStack.top().first;
+	return m_model == other.m_model && m_position == other.m_position;
 }
 
 bool Model::NodeIterator::operator!=(const NodeIterator& other) const
@@ -34,15 +30,8 @@ bool Model::NodeIterator::operator!=(const NodeIterator& other) const
 
 Model::NodeIterator& Model::NodeIterator::operator++()
 {
-	if (m_nodeStack.empty())
-		return *this;
-	do
-	{
-		int currentNode = node().nextIndex;
-		m_nodeStack.pop();
-		if (currentNode != -1)
-			pushToLeaf(currentNode);
-	} while (!m_nodeStack.empty() && node().meshIndex == -1);
+	if (!atEnd())
+		++m_position;
 	return *this;
 }
 
@@ -58,33 +47,21 @@ pair<const Mesh&, const XMFLOAT4X4&> Model::NodeIterator::operator*() const
 	return{ mesh(), transform() };
 }
 
-void Model::NodeIterator::pushNode(int nodeIndex)
-{
-	XMFLOAT4X4 nodeTransform = m_model->getNode(nodeIndex).localTransform;
-	if (!m_nodeStack.empty())
-		XMStoreFloat4x4(&nodeTransform, XMLoadFloat4x4(&nodeTransform)*XMLoadFloat4x4(&transform()));
-	m_nodeStack.push(make_pair(nodeIndex, nodeTransform));
-}
-
-void Model::NodeIterator::pushToLeaf(int nodeIndex)
-{
-	while (nodeIndex != -1)
-	{
-		pushNode(nodeIndex);
-		nodeIndex = node().childIndex;
-	}
-}
-
-Model::Model(vector<Mesh>&& meshes, vector<size_t>&& signatures, vector<ModelNode>&& nodes)
-	: m_meshes(move(meshes)), m_meshSignatures(move(signatures)), m_nodes(move(nodes))
+Model::Model(vector<Mesh>&& meshes, vector<size_t>&& signatures, vector<ModelNode>&& nodes, vector<MeshBounds>&& bounds)
+	: m_meshes(move(meshes)), m_meshSignatures(move(signatures)), m_meshBounds(m_meshes.size()), m_nodes(move(nodes))
 {
 	assert(m_meshes.size() == m_meshSignatures.size());
+	assert(bounds.empty() || bounds.size() == m_meshes.size());
+	for (size_t i = 0; i < bounds.size(); ++i)
+		m_meshBounds[i] = bounds[i];
+	_flattenHierarchy();
 }
 
 int Model::addMesh(Mesh&& m, size_t signatureID)
 {
 	m_meshes.push_back(move(m));
 	m_meshSignatures.push_back(signatureID);
+	m_meshBounds.emplace_back();
 	assert(m_meshes.size() - 1 < INT_MAX);
 	return static_cast<int>(m_meshes.size() - 1);
 }
@@ -105,6 +82,7 @@ int Model::addNode(const ModelNode& node, int parentNodeIndex)
 			pIndex = &m_nodes[*pIndex].nextIndex;
 		*pIndex = nodeIndex;
 	}
+	_flattenHierarchy();
 	return nodeIndex;
 }
 
@@ -125,6 +103,18 @@ size_t Model::getMeshSignatureID(int meshIndex) const
 	return m_meshSignatures[meshIndex];
 }
 
+const MeshBounds* Model::getMeshBounds(int meshIndex) const
+{
+	assert(meshIndex >= 0 && static_cast<size_t>(meshIndex) < m_meshBounds.size());
+	return m_meshBounds[meshIndex] ? &*m_meshBounds[meshIndex] : nullptr;
+}
+
+void Model::setMeshBounds(int meshIndex, const MeshBounds& bounds)
+{
+	assert(meshIndex >= 0 && static_cast<size_t>(meshIndex) < m_meshBounds.size());
+	m_meshBounds[meshIndex] = bounds;
+}
+
 const ModelNode& Model::getNode(int nodeIndex) const
 {
 	assert(nodeIndex >= 0 && static_cast<size_t>(nodeIndex) < m_nodes.size());
@@ -135,6 +125,7 @@ void Model::setNodeTransform(int nodeIndex, const XMFLOAT4X4& transform)
 {
 	assert(nodeIndex >= 0 && static_cast<size_t>(nodeIndex) < m_nodes.size());
 	m_nodes[nodeIndex].localTransform = transform;
+	_invalidate(nodeIndex);
 }
 
 void Model::applyTransform(const DirectX::XMFLOAT4X4& transform)
@@ -146,10 +137,75 @@ void Model::applyTransform(const DirectX::XMFLOAT4X4& transform)
 	{
 		ModelNode& currentNode = m_nodes[currentIndex];
 		XMStoreFloat4x4(&currentNode.localTransform, XMLoadFloat4x4(&currentNode.localTransform) * XMLoadFloat4x4(&transform));
+		_invalidate(currentIndex);
 		currentIndex = currentNode.nextIndex;
 	}
 }
 
+const XMFLOAT4X4& Model::getWorldTransform(int nodeIndex) const
+{
+	assert(nodeIndex >= 0 && static_cast<size_t>(nodeIndex) < m_nodes.size());
+	updateWorldTransforms();
+	return m_worldTransforms[m_nodeSlots[nodeIndex]];
+}
+
+void Model::_invalidate(int nodeIndex)
+{
+	m_dirtyTransforms[m_nodeSlots[nodeIndex]] = 1;
+	m_transformsDirty = true;
+}
+
+void Model::updateWorldTransforms() const
+{
+	if (!m_transformsDirty)
+		return;
+	for (size_t slot = 0; slot < m_flatNodes.size(); ++slot)
+	{
+		const int parent = m_flatParents[slot];
+		//parents come first, so their flags already include the ones of their ancestors
+		if (parent != -1 && m_dirtyTransforms[parent])
+			m_dirtyTransforms[slot] = 1;
+		if (!m_dirtyTransforms[slot])
+			continue;
+		XMMATRIX world = XMLoadFloat4x4(&m_nodes[m_flatNodes[slot]].localTransform);
+		if (parent != -1)
+			world = world * XMLoadFloat4x4(&m_worldTransforms[parent]);
+		XMStoreFloat4x4(&m_worldTransforms[slot], world);
+	}
+	fill(m_dirtyTransforms.begin(), m_dirtyTransforms.end(), 0);
+	m_transformsDirty = false;
+}
+
+void Model::_flattenSubtree(int nodeIndex, int parentSlot)
+{
+	const int slot = static_cast<int>(m_flatNodes.size());
+	m_flatNodes.push_back(nodeIndex);
+	m_flatParents.push_back(parentSlot);
+	m_nodeSlots[nodeIndex] = slot;
+	const ModelNode& node = m_nodes[nodeIndex];
+	for (int child = node.childIndex; child != -1; child = m_nodes[child].nextIndex)
+		_flattenSubtree(child, slot);
+	//children are drawn before their parent
+	if (node.meshIndex != -1)
+		m_meshSlots.push_back(slot);
+}
+
+void Model::_flattenHierarchy()
+{
+	m_flatNodes.clear();
+	m_flatParents.clear();
+	m_meshSlots.clear();
+	m_nodeSlots.assign(m_nodes.size(), -1);
+	m_flatNodes.reserve(m_nodes.size());
+	m_flatParents.reserve(m_nodes.size());
+	//top level nodes are node 0 and its siblings
+	for (int root = m_nodes.empty() ? -1 : 0; root != -1; root = m_nodes[root].nextIndex)
+		_flattenSubtree(root, -1);
+	m_worldTransforms.resize(m_flatNodes.size());
+	m_dirtyTransforms.assign(m_flatNodes.size(), 1);
+	m_transformsDirty = true;
+}
+
 Model::NodeIterator Model::begin() const
 {
 	return NodeIterator(*this);
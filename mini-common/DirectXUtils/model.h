@@ -1,8 +1,12 @@
 #pragma once
 #include <DirectXMath.h>
+#include <DirectXCollision.h>
 #include "mesh.h"
 #include <functional>
-#include <stack>
+#include <optional>
+#include <cassert>
+#include <cstdint>
+#include <vector>
 #include <iterator>
 
 namespace mini
@@ -15,9 +19,18 @@ namespace mini
 		int meshIndex = -1;
 	};
 
+	//Bounding volumes of a mesh in its local coordinates
+	struct MeshBounds
+	{
+		DirectX::BoundingBox box;
+		DirectX::BoundingSphere sphere;
+	};
+
 	class Model
 	{
 	public:
+		//Iterates over the nodes with meshes, in the order of a depth-first traversal of the hierarchy,
+		//yielding meshes with their world transforms taken from the flattened cache of the model.
 		class NodeIterator
 		{
 		public:
@@ -42,28 +55,32 @@ namespace mini
 
 			std::pair<const Mesh&, const DirectX::XMFLOAT4X4&> operator*() const;
 
-			int nodeIndex() const { return m_nodeStack.empty() ? -1 : m_nodeStack.top().first; }
+			int nodeIndex() const { return atEnd() ? -1 : m_model->m_flatNodes[slot()]; }
 
-			const ModelNode& node() const { assert(!m_nodeStack.empty()); return m_model->getNode(nodeIndex()); }
+			const ModelNode& node() const { assert(!atEnd()); return m_model->getNode(nodeIndex()); }
 
-			int meshIndex() const { return m_nodeStack.empty() ? -1 : node().meshIndex; }
+			int meshIndex() const { return atEnd() ? -1 : node().meshIndex; }
 
-			const Mesh& mesh() const { assert(!m_nodeStack.empty()); return m_model->getMesh(meshIndex()); }
+			const Mesh& mesh() const { assert(!atEnd()); return m_model->getMesh(meshIndex()); }
 
-			size_t meshSignatureID() const { assert(!m_nodeStack.empty()); return m_model->getMeshSignatureID(meshIndex()); }
+			size_t meshSignatureID() const { assert(!atEnd()); return m_model->getMeshSignatureID(meshIndex()); }
 
-			const DirectX::XMFLOAT4X4& transform() const { assert(!m_nodeStack.empty()); return m_nodeStack.top().second; }
+			const DirectX::XMFLOAT4X4& transform() const { assert(!atEnd()); return m_model->m_worldTransforms[slot()]; }
 
-		private:
+			//bounding volumes of the mesh in its local coordinates, nullptr if unknown
+			const MeshBounds* meshBounds() const { assert(!atEnd()); return m_model->getMeshBounds(meshIndex()); }
 
-			void pushNode(int nodeIndex);
-			void pushToLeaf(int nodeIndex);
+		private:
+			bool atEnd() const { return m_model == nullptr || m_position >= m_model->m_meshSlots.size(); }
+			int slot() const { return m_model->m_meshSlots[m_position]; }
 
 			const Model* m_model;
-			std::stack<std::pair<int, DirectX::XMFLOAT4X4>> m_nodeStack;
+			size_t m_position;
 		};
 		Model() = default;
-		Model(std::vector<Mesh>&& meshes, std::vector<size_t>&& signatures, std::vector<ModelNode>&& nodes);
+		//bounds - empty or bounding volumes of all meshes
+		Model(std::vector<Mesh>&& meshes, std::vector<size_t>&& signatures, std::vector<ModelNode>&& nodes,
+			std::vector<MeshBounds>&& bounds = {});
 		Model(Model&& other) = default;
 		Model(const Model& other) = delete;
 
@@ -78,10 +95,22 @@ namespace mini
 
 		size_t getMeshSignatureID(int meshIndex) const;
 
+		//returns nullptr for meshes without known bounds, which are never culled
+		const MeshBounds* getMeshBounds(int meshIndex) const;
+		void setMeshBounds(int meshIndex, const MeshBounds& bounds);
+
 		const ModelNode& getNode(int nodeIndex) const;
+		//only the world transforms of the node and its descendants are recomputed
 		void setNodeTransform(int nodeIndex, const DirectX::XMFLOAT4X4& transform);
 		//applies transformation to the whole model
 		void applyTransform(const DirectX::XMFLOAT4X4& transform);
+		//world transform of the node, i.e. its local transform combined with the ones of all its ancestors
+		const DirectX::XMFLOAT4X4& getWorldTransform(int nodeIndex) const;
+
+		//Recomputes the cached world transforms invalidated by setNodeTransform and applyTransform since the last
+		//update. begin() and getWorldTransform() do it as needed, so an explicit call is only required before
+		//iterating over the model from several threads at once.
+		void updateWorldTransforms() const;
 
 		NodeIterator begin() const;
 		NodeIterator end() const;
@@ -89,8 +118,27 @@ namespace mini
 		bool empty() const { return m_nodes.empty(); }
 
 	private:
+		//rebuilds the flattened hierarchy after the structure of the tree changed
+		void _flattenHierarchy();
+		void _flattenSubtree(int nodeIndex, int parentSlot);
+		void _invalidate(int nodeIndex);
+
 		std::vector<Mesh> m_meshes;
 		std::vector<size_t> m_meshSignatures;
+		std::vector<std::optional<MeshBounds>> m_meshBounds;
 		std::vector<ModelNode> m_nodes;
+
+		//Flattened hierarchy: every node has a slot, parents come before their children, so world transforms
+		//are computed in a single linear pass. Arrays below are indexed by slots.
+		std::vector<int> m_flatNodes;
+		//slot of the parent, -1 for top level nodes
+		std::vector<int> m_flatParents;
+		//slot of each node, indexed by node index
+		std::vector<int> m_nodeSlots;
+		//slots of the nodes with meshes, in the order they are drawn
+		std::vector<int> m_meshSlots;
+		mutable std::vector<DirectX::XMFLOAT4X4> m_worldTransforms;
+		mutable std::vector<uint8_t> m_dirtyTransforms;
+		mutable bool m_transformsDirty = false;
 	};
 }
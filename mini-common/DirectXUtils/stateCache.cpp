@@ -0,0 +1,208 @@
+#include "stateCache.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace std;
+using namespace mini;
+using namespace directx;
+
+const void* const StateCache::Unknown = reinterpret_cast<const void*>(~uintptr_t(0));
+
+StateCache::StateCache(const dx_ptr<ID3D11DeviceContext>& context)
+	: m_context(clone(context))
+{
+	Invalidate();
+}
+
+void StateCache::Invalidate()
+{
+	fill(begin(m_shaders), end(m_shaders), Unknown);
+	for (int stage = 0; stage < StageCount; ++stage)
+	{
+		fill(begin(m_constantBuffers[stage]), end(m_constantBuffers[stage]), Unknown);
+		fill(begin(m_shaderResources[stage]), end(m_shaderResources[stage]), Unknown);
+		fill(begin(m_samplers[stage]), end(m_samplers[stage]), Unknown);
+	}
+	m_inputLayout = Unknown;
+	m_topologyKnown = false;
+	m_indexBuffer = Unknown;
+	fill(begin(m_vertexBuffers), end(m_vertexBuffers), VertexBufferBinding{ Unknown, 0, 0 });
+	m_rasterizerState = Unknown;
+	m_viewportCount = ViewportSlots + 1;
+	m_renderTargetCount = RenderTargetSlots + 1;
+}
+
+template<typename T>
+bool StateCache::_update(const void** cached, UINT slots, UINT& start, UINT& count, T* const* objects)
+{
+	assert(start + count <= slots);
+	count = min(count, slots - min(start, slots));
+	UINT first = count, last = 0;
+	for (UINT i = 0; i < count; ++i)
+	{
+		if (cached[start + i] == objects[i])
+			continue;
+		cached[start + i] = objects[i];
+		first = min(first, i);
+		last = i;
+	}
+	if (first == count)
+		return false;
+	start += first;
+	count = last - first + 1;
+	return true;
+}
+
+bool StateCache::_updateShader(Stage stage, const void* shader)
+{
+	const bool changed = m_shaders[stage] != shader;
+	m_shaders[stage] = shader;
+	return _count(changed);
+}
+
+void StateCache::VSSetShader(ID3D11VertexShader* shader)
+{
+	if (_updateShader(VS, shader))
+		m_context->VSSetShader(shader, nullptr, 0);
+}
+
+void StateCache::HSSetShader(ID3D11HullShader* shader)
+{
+	if (_updateShader(HS, shader))
+		m_context->HSSetShader(shader, nullptr, 0);
+}
+
+void StateCache::DSSetShader(ID3D11DomainShader* shader)
+{
+	if (_updateShader(DS, shader))
+		m_context->DSSetShader(shader, nullptr, 0);
+}
+
+void StateCache::GSSetShader(ID3D11GeometryShader* shader)
+{
+	if (_updateShader(GS, shader))
+		m_context->GSSetShader(shader, nullptr, 0);
+}
+
+void StateCache::PSSetShader(ID3D11PixelShader* shader)
+{
+	if (_updateShader(PS, shader))
+		m_context->PSSetShader(shader, nullptr, 0);
+}
+
+void StateCache::_setConstantBuffers(Stage stage, UINT start, UINT count, ID3D11Buffer* const* buffers)
+{
+	static constexpr void (STDMETHODCALLTYPE ID3D11DeviceContext::*Set[StageCount])(UINT, UINT, ID3D11Buffer* const*) = {
+		&ID3D11DeviceContext::VSSetConstantBuffers, &ID3D11DeviceContext::HSSetConstantBuffers,
+		&ID3D11DeviceContext::DSSetConstantBuffers, &ID3D11DeviceContext::GSSetConstantBuffers,
+		&ID3D11DeviceContext::PSSetConstantBuffers };
+	const UINT first = start;
+	if (_count(_update(m_constantBuffers[stage], ConstantBufferSlots, start, count, buffers)))
+		(m_context.get()->*Set[stage])(start, count, buffers + (start - first));
+}
+
+void StateCache::_setShaderResources(Stage stage, UINT start, UINT count, ID3D11ShaderResourceView* const* views)
+{
+	static constexpr void (STDMETHODCALLTYPE ID3D11DeviceContext::*Set[StageCount])(UINT, UINT, ID3D11ShaderResourceView* const*) = {
+		&ID3D11DeviceContext::VSSetShaderResources, &ID3D11DeviceContext::HSSetShaderResources,
+		&ID3D11DeviceContext::DSSetShaderResources, &ID3D11DeviceContext::GSSetShaderResources,
+		&ID3D11DeviceContext::PSSetShaderResources };
+	const UINT first = start;
+	if (_count(_update(m_shaderResources[stage], ShaderResourceSlots, start, count, views)))
+		(m_context.get()->*Set[stage])(start, count, views + (start - first));
+}
+
+void StateCache::_setSamplers(Stage stage, UINT start, UINT count, ID3D11SamplerState* const* samplers)
+{
+	static constexpr void (STDMETHODCALLTYPE ID3D11DeviceContext::*Set[StageCount])(UINT, UINT, ID3D11SamplerState* const*) = {
+		&ID3D11DeviceContext::VSSetSamplers, &ID3D11DeviceContext::HSSetSamplers,
+		&ID3D11DeviceContext::DSSetSamplers, &ID3D11DeviceContext::GSSetSamplers,
+		&ID3D11DeviceContext::PSSetSamplers };
+	const UINT first = start;
+	if (_count(_update(m_samplers[stage], SamplerSlots, start, count, samplers)))
+		(m_context.get()->*Set[stage])(start, count, samplers + (start - first));
+}
+
+void StateCache::IASetInputLayout(ID3D11InputLayout* layout)
+{
+	const bool changed = m_inputLayout != layout;
+	m_inputLayout = layout;
+	if (_count(changed))
+		m_context->IASetInputLayout(layout);
+}
+
+void StateCache::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	const bool changed = !m_topologyKnown || m_topology != topology;
+	m_topologyKnown = true;
+	m_topology = topology;
+	if (_count(changed))
+		m_context->IASetPrimitiveTopology(topology);
+}
+
+void StateCache::IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset)
+{
+	const bool changed = m_indexBuffer != buffer || m_indexFormat != format || m_indexOffset != offset;
+	m_indexBuffer = buffer;
+	m_indexFormat = format;
+	m_indexOffset = offset;
+	if (_count(changed))
+		m_context->IASetIndexBuffer(buffer, format, offset);
+}
+
+void StateCache::IASetVertexBuffers(UINT start, UINT count, ID3D11Buffer* const* buffers, const UINT* strides,
+	const UINT* offsets)
+{
+	assert(start + count <= VertexBufferSlots);
+	count = min(count, VertexBufferSlots - min(start, VertexBufferSlots));
+	UINT first = count, last = 0;
+	for (UINT i = 0; i < count; ++i)
+	{
+		VertexBufferBinding& cached = m_vertexBuffers[start + i];
+		if (cached.buffer == buffers[i] && cached.stride == strides[i] && cached.offset == offsets[i])
+			continue;
+		cached = { buffers[i], strides[i], offsets[i] };
+		first = min(first, i);
+		last = i;
+	}
+	if (_count(first < count))
+		m_context->IASetVertexBuffers(start + first, last - first + 1, buffers + first, strides + first, offsets + first);
+}
+
+void StateCache::RSSetState(ID3D11RasterizerState* state)
+{
+	const bool changed = m_rasterizerState != state;
+	m_rasterizerState = state;
+	if (_count(changed))
+		m_context->RSSetState(state);
+}
+
+void StateCache::RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports)
+{
+	assert(count <= ViewportSlots);
+	count = min(count, ViewportSlots);
+	const bool changed = m_viewportCount != count ||
+		(count > 0 && memcmp(m_viewports, viewports, count * sizeof(D3D11_VIEWPORT)) != 0);
+	m_viewportCount = count;
+	copy_n(viewports, count, m_viewports);
+	if (_count(changed))
+		m_context->RSSetViewports(count, viewports);
+}
+
+void StateCache::OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depthStencil)
+{
+	assert(count <= RenderTargetSlots);
+	count = min(count, RenderTargetSlots);
+	bool changed = m_renderTargetCount != count || m_depthStencil != depthStencil;
+	for (UINT i = 0; i < count && !changed; ++i)
+		changed = m_renderTargets[i] != targets[i];
+	if (!_count(changed))
+		return;
+	m_renderTargetCount = count;
+	copy_n(targets, count, m_renderTargets);
+	m_depthStencil = depthStencil;
+	m_context->OMSetRenderTargets(count, targets, depthStencil);
+	for (int stage = 0; stage < StageCount; ++stage)
+		fill(begin(m_shaderResources[stage]), end(m_shaderResources[stage]), Unknown);
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "dxptr.h"
+#include <D3D11.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace mini
+{
+	//Calls setting pipeline state passed to the device context, and the ones dropped as redundant
+	struct StateCacheStats
+	{
+		size_t issued = 0;
+		size_t skipped = 0;
+	};
+
+	//Remembers the objects bound to every slot of the device context and drops calls which would bind the same ones again.
+	//Calls binding ranges of slots are narrowed to the slots which actually change. Objects are compared by address,
+	//so the cache has to be invalidated whenever the context may have been changed bypassing it, and at least once
+	//a frame, so that an object created at the address of a destroyed one isn't taken for it.
+	class StateCache
+	{
+	public:
+		explicit StateCache(const directx::dx_ptr<ID3D11DeviceContext>& context);
+
+		const directx::dx_ptr<ID3D11DeviceContext>& Context() const { return m_context; }
+
+		//forgets all bound objects, the following calls are passed to the context
+		void Invalidate();
+
+		const StateCacheStats& Stats() const { return m_stats; }
+		void ResetStats() { m_stats = {}; }
+
+		void VSSetShader(ID3D11VertexShader* shader);
+		void HSSetShader(ID3D11HullShader* shader);
+		void DSSetShader(ID3D11DomainShader* shader);
+		void GSSetShader(ID3D11GeometryShader* shader);
+		void PSSetShader(ID3D11PixelShader* shader);
+
+		void VSSetConstantBuffers(UINT start, UINT count, ID3D11Buffer* const* buffers)
+		{ _setConstantBuffers(VS, start, count, buffers); }
+		void HSSetConstantBuffers(UINT start, UINT count, ID3D11Buffer* const* buffers)
+		{ _setConstantBuffers(HS, start, count, buffers); }
+		void DSSetConstantBuffers(UINT start, UINT count, ID3D11Buffer* const* buffers)
+		{ _setConstantBuffers(DS, start, count, buffers); }
+		void GSSetConstantBuffers(UINT start, UINT count, ID3D11Buffer* const* buffers)
+		{ _setConstantBuffers(GS, start, count, buffers); }
+		void PSSetConstantBuffers(UINT start, UINT count, ID3D11Buffer* const* buffers)
+		{ _setConstantBuffers(PS, start, count, buffers); }
+
+		void VSSetShaderResources(UINT start, UINT count, ID3D11ShaderResourceView* const* views)
+		{ _setShaderResources(VS, start, count, views); }
+		void HSSetShaderResources(UINT start, UINT count, ID3D11ShaderResourceView* const* views)
+		{ _setShaderResources(HS, start, count, views); }
+		void DSSetShaderResources(UINT start, UINT count, ID3D11ShaderResourceView* const* views)
+		{ _setShaderResources(DS, start, count, views); }
+		void GSSetShaderResources(UINT start, UINT count, ID3D11ShaderResourceView* const* views)
+		{ _setShaderResources(GS, start, count, views); }
+		void PSSetShaderResources(UINT start, UINT count, ID3D11ShaderResourceView* const* views)
+		{ _setShaderResources(PS, start, count, views); }
+
+		void VSSetSamplers(UINT start, UINT count, ID3D11SamplerState* const* samplers)
+		{ _setSamplers(VS, start, count, samplers); }
+		void HSSetSamplers(UINT start, UINT count, ID3D11SamplerState* const* samplers)
+		{ _setSamplers(HS, start, count, samplers); }
+		void DSSetSamplers(UINT start, UINT count, ID3D11SamplerState* const* samplers)
+		{ _setSamplers(DS, start, count, samplers); }
+		void GSSetSamplers(UINT start, UINT count, ID3D11SamplerState* const* samplers)
+		{ _setSamplers(GS, start, count, samplers); }
+		void PSSetSamplers(UINT start, UINT count, ID3D11SamplerState* const* samplers)
+		{ _setSamplers(PS, start, count, samplers); }
+
+		void IASetInputLayout(ID3D11InputLayout* layout);
+		void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+		void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset);
+		void IASetVertexBuffers(UINT start, UINT count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets);
+
+		void RSSetState(ID3D11RasterizerState* state);
+		void RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports);
+
+		//Shader resource views of all stages are forgotten when render targets change,
+		//since the context unbinds views of resources bound as outputs.
+		void OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depthStencil);
+
+	private:
+		enum Stage { VS, HS, DS, GS, PS, StageCount };
+
+		static constexpr UINT ConstantBufferSlots = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+		static constexpr UINT ShaderResourceSlots = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+		static constexpr UINT SamplerSlots = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+		static constexpr UINT VertexBufferSlots = D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+		static constexpr UINT RenderTargetSlots = D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT;
+		static constexpr UINT ViewportSlots = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+
+		//Stands for an unknown binding, never equal to a valid object or nullptr
+		static const void* const Unknown;
+
+		struct VertexBufferBinding
+		{
+			const void* buffer;
+			UINT stride;
+			UINT offset;
+		};
+
+		//Compares objects in slots [start, start + count) with the cached ones and stores the new ones. Returns false
+		//if none changed, otherwise narrows [start, start + count) to the slots from the first to the last changed one.
+		template<typename T>
+		static bool _update(const void** cached, UINT slots, UINT& start, UINT& count, T* const* objects);
+		//counts the call, returns true if it has to be passed to the context
+		bool _count(bool changed)
+		{
+			++(changed ? m_stats.issued : m_stats.skipped);
+			return changed;
+		}
+		bool _updateShader(Stage stage, const void* shader);
+
+		void _setConstantBuffers(Stage stage, UINT start, UINT count, ID3D11Buffer* const* buffers);
+		void _setShaderResources(Stage stage, UINT start, UINT count, ID3D11ShaderResourceView* const* views);
+		void _setSamplers(Stage stage, UINT start, UINT count, ID3D11SamplerState* const* samplers);
+
+		directx::dx_ptr<ID3D11DeviceContext> m_context;
+		StateCacheStats m_stats;
+
+		const void* m_shaders[StageCount];
+		const void* m_constantBuffers[StageCount][ConstantBufferSlots];
+		const void* m_shaderResources[StageCount][ShaderResourceSlots];
+		const void* m_samplers[StageCount][SamplerSlots];
+
+		const void* m_inputLayout;
+		bool m_topologyKnown;
+		D3D11_PRIMITIVE_TOPOLOGY m_topology;
+		const void* m_indexBuffer;
+		DXGI_FORMAT m_indexFormat;
+		UINT m_indexOffset;
+		VertexBufferBinding m_vertexBuffers[VertexBufferSlots];
+
+		const void* m_rasterizerState;
+		//0 viewports is a valid state, ViewportSlots + 1 stands for unknown ones
+		UINT m_viewportCount;
+		D3D11_VIEWPORT m_viewports[ViewportSlots];
+
+		//RenderTargetSlots + 1 stands for unknown targets
+		UINT m_renderTargetCount;
+		const void* m_renderTargets[RenderTargetSlots];
+		const void* m_depthStencil;
+	};
+}
@@ -0,0 +1,176 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mini::utils
+{
+	//Pool of worker threads with a task queue per worker. Workers take tasks from the back of their
+	//own queue and, when it is empty, steal from the front of the other queues.
+	//Threads waiting for a parallel_for to finish execute pending tasks instead of blocking,
+	//so parallel_for calls can be nested.
+	class thread_pool
+	{
+	public:
+		using task = std::function<void()>;
+
+		//thread_count of 0 creates a pool without workers, which runs everything on the calling thread
+		explicit thread_pool(unsigned thread_count = std::max(1U, std::thread::hardware_concurrency()))
+			: m_pending{ 0 }, m_stop{ false }, m_next_queue{ 0 }
+		{
+			m_queues.reserve(thread_count);
+			for (unsigned i = 0; i < thread_count; ++i)
+				m_queues.push_back(std::make_unique<queue>());
+			m_threads.reserve(thread_count);
+			for (unsigned i = 0; i < thread_count; ++i)
+				m_threads.emplace_back([this, i] { worker_loop(i); });
+		}
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		~thread_pool()
+		{
+			{
+				std::lock_guard lock{ m_sleep_mutex };
+				m_stop = true;
+			}
+			m_wake.notify_all();
+			for (auto& t : m_threads)
+				t.join();
+		}
+
+		[[nodiscard]] unsigned size() const noexcept { return static_cast<unsigned>(m_threads.size()); }
+
+		void submit(task t)
+		{
+			if (m_threads.empty())
+			{
+				t();
+				return;
+			}
+			{
+				std::lock_guard lock{ m_sleep_mutex };
+				++m_pending;
+			}
+			const size_t index = s_current_pool == this ? s_current_index
+				: m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+			{
+				queue& q = *m_queues[index];
+				std::lock_guard lock{ q.mutex };
+				q.tasks.push_back(std::move(t));
+			}
+			m_wake.notify_one();
+		}
+
+		//Calls body(first, last) for consecutive subranges of [begin, end) of at most grain elements
+		//and waits until all of them are done. body must not throw.
+		template<class F>
+		void parallel_for(size_t begin, size_t end, size_t grain, F&& body)
+		{
+			if (begin >= end)
+				return;
+			grain = std::max<size_t>(grain, 1);
+			const size_t chunks = (end - begin + grain - 1) / grain;
+			if (chunks == 1 || m_threads.empty())
+			{
+				for (size_t first = begin; first < end; first += grain)
+					body(first, std::min(end, first + grain));
+				return;
+			}
+			std::atomic<size_t> remaining{ chunks - 1 };
+			for (size_t c = 1; c < chunks; ++c)
+			{
+				const size_t first = begin + c * grain;
+				submit([&body, &remaining, first, last = std::min(end, first + grain)] {
+					body(first, last);
+					remaining.fetch_sub(1, std::memory_order_release);
+				});
+			}
+			body(begin, begin + grain);
+			while (remaining.load(std::memory_order_acquire) != 0)
+				if (!run_pending())
+					std::this_thread::yield();
+		}
+
+		//Executes one queued task on the calling thread. Returns false if there was nothing to do.
+		bool run_pending()
+		{
+			task t;
+			const size_t index = s_current_pool == this ? s_current_index : 0;
+			if (!try_pop(index, t) && !try_steal(index, t))
+				return false;
+			t();
+			return true;
+		}
+
+	private:
+		struct queue
+		{
+			std::mutex mutex;
+			std::deque<task> tasks;
+		};
+
+		bool try_pop(size_t index, task& t)
+		{
+			queue& q = *m_queues[index];
+			std::lock_guard lock{ q.mutex };
+			if (q.tasks.empty())
+				return false;
+			t = std::move(q.tasks.back());
+			q.tasks.pop_back();
+			m_pending.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		bool try_steal(size_t thief, task& t)
+		{
+			const size_t count = m_queues.size();
+			for (size_t i = 1; i <= count; ++i)
+			{
+				queue& q = *m_queues[(thief + i) % count];
+				std::lock_guard lock{ q.mutex };
+				if (q.tasks.empty())
+					continue;
+				t = std::move(q.tasks.front());
+				q.tasks.pop_front();
+				m_pending.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+			return false;
+		}
+
+		void worker_loop(size_t index)
+		{
+			s_current_pool = this;
+			s_current_index = index;
+			while (true)
+			{
+				if (run_pending())
+					continue;
+				std::unique_lock lock{ m_sleep_mutex };
+				m_wake.wait(lock, [this] { return m_stop || m_pending.load(std::memory_order_relaxed) != 0; });
+				if (m_stop && m_pending.load(std::memory_order_relaxed) == 0)
+					return;
+			}
+		}
+
+		static inline thread_local const thread_pool* s_current_pool = nullptr;
+		static inline thread_local size_t s_current_index = 0;
+
+		std::vector<std::unique_ptr<queue>> m_queues;
+		std::vector<std::thread> m_threads;
+		std::mutex m_sleep_mutex;
+		std::condition_variable m_wake;
+		//number of queued tasks not yet taken by any thread
+		std::atomic<size_t> m_pending;
+		bool m_stop;
+		std::atomic<size_t> m_next_queue;
+	};
+}